@@ -0,0 +1,18 @@
+// 局部数组初始化: 大部分元素为 0, 只有少数几个非 0
+int f(int k) {
+  int a[16][16] = {{1, 2}, {3}, {}, {4, 5, 6}};
+  int b[256] = {7, 8, 9};
+  b[k % 16] = k;
+  return a[0][1] + a[3][2] + b[2] + b[255] + a[15][15] + b[5];
+}
+
+int main() {
+  int i = 0, sum = 0;
+  while (i < 40) {
+    sum = sum + f(i);
+    i = i + 1;
+  }
+  putint(sum);
+  putch(10);
+  return 0;
+}
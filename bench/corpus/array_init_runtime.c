@@ -0,0 +1,38 @@
+// 局部数组的初值含有变量和函数调用, 需要在运行时按顺序求值
+int cnt = 0;
+
+int next(int x) {
+  cnt = cnt + 1;
+  return x * 10 + cnt;
+}
+
+int f(int n) {
+  int a[4] = {n, n + 1, next(n), n * n};
+  int b[3][5] = {{n}, {next(n), 2, n - 1}, n + 2};
+  int c[64] = {0, n, 0, 0, next(a[2])};
+  int i = 0, s = 0;
+  while (i < 4) {
+    s = s + a[i] * (i + 1);
+    i = i + 1;
+  }
+  i = 0;
+  while (i < 15) {
+    s = s + b[i / 5][i % 5] * (i + 3);
+    i = i + 1;
+  }
+  return s + c[1] + c[4] * 2 + c[63];
+}
+
+int main() {
+  int n = getint();
+  int i = 0, sum = 0;
+  while (i < n) {
+    sum = (sum + f(i)) % 100003;
+    i = i + 1;
+  }
+  putint(sum);
+  putch(10);
+  putint(cnt);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,37 @@
+// 冒泡排序, 数组参数与嵌套循环
+void sort(int arr[], int n) {
+  int i = 0;
+  while (i < n - 1) {
+    int j = 0;
+    while (j < n - 1 - i) {
+      if (arr[j] > arr[j + 1]) {
+        int t = arr[j];
+        arr[j] = arr[j + 1];
+        arr[j + 1] = t;
+      }
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+}
+
+int main() {
+  int n = getint();
+  int arr[200];
+  int i = 0;
+  while (i < n) {
+    arr[i] = getint();
+    i = i + 1;
+  }
+  sort(arr, n);
+  putarray(10, arr);
+  int check = 0;
+  i = 0;
+  while (i < n) {
+    check = (check * 31 + arr[i]) % 1000007;
+    i = i + 1;
+  }
+  putint(check);
+  putch(10);
+  return 0;
+}
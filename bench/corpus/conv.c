@@ -0,0 +1,43 @@
+// 二维卷积, 常量数组与多层循环
+const int H = 24, W = 24;
+const int K[3][3] = {{1, 2, 1}, {2, 4, 2}, {1, 2, 1}};
+int img[H][W], res[H][W];
+
+int main() {
+  int i = 0;
+  while (i < H) {
+    int j = 0;
+    while (j < W) {
+      img[i][j] = (i * 17 + j * 29) % 256;
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  i = 1;
+  while (i < H - 1) {
+    int j = 1;
+    while (j < W - 1) {
+      int s = 0, di = 0;
+      while (di < 3) {
+        int dj = 0;
+        while (dj < 3) {
+          s = s + img[i + di - 1][j + dj - 1] * K[di][dj];
+          dj = dj + 1;
+        }
+        di = di + 1;
+      }
+      res[i][j] = s / 16;
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  int check = 0;
+  i = 0;
+  while (i < H) {
+    check = check + res[i][(i * 5) % W];
+    i = i + 1;
+  }
+  putint(check);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,12 @@
+// 递归函数调用
+int fib(int n) {
+  if (n <= 1) return n;
+  return fib(n - 1) + fib(n - 2);
+}
+
+int main() {
+  int r = fib(18);
+  putint(r);
+  putch(10);
+  return r % 256;
+}
@@ -0,0 +1,20 @@
+// 循环中反复读写全局变量, 以及只读的全局常量
+int total;
+int step = 3;
+int scale = 7;
+const int LIMIT = 3000;
+
+void accumulate(int n) {
+  int i = 0;
+  while (i < n) {
+    total = total + i * scale + step;
+    i = i + 1;
+  }
+}
+
+int main() {
+  accumulate(LIMIT);
+  putint(total);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,19 @@
+// 循环中有大量不变量和可以强度削减的乘法
+int main() {
+  int n = 40, m = 30;
+  int a[40][30];
+  int i = 0;
+  int sum = 0;
+  while (i < n) {
+    int j = 0;
+    while (j < m) {
+      a[i][j] = i * m + j + (n * m - 7) / 3;
+      sum = sum + a[i][j] * 2 + (n + m) * (n - m);
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+  putint(sum);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,47 @@
+// 矩阵乘法, 多维数组与三重循环
+const int N = 20;
+int a[N][N], b[N][N], c[N][N];
+
+void init() {
+  int i = 0;
+  while (i < N) {
+    int j = 0;
+    while (j < N) {
+      a[i][j] = (i * 7 + j * 3) % 11 - 5;
+      b[i][j] = (i * 5 + j * 13) % 17 - 8;
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+}
+
+void matmul() {
+  int i = 0;
+  while (i < N) {
+    int j = 0;
+    while (j < N) {
+      int k = 0;
+      int sum = 0;
+      while (k < N) {
+        sum = sum + a[i][k] * b[k][j];
+        k = k + 1;
+      }
+      c[i][j] = sum;
+      j = j + 1;
+    }
+    i = i + 1;
+  }
+}
+
+int main() {
+  init();
+  matmul();
+  int i = 0, trace = 0;
+  while (i < N) {
+    trace = trace + c[i][i];
+    i = i + 1;
+  }
+  putint(trace);
+  putch(10);
+  return 0;
+}
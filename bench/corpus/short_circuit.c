@@ -0,0 +1,16 @@
+// 大量 && 和 || 组成的条件
+int main() {
+  int i = 0, hits = 0;
+  while (i < 2000) {
+    if ((i % 3 == 0 && i % 5 != 0) || (i % 7 == 0 && i > 100) || !(i < 1990)) {
+      hits = hits + 1;
+    }
+    if (i > 10 && i < 20 || i > 1000 && i % 2 == 0 && i % 4 != 0) {
+      hits = hits + 2;
+    }
+    i = i + 1;
+  }
+  putint(hits);
+  putch(10);
+  return 0;
+}
@@ -0,0 +1,29 @@
+// 埃氏筛, 全局数组与 while 循环中的 break/continue
+const int MAXN = 3000;
+int is_composite[MAXN];
+
+int main() {
+  int count = 0;
+  int i = 2;
+  while (i < MAXN) {
+    if (is_composite[i]) {
+      i = i + 1;
+      continue;
+    }
+    count = count + 1;
+    int j = i * i;
+    if (j >= MAXN) {
+      i = i + 1;
+      continue;
+    }
+    while (1) {
+      if (j >= MAXN) break;
+      is_composite[j] = 1;
+      j = j + i;
+    }
+    i = i + 1;
+  }
+  putint(count);
+  putch(10);
+  return 0;
+}
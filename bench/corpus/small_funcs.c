@@ -0,0 +1,19 @@
+// 频繁调用的小函数, 适合内联
+int sq(int x) { return x * x; }
+int add3(int a, int b, int c) { return a + b + c; }
+int clamp(int x, int lo, int hi) {
+  if (x < lo) return lo;
+  if (x > hi) return hi;
+  return x;
+}
+
+int main() {
+  int i = 0, acc = 0;
+  while (i < 1500) {
+    acc = acc + clamp(add3(sq(i % 13), i, -50), 0, 200);
+    i = i + 1;
+  }
+  putint(acc);
+  putch(10);
+  return 0;
+}
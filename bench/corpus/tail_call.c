@@ -0,0 +1,22 @@
+// 尾递归与尾调用
+int gcd(int a, int b) {
+  if (b == 0) return a;
+  return gcd(b, a % b);
+}
+
+int sum_to(int n, int acc) {
+  if (n == 0) return acc;
+  return sum_to(n - 1, acc + n);
+}
+
+int main() {
+  int i = 1, s = 0;
+  while (i < 300) {
+    s = s + gcd(i * 37, 1000 - i);
+    i = i + 1;
+  }
+  s = s + sum_to(1000, 0);
+  putint(s);
+  putch(10);
+  return 0;
+}
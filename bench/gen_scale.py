@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+# 生成用于测量编译时间和内存的大规模合成程序
+# 每个程序都可以运行, 输出一个校验值, 生成的内容由固定的随机种子决定
+#
+# 用法: python3 gen_scale.py 输出目录
+
+import os
+import random
+import sys
+
+
+def many_funcs(rng):
+    # 大量中等大小的函数, 考察逐函数处理的开销
+    lines = []
+    count = 300
+    for i in range(count):
+        c1, c2, c3 = rng.randint(1, 9), rng.randint(1, 9), rng.randint(10, 99)
+        lines.append('int f%d(int x) {' % i)
+        lines.append('  int a[8];')
+        lines.append('  int i = 0, s = x;')
+        lines.append('  while (i < 8) {')
+        lines.append('    a[i] = s * %d + i;' % c1)
+        lines.append('    if (a[i] %% %d == 0 && s > %d || i == 3) s = s + a[i];' % (c2 + 1, c3))
+        lines.append('    else s = s - %d;' % c2)
+        lines.append('    i = i + 1;')
+        lines.append('  }')
+        lines.append('  return s %% %d;' % (c3 * 7))
+        lines.append('}')
+    lines.append('int main() {')
+    lines.append('  int r = 0;')
+    for i in range(count):
+        lines.append('  r = (r + f%d(%d)) %% 100003;' % (i, i))
+    lines.append('  putint(r);')
+    lines.append('  putch(10);')
+    lines.append('  return 0;')
+    lines.append('}')
+    return '\n'.join(lines) + '\n'
+
+
+def long_expr(rng):
+    # 很长的表达式, 考察表达式树的深度和临时值的数量
+    def expr(depth):
+        if depth == 0:
+            return rng.choice(['a', 'b', 'c', str(rng.randint(1, 50))])
+        op = rng.choice(['+', '-', '*', '+', '-'])
+        return '(%s %s %s)' % (expr(depth - 1), op, expr(depth - 1))
+
+    lines = ['int main() {', '  int a = 3, b = 5, c = 7;', '  int r = 0;']
+    for i in range(40):
+        lines.append('  r = (r + %s) %% 65521;' % expr(7))
+        lines.append('  a = b; b = c; c = r % 97 + 1;')
+    lines += ['  putint(r);', '  putch(10);', '  return 0;', '}']
+    return '\n'.join(lines) + '\n'
+
+
+def big_block(rng):
+    # 一个函数里有大量局部变量和语句, 考察栈帧很大时的代码生成
+    count = 1500
+    lines = ['int main() {']
+    for i in range(count):
+        if i < 3:
+            lines.append('  int v%d = %d;' % (i, rng.randint(1, 100)))
+        else:
+            j, k = rng.randint(0, i - 1), rng.randint(0, i - 1)
+            op = rng.choice(['+', '-', '*'])
+            lines.append('  int v%d = (v%d %s v%d) %% 10007;' % (i, j, op, k))
+    lines += ['  putint(v%d);' % (count - 1), '  putch(10);', '  return 0;', '}']
+    return '\n'.join(lines) + '\n'
+
+
+def global_init(rng):
+    # 带初始值的大全局数组与局部数组
+    n = 20000
+    values = ', '.join(str(rng.randint(-100, 100)) for _ in range(n))
+    lines = ['int g[%d] = {%s};' % (n, values)]
+    lines.append('int main() {')
+    lines.append('  int i = 0, s = 0;')
+    lines.append('  while (i < %d) {' % n)
+    lines.append('    s = s + g[i];')
+    lines.append('    i = i + 97;')
+    lines.append('  }')
+    lines += ['  putint(s);', '  putch(10);', '  return 0;', '}']
+    return '\n'.join(lines) + '\n'
+
+
+def local_array(rng):
+    # 很大的局部数组, 只显式给出少数初值, 编译时间和代码长度应与数组大小无关
+    n = 100000
+    values = ', '.join(str(rng.randint(1, 100)) for _ in range(5))
+    lines = ['int f(int x) {']
+    lines.append('  int a[%d] = {%s, x};' % (n, values))
+    lines.append('  int b[300][300] = {{1, 2}, {x}, {}, {4, 5, 6}};')
+    lines.append('  int i = 0, s = 0;')
+    lines.append('  while (i < %d) {' % n)
+    lines.append('    s = (s + a[i] * (i % 7 + 1) + b[i % 300][i / 300 % 300]) % 65521;')
+    lines.append('    i = i + 7;')
+    lines.append('  }')
+    lines.append('  return s;')
+    lines.append('}')
+    lines += ['int main() {', '  putint(f(3) + f(10));', '  putch(10);', '  return 0;', '}']
+    return '\n'.join(lines) + '\n'
+
+
+GENERATORS = [
+    ('scale_many_funcs', many_funcs),
+    ('scale_long_expr', long_expr),
+    ('scale_big_block', big_block),
+    ('scale_global_init', global_init),
+    ('scale_local_array', local_array),
+]
+
+
+def generate(out_dir):
+    """在 out_dir 中生成所有程序, 返回 [(名字, 路径)]"""
+    os.makedirs(out_dir, exist_ok=True)
+    programs = []
+    for seed, (name, gen) in enumerate(GENERATORS):
+        path = os.path.join(out_dir, name + '.c')
+        with open(path, 'w') as f:
+            f.write(gen(random.Random(seed)))
+        programs.append((name, path))
+    return programs
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        sys.stderr.write('usage: gen_scale.py out_dir\n')
+        sys.exit(2)
+    for name, path in generate(sys.argv[1]):
+        print(path)
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+# 端到端 benchmark: 用编译器编译 corpus 中的程序和生成的大规模程序, 记录
+#   compile_ms     编译耗时 (多次取最小值, 毫秒)
+#   peak_rss_kb    编译器进程的峰值内存 (KB)
+#   emitted_insts  输出的指令条数 (-koopa 为 Koopa 指令, 其余为 RISC-V 指令)
+#   dynamic_insts  执行的指令条数: -koopa 为编译器 -interp 模式解释执行 Koopa IR 的条数,
+#                  其余为在 rvsim 上运行生成代码的条数
+# 同时检查运行结果: corpus 中的程序与对应的 .out 比较, 生成的程序要求 -perf 与 -riscv 结果一致
+# 结果写入 json, 并与 baseline 比较, 有回退或结果错误时返回 1
+#
+# 用法: python3 run_bench.py --compiler build/compiler [--flags=-direct] [--update-baseline]
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import gen_scale
+import rvsim
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+CORPUS_DIR = os.path.join(BENCH_DIR, 'corpus')
+MODES = ['-koopa', '-riscv', '-perf']
+
+# 判定回退的阈值: 计数类指标只要变多就算回退, 时间和内存要同时超过倍数和绝对值才算 (避免抖动)
+TIME_RATIO, TIME_SLACK_MS = 2.0, 20.0
+RSS_RATIO, RSS_SLACK_KB = 1.5, 4096
+
+
+def run_compiler(compiler, mode, src, out, flags):
+    """运行一次编译器, 返回 (耗时毫秒, 峰值内存 KB)"""
+    # 峰值内存取编译器 -time-phases 报告的值: 父进程 wait4 得到的 ru_maxrss 会包含 fork 出来的 python 进程的内存
+    phases = out + '.phases.json'
+    start = time.perf_counter()
+    proc = subprocess.run([compiler, mode, src, '-o', out, '-time-phases=' + phases] + flags,
+                          stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    elapsed = (time.perf_counter() - start) * 1000
+    if proc.returncode != 0:
+        raise RuntimeError('%s %s %s failed with %d' % (compiler, mode, src, proc.returncode))
+    with open(phases) as f:
+        peak = json.load(f)['peak_rss_kb']
+    return elapsed, peak
+
+
+def run_interp(compiler, src, report, stdin_text):
+    """用编译器的 -interp 模式执行程序, 返回 (输出, 返回值, 执行的 Koopa 指令条数)"""
+    proc = subprocess.run([compiler, '-interp', src, '-o', report], input=stdin_text,
+                          stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+    if not os.path.exists(report) or 'interp error' in proc.stderr:
+        raise RuntimeError('%s -interp %s failed: %s' % (compiler, src, proc.stderr.strip()))
+    with open(report) as f:
+        count = int(f.readline().split(':')[1])
+    return proc.stdout, proc.returncode, count
+
+
+def count_koopa_insts(text):
+    # 函数体内缩进的行都是指令
+    return sum(1 for line in text.splitlines() if line.startswith('  ') and line.strip())
+
+
+def count_riscv_insts(text):
+    count = 0
+    for line in text.splitlines():
+        line = line.strip()
+        if line and not line.startswith('.') and not line.endswith(':'):
+            count += 1
+    return count
+
+
+def read_expected(name):
+    """读取 corpus 中程序的期望结果, 格式为输出内容, 最后一行为返回值"""
+    path = os.path.join(CORPUS_DIR, name + '.out')
+    if not os.path.exists(path):
+        return None
+    with open(path) as f:
+        return f.read()
+
+
+def format_result(output, exit_code):
+    if output and not output.endswith('\n'):
+        output += '\n'
+    return output + str(exit_code) + '\n'
+
+
+def collect_programs(work_dir):
+    programs = []
+    for file in sorted(os.listdir(CORPUS_DIR)):
+        if file.endswith('.c'):
+            name = file[:-2]
+            programs.append((name, os.path.join(CORPUS_DIR, file), True))
+    for name, path in gen_scale.generate(os.path.join(work_dir, 'scale')):
+        programs.append((name, path, False))
+    return programs
+
+
+def bench_program(args, name, src, from_corpus, failures):
+    stdin_path = os.path.join(CORPUS_DIR, name + '.in')
+    stdin_text = open(stdin_path).read() if os.path.exists(stdin_path) else ''
+    expected = read_expected(name) if from_corpus else None
+    results = {}
+    outputs = {}
+    for mode in MODES:
+        out = os.path.join(args.work_dir, '%s%s.%s' % (name, mode, 'koopa' if mode == '-koopa' else 'S'))
+        times, rss = [], 0
+        for _ in range(args.repeat):
+            elapsed, peak = run_compiler(args.compiler, mode, src, out, args.flags)
+            times.append(elapsed)
+            rss = max(rss, peak)
+        with open(out) as f:
+            text = f.read()
+        result = {'compile_ms': round(min(times), 3), 'peak_rss_kb': rss}
+        if mode == '-koopa':
+            result['emitted_insts'] = count_koopa_insts(text)
+            output, exit_code, count = run_interp(args.compiler, src, out + '.interp', stdin_text)
+            result['dynamic_insts'] = count
+            outputs[mode] = format_result(output, exit_code)
+        else:
+            result['emitted_insts'] = count_riscv_insts(text)
+            try:
+                output, exit_code, count = rvsim.run(text, stdin_text)
+                result['dynamic_insts'] = count
+                outputs[mode] = format_result(output, exit_code)
+            except rvsim.SimError as e:
+                failures.append('%s %s: simulation failed: %s' % (name, mode, e))
+                outputs[mode] = None
+        results[mode] = result
+
+    for mode, got in outputs.items():
+        if got is None:
+            continue
+        if expected is not None and got != expected:
+            failures.append('%s %s: wrong output' % (name, mode))
+        if expected is None and mode != '-riscv' and got != outputs.get('-riscv'):
+            failures.append('%s %s: output differs from -riscv' % (name, mode))
+    return results
+
+
+def is_regression(metric, base, new):
+    if metric in ('emitted_insts', 'dynamic_insts'):
+        return new > base
+    if metric == 'compile_ms':
+        return new > base * TIME_RATIO and new - base > TIME_SLACK_MS
+    if metric == 'peak_rss_kb':
+        return new > base * RSS_RATIO and new - base > RSS_SLACK_KB
+    return False
+
+
+def compare(baseline, results):
+    """与 baseline 比较, 输出每项指标的变化, 返回回退的描述"""
+    regressions = []
+    print('%-22s %-7s %-14s %12s %12s %8s' % ('program', 'mode', 'metric', 'baseline', 'current', 'change'))
+    for name, modes in results.items():
+        for mode, metrics in modes.items():
+            base_metrics = baseline.get(name, {}).get(mode)
+            for metric, new in metrics.items():
+                base = base_metrics.get(metric) if base_metrics else None
+                if base is None:
+                    print('%-22s %-7s %-14s %12s %12s %8s' % (name, mode, metric, '-', new, 'new'))
+                    continue
+                change = '%+.1f%%' % ((new - base) * 100.0 / base) if base else '-'
+                mark = ''
+                if is_regression(metric, base, new):
+                    mark = '  REGRESSION'
+                    regressions.append('%s %s %s: %s -> %s' % (name, mode, metric, base, new))
+                print('%-22s %-7s %-14s %12s %12s %8s%s' % (name, mode, metric, base, new, change, mark))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description='compiler benchmark')
+    parser.add_argument('--compiler', required=True, help='path of the compiler executable')
+    parser.add_argument('--flags', default='', help='extra compiler options, e.g. "-direct"')
+    parser.add_argument('--work-dir', default=os.path.join('build', 'bench'))
+    parser.add_argument('--baseline', default=os.path.join(BENCH_DIR, 'baseline.json'))
+    parser.add_argument('--results', default=None, help='where to write results (default: WORK_DIR/results.json)')
+    parser.add_argument('--repeat', type=int, default=3, help='compile each program this many times')
+    parser.add_argument('--update-baseline', action='store_true', help='overwrite the baseline with this run')
+    args = parser.parse_args()
+    args.flags = args.flags.split()
+    os.makedirs(args.work_dir, exist_ok=True)
+
+    failures = []
+    results = {}
+    for name, src, from_corpus in collect_programs(args.work_dir):
+        results[name] = bench_program(args, name, src, from_corpus, failures)
+
+    results_path = args.results or os.path.join(args.work_dir, 'results.json')
+    with open(results_path, 'w') as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+        f.write('\n')
+
+    if args.update_baseline:
+        with open(args.baseline, 'w') as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+            f.write('\n')
+        print('baseline written to %s' % args.baseline)
+        regressions = []
+    elif os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            regressions = compare(json.load(f), results)
+    else:
+        print('no baseline at %s, results written to %s' % (args.baseline, results_path))
+        regressions = []
+
+    for failure in failures:
+        print('FAIL: ' + failure)
+    for regression in regressions:
+        print('REGRESSION: ' + regression)
+    if failures or regressions:
+        return 1
+    print('bench passed: %d programs, results in %s' % (len(results), results_path))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
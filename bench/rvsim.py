@@ -0,0 +1,335 @@
+#!/usr/bin/env python3
+# 简单的 RV32IM 模拟器, 只支持编译器生成的汇编中用到的指令
+# 用于 benchmark 统计生成代码的动态指令数, 同时模拟 SysY 运行时库 (getint, putint 等)
+#
+# 用法: python3 rvsim.py prog.S [stdin 文件]
+# 程序的输出写到 stdout, 退出码与动态指令数写到 stderr
+
+import re
+import sys
+
+REG_NAMES = (['zero', 'ra', 'sp', 'gp', 'tp', 't0', 't1', 't2', 's0', 's1'] +
+             ['a%d' % i for i in range(8)] +
+             ['s%d' % i for i in range(2, 12)] +
+             ['t3', 't4', 't5', 't6'])
+REG = {name: i for i, name in enumerate(REG_NAMES)}
+REG.update({'x%d' % i: i for i in range(32)})
+REG['fp'] = REG['s0']
+
+MEM_RE = re.compile(r'^(-?\d+)\((\w+)\)$')
+STACK_TOP = 0x7ff00000
+DATA_BASE = 0x10000
+EXIT_PC = -1
+
+R_OPS = ('add', 'sub', 'mul', 'div', 'rem', 'and', 'or', 'xor',
+         'sll', 'srl', 'sra', 'slt', 'sltu')
+I_OPS = ('addi', 'xori', 'andi', 'ori', 'slli', 'srli', 'srai', 'slti', 'sltiu')
+B_OPS = ('beq', 'bne', 'blt', 'bge', 'bgt', 'ble')
+
+
+class SimError(Exception):
+    pass
+
+
+def s32(x):
+    x &= 0xffffffff
+    return x - 0x100000000 if x & 0x80000000 else x
+
+
+def div32(x, y):
+    if y == 0:
+        return -1
+    q = abs(x) // abs(y)
+    return s32(q if (x < 0) == (y < 0) else -q)
+
+
+def rem32(x, y):
+    if y == 0:
+        return x
+    return s32(x - div32(x, y) * y)
+
+
+class Stdin:
+    def __init__(self, text):
+        self.text = text
+        self.pos = 0
+
+    def getch(self):
+        if self.pos >= len(self.text):
+            return -1
+        ch = self.text[self.pos]
+        self.pos += 1
+        return ord(ch)
+
+    def getint(self):
+        text = self.text
+        while self.pos < len(text) and text[self.pos].isspace():
+            self.pos += 1
+        start = self.pos
+        if self.pos < len(text) and text[self.pos] in '+-':
+            self.pos += 1
+        while self.pos < len(text) and text[self.pos].isdigit():
+            self.pos += 1
+        if start == self.pos:
+            raise SimError('getint: no integer in input')
+        return s32(int(text[start:self.pos]))
+
+
+def assemble(asm):
+    """把汇编文本解析成 (指令列表, 标号表, 初始内存)"""
+    lines = []
+    labels = {}
+    mem = {}
+    section = 'text'
+    data_ptr = DATA_BASE
+    for line in asm.split('\n'):
+        line = line.split('#')[0].strip()
+        if not line:
+            continue
+        if line.endswith(':'):
+            labels[line[:-1]] = len(lines) if section == 'text' else data_ptr
+            continue
+        parts = line.replace(',', ' ').split()
+        op = parts[0]
+        if op == '.text':
+            section = 'text'
+        elif op == '.data':
+            section = 'data'
+        elif op in ('.globl', '.global', '.align', '.p2align'):
+            pass
+        elif op == '.word':
+            for word in parts[1:]:
+                mem[data_ptr] = s32(int(word, 0))
+                data_ptr += 4
+        elif op == '.zero':
+            data_ptr += int(parts[1], 0)
+        elif section == 'text':
+            lines.append((op, parts[1:]))
+        else:
+            raise SimError('unsupported directive in data section: ' + line)
+    return lines, labels, mem
+
+
+def decode(lines, labels):
+    """把指令预先解码成元组, 寄存器换成编号, 标号换成地址"""
+    def reg(name):
+        if name not in REG:
+            raise SimError('unknown register ' + name)
+        return REG[name]
+
+    def mem_operand(text):
+        m = MEM_RE.match(text)
+        if m is None:
+            raise SimError('bad memory operand ' + text)
+        return int(m.group(1)), reg(m.group(2))
+
+    def label(name):
+        if name not in labels:
+            raise SimError('unknown label ' + name)
+        return labels[name]
+
+    insts = []
+    for op, a in lines:
+        if op in ('lw', 'sw'):
+            offset, base = mem_operand(a[1])
+            insts.append((op, reg(a[0]), base, offset))
+        elif op == 'li':
+            insts.append((op, reg(a[0]), int(a[1], 0)))
+        elif op == 'la':
+            insts.append(('li', reg(a[0]), label(a[1])))
+        elif op in ('mv', 'neg', 'not', 'seqz', 'snez'):
+            insts.append((op, reg(a[0]), reg(a[1])))
+        elif op in R_OPS:
+            insts.append((op, reg(a[0]), reg(a[1]), reg(a[2])))
+        elif op in I_OPS:
+            insts.append((op, reg(a[0]), reg(a[1]), int(a[2], 0)))
+        elif op == 'j':
+            insts.append((op, label(a[0])))
+        elif op in ('beqz', 'bnez'):
+            insts.append((op, reg(a[0]), label(a[1])))
+        elif op in B_OPS:
+            insts.append((op, reg(a[0]), reg(a[1]), label(a[2])))
+        elif op in ('call', 'tail'):
+            insts.append((op, a[0], labels.get(a[0])))
+        elif op == 'ret':
+            insts.append((op,))
+        else:
+            raise SimError('unsupported instruction ' + op)
+    return insts
+
+
+def run(asm, stdin_text='', max_insts=None):
+    """运行汇编程序, 返回 (输出, 退出码, 动态指令数)"""
+    lines, labels, mem = assemble(asm)
+    insts = decode(lines, labels)
+    if 'main' not in labels:
+        raise SimError('no main function')
+    regs = [0] * 32
+    regs[REG['sp']] = STACK_TOP
+    regs[REG['ra']] = EXIT_PC
+    stdin = Stdin(stdin_text)
+    out = []
+    count = 0
+    pc = labels['main']
+
+    def call_runtime(name):
+        a0 = regs[10]
+        if name == 'getint':
+            regs[10] = stdin.getint()
+        elif name == 'getch':
+            regs[10] = stdin.getch()
+        elif name == 'getarray':
+            n = stdin.getint()
+            for i in range(n):
+                mem[(a0 + 4 * i) & 0xffffffff] = stdin.getint()
+            regs[10] = n
+        elif name == 'putint':
+            out.append(str(a0))
+        elif name == 'putch':
+            out.append(chr(a0 & 0xff))
+        elif name == 'putarray':
+            base = regs[11]
+            out.append('%d:' % a0)
+            out.extend(' %d' % mem.get((base + 4 * i) & 0xffffffff, 0) for i in range(a0))
+            out.append('\n')
+        elif name in ('starttime', 'stoptime', '_sysy_starttime', '_sysy_stoptime'):
+            pass
+        else:
+            raise SimError('unknown function ' + name)
+
+    while pc != EXIT_PC:
+        inst = insts[pc]
+        pc += 1
+        count += 1
+        op = inst[0]
+        if op == 'lw':
+            value = mem.get((regs[inst[2]] + inst[3]) & 0xffffffff, 0)
+            if inst[1]:
+                regs[inst[1]] = value
+        elif op == 'sw':
+            mem[(regs[inst[2]] + inst[3]) & 0xffffffff] = regs[inst[1]]
+        elif op == 'li':
+            if inst[1]:
+                regs[inst[1]] = s32(inst[2])
+        elif op == 'mv':
+            if inst[1]:
+                regs[inst[1]] = regs[inst[2]]
+        elif op in I_OPS:
+            x, y = regs[inst[2]], inst[3]
+            if op == 'addi':
+                v = x + y
+            elif op == 'xori':
+                v = x ^ y
+            elif op == 'andi':
+                v = x & y
+            elif op == 'ori':
+                v = x | y
+            elif op == 'slli':
+                v = x << (y & 31)
+            elif op == 'srli':
+                v = (x & 0xffffffff) >> (y & 31)
+            elif op == 'srai':
+                v = x >> (y & 31)
+            elif op == 'slti':
+                v = int(x < y)
+            else:
+                v = int((x & 0xffffffff) < (y & 0xffffffff))
+            if inst[1]:
+                regs[inst[1]] = s32(v)
+        elif op in R_OPS:
+            x, y = regs[inst[2]], regs[inst[3]]
+            if op == 'add':
+                v = x + y
+            elif op == 'sub':
+                v = x - y
+            elif op == 'mul':
+                v = x * y
+            elif op == 'div':
+                v = div32(x, y)
+            elif op == 'rem':
+                v = rem32(x, y)
+            elif op == 'and':
+                v = x & y
+            elif op == 'or':
+                v = x | y
+            elif op == 'xor':
+                v = x ^ y
+            elif op == 'sll':
+                v = x << (y & 31)
+            elif op == 'srl':
+                v = (x & 0xffffffff) >> (y & 31)
+            elif op == 'sra':
+                v = x >> (y & 31)
+            elif op == 'slt':
+                v = int(x < y)
+            else:
+                v = int((x & 0xffffffff) < (y & 0xffffffff))
+            if inst[1]:
+                regs[inst[1]] = s32(v)
+        elif op == 'seqz':
+            if inst[1]:
+                regs[inst[1]] = int(regs[inst[2]] == 0)
+        elif op == 'snez':
+            if inst[1]:
+                regs[inst[1]] = int(regs[inst[2]] != 0)
+        elif op == 'neg':
+            if inst[1]:
+                regs[inst[1]] = s32(-regs[inst[2]])
+        elif op == 'not':
+            if inst[1]:
+                regs[inst[1]] = s32(~regs[inst[2]])
+        elif op == 'j':
+            pc = inst[1]
+        elif op == 'bnez':
+            if regs[inst[1]] != 0:
+                pc = inst[2]
+        elif op == 'beqz':
+            if regs[inst[1]] == 0:
+                pc = inst[2]
+        elif op in B_OPS:
+            x, y = regs[inst[1]], regs[inst[2]]
+            if ((op == 'beq' and x == y) or (op == 'bne' and x != y) or
+                    (op == 'blt' and x < y) or (op == 'bge' and x >= y) or
+                    (op == 'bgt' and x > y) or (op == 'ble' and x <= y)):
+                pc = inst[3]
+        elif op == 'call':
+            if inst[2] is not None:
+                regs[1] = pc
+                pc = inst[2]
+            else:
+                call_runtime(inst[1])
+        elif op == 'tail':
+            if inst[2] is not None:
+                pc = inst[2]
+            else:
+                call_runtime(inst[1])
+                pc = regs[1]
+        elif op == 'ret':
+            pc = regs[1]
+        if max_insts is not None and count > max_insts:
+            raise SimError('instruction limit exceeded')
+    return ''.join(out), regs[10] & 0xff, count
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.stderr.write('usage: rvsim.py prog.S [stdin]\n')
+        return 2
+    with open(sys.argv[1]) as f:
+        asm = f.read()
+    stdin_text = ''
+    if len(sys.argv) > 2:
+        with open(sys.argv[2]) as f:
+            stdin_text = f.read()
+    try:
+        output, exit_code, count = run(asm, stdin_text)
+    except SimError as e:
+        sys.stderr.write('rvsim: %s\n' % e)
+        return 1
+    sys.stdout.write(output)
+    sys.stderr.write('[exit %d] [insts %d]\n' % (exit_code, count))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
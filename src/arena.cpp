@@ -0,0 +1,56 @@
+#include "arena.h"
+#include <algorithm>
+
+thread_local Arena raw_arena;
+
+Arena::Arena(size_t chunk_size) : cur(nullptr), end(nullptr), chunk_size(chunk_size), used(0)
+{
+}
+
+Arena::~Arena()
+{
+    release();
+}
+
+void *Arena::alloc(size_t size, size_t align)
+{
+    size_t pad = (align - reinterpret_cast<size_t>(cur) % align) % align;
+    if (cur == nullptr || pad + size > size_t(end - cur))
+    {
+        // 当前块放不下, 申请新块; 超过块大小的请求单独占用一块
+        size_t len = std::max(chunk_size, size);
+        char *chunk = new char[len];
+        chunks.push_back(chunk);
+        cur = chunk;
+        end = chunk + len;
+        pad = 0;
+    }
+    void *ret = cur + pad;
+    cur += pad + size;
+    used += size;
+    return ret;
+}
+
+const char *Arena::make_string(const std::string &str)
+{
+    char *ret = make_array<char>(str.size() + 1);
+    memcpy(ret, str.c_str(), str.size() + 1);
+    return ret;
+}
+
+void Arena::release()
+{
+    for (auto chunk : chunks)
+    {
+        delete[] chunk;
+    }
+    chunks.clear();
+    cur = nullptr;
+    end = nullptr;
+    used = 0;
+}
+
+size_t Arena::bytes_used() const
+{
+    return used;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <new>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+/**********************************************************************************************************/
+/*************************************************Arena****************************************************/
+/**********************************************************************************************************/
+
+// bump-pointer 分配器, 一次编译中所有的 raw IR 节点 (值, 类型, 基本块, 函数, 名字, slice 的缓冲区) 都从这里分配
+// 节点在内存中连续存放, 不单独释放, 由 release 或析构时整体归还
+// raw IR 都是 C 结构体, 不需要调用析构函数
+class Arena
+{
+public:
+    explicit Arena(size_t chunk_size = 1 << 16);
+    ~Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // 分配 size 字节, 按 align 对齐
+    void *alloc(size_t size, size_t align = alignof(std::max_align_t));
+
+    // 分配一个值初始化 (清零) 的 T
+    template <typename T>
+    T *make()
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return new (alloc(sizeof(T), alignof(T))) T();
+    }
+
+    // 分配 len 个未初始化的 T
+    template <typename T>
+    T *make_array(size_t len)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return static_cast<T *>(alloc(sizeof(T) * len, alignof(T)));
+    }
+
+    // 在 arena 中复制一个以 '\0' 结尾的字符串
+    const char *make_string(const std::string &str);
+
+    // 归还所有分配过的内存, 之前返回的指针全部失效
+    void release();
+
+    // 已分配的字节数
+    size_t bytes_used() const;
+
+private:
+    std::vector<char *> chunks;
+    char *cur;
+    char *end;
+    size_t chunk_size;
+    size_t used;
+};
+
+// 当前编译使用的 raw IR arena, 每个线程一个
+extern thread_local Arena raw_arena;
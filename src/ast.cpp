@@ -1,4 +1,5 @@
 #include "ast.h"
+#include "raw.h"
 
 /****************************************************************************************************************/
 /************************************************SymbolTable*****************************************************/
@@ -101,10 +102,7 @@ const char *BlockList::generate_block_name(std::string ident)
 #ifdef DEBUG
     std::cout << "BlockList::generate_block_name" << std::endl;
 #endif
-    char *name = new char[func_name.size() + ident.size() + 3];
-    name[func_name.size() + ident.size() + 2] = '\0';
-    strcpy(name, ("%" + func_name + "_" + ident).c_str());
-    return name;
+    return raw_arena.make_string("%" + func_name + "_" + ident);
 }
 
 void BlockList::init(std::string ident)
@@ -161,6 +159,11 @@ void BlockList::push_tmp_inst()
         koopa_raw_value_t inst = (koopa_raw_value_t)tmp_inst_buf[i];
         if (inst->kind.tag == KOOPA_RVT_RETURN || inst->kind.tag == KOOPA_RVT_BRANCH || inst->kind.tag == KOOPA_RVT_JUMP)
         {
+            // 被丢弃的指令不再使用它们的操作数
+            for (unsigned j = i + 1; j < tmp_inst_buf.size(); j++)
+            {
+                drop_operand_uses((koopa_raw_value_t)tmp_inst_buf[j]);
+            }
             tmp_inst_buf.erase(tmp_inst_buf.begin() + i + 1, tmp_inst_buf.end());
             break;
         }
@@ -229,6 +232,10 @@ void BlockList::rearrange_block_list()
         auto block = (koopa_raw_basic_block_data_t *)block_list[i];
         if (!is_visited[block])
         {
+            for (int j = 0; j < block->insts.len; j++)
+            {
+                drop_operand_uses((koopa_raw_value_t)block->insts.buffer[j]);
+            }
             block_list.erase(block_list.begin() + i);
             i--;
         }
@@ -280,6 +287,73 @@ bool LoopStack::is_inside_loop()
     return loop_stack.size() > 0;
 }
 
+/******************************************************************************************************************/
+/************************************************ConstPool*********************************************************/
+/******************************************************************************************************************/
+
+thread_local ConstPool const_pool;
+
+void ConstPool::enter_func()
+{
+    in_func = true;
+    small_pool.fill(nullptr);
+    pool.clear();
+}
+
+// 用函数中作为操作数出现的整数初始化常量池
+void ConstPool::enter_func(const koopa_raw_function_data_t *func)
+{
+    enter_func();
+    for (uint32_t b = 0; b < func->bbs.len; b++)
+    {
+        auto bb = (koopa_raw_basic_block_t)func->bbs.buffer[b];
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+        {
+            for_each_operand((koopa_raw_value_t)bb->insts.buffer[i], [&](koopa_raw_value_t &op)
+                             {
+                                 if (op->kind.tag == KOOPA_RVT_INTEGER && find(op->kind.data.integer.value) == nullptr)
+                                     add(op->kind.data.integer.value, (koopa_raw_value_data_t *)op); });
+        }
+    }
+}
+
+void ConstPool::exit_func()
+{
+    in_func = false;
+    small_pool.fill(nullptr);
+    pool.clear();
+}
+
+koopa_raw_value_data_t *ConstPool::find(int32_t number)
+{
+    if (!in_func)
+    {
+        return nullptr;
+    }
+    if (number >= SMALL_MIN && number < SMALL_MAX)
+    {
+        return small_pool[number - SMALL_MIN];
+    }
+    auto it = pool.find(number);
+    return it == pool.end() ? nullptr : it->second;
+}
+
+void ConstPool::add(int32_t number, koopa_raw_value_data_t *value)
+{
+    if (!in_func)
+    {
+        return;
+    }
+    if (number >= SMALL_MIN && number < SMALL_MAX)
+    {
+        small_pool[number - SMALL_MIN] = value;
+    }
+    else
+    {
+        pool[number] = value;
+    }
+}
+
 /***************************************************************************************************************/
 /************************************************GenerateIR*****************************************************/
 /***************************************************************************************************************/
@@ -300,7 +374,7 @@ void *CompUnitAST::GenerateIR_ret() const
     }
     symbol_table.del_table();
 
-    koopa_raw_program_t *ret = new koopa_raw_program_t();
+    koopa_raw_program_t *ret = raw_arena.make<koopa_raw_program_t>();
     if (values.size() == 0)
     {
         ret->values = generate_slice(KOOPA_RSIK_VALUE);
@@ -351,6 +425,7 @@ void FuncDefAST::GenerateIR_void(std::vector<const void *> &funcs) const
                             SymbolTable::Value(SymbolTable::Value::Func, (koopa_raw_function_t)ret));
 
     block_list.init(ident);
+    const_pool.enter_func();
     koopa_raw_basic_block_data_t *entry = generate_block("entry");
     block_list.add_block(entry);
     symbol_table.add_table();
@@ -398,6 +473,7 @@ void FuncDefAST::GenerateIR_void(std::vector<const void *> &funcs) const
     std::vector<const void *> blocks = block_list.get_block_list();
     ret->bbs = generate_slice(blocks, KOOPA_RSIK_BASIC_BLOCK);
     funcs.push_back(ret);
+    const_pool.exit_func();
     return;
 }
 
@@ -514,6 +590,82 @@ void ConstDeclAST::GenerateIR_void() const
     return;
 }
 
+// 局部数组的初始化. 显式给出的初值不到数组大小的一半时先 store zeroinit (后端生成清零循环), 再只为其中非 0 的元素生成 store,
+// 这样生成的指令数和编译时间都只与显式初值的个数有关, 与数组大小无关. 否则逐个元素 store, 省略的元素存 0.
+// 相邻元素共用下标相同的 getelemptr 前缀
+static void init_local_array(koopa_raw_value_t array, const ArrayInitList &init_list, const std::vector<size_t> &size_vec, size_t size)
+{
+    std::vector<koopa_raw_value_data_t *> get_vec;
+    auto store = [&](size_t i, koopa_raw_value_t value)
+    {
+        size_t tmp = i;
+        size_t tmp_size = size;
+        for (size_t j = 0; j < size_vec.size(); j++)
+        {
+            tmp_size /= size_vec[j];
+            int index = tmp / tmp_size;
+            tmp = tmp % tmp_size;
+            if (j < get_vec.size())
+            {
+                if (index == get_vec[j]->kind.data.get_elem_ptr.index->kind.data.integer.value)
+                {
+                    continue;
+                }
+                get_vec.resize(j);
+            }
+            koopa_raw_value_t src = j == 0 ? array : (koopa_raw_value_t)get_vec[j - 1];
+            koopa_raw_value_data_t *get = generate_getelemptr_inst(src, generate_number(index));
+            get_vec.push_back(get);
+            block_list.add_inst(get);
+        }
+        block_list.add_inst(generate_store_inst((koopa_raw_value_t)get_vec.back(), value));
+    };
+
+    if (init_list.size() * 2 < size)
+    {
+        block_list.add_inst(generate_store_inst(array, generate_zero_init(array->ty->data.pointer.base)));
+        for (const auto &init : init_list)
+        {
+            auto value = (koopa_raw_value_t)init.second;
+            if (value->kind.tag != KOOPA_RVT_INTEGER || value->kind.data.integer.value != 0)
+            {
+                store(init.first, value);
+            }
+        }
+        return;
+    }
+    size_t next = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (next < init_list.size() && init_list[next].first == i)
+        {
+            store(i, (koopa_raw_value_t)init_list[next++].second);
+        }
+        else
+        {
+            store(i, generate_number(0));
+        }
+    }
+}
+
+// 全局数组的初值要给出每个元素, 把省略的元素补为 0
+static std::vector<const void *> dense_array_init(const ArrayInitList &init_list, size_t size)
+{
+    std::vector<const void *> init_vec(size, nullptr);
+    for (const auto &init : init_list)
+    {
+        init_vec[init.first] = init.second;
+    }
+    for (auto &value : init_vec)
+    {
+        if (value == nullptr)
+        {
+            value = generate_number(0);
+        }
+    }
+    return init_vec;
+}
+
 void ConstDefAST::GenerateIR_void(koopa_raw_type_tag_t tag) const
 {
 #ifdef DEBUG
@@ -542,7 +694,8 @@ void ConstDefAST::GenerateIR_void(koopa_raw_type_tag_t tag) const
         symbol_table.add_symbol(ident, SymbolTable::Value(SymbolTable::Value::Array, (koopa_raw_value_t)ret));
         block_list.add_inst(ret);
 
-        std::vector<const void *> init_vec;
+        ArrayInitList init_list;
+        size_t pos = 0;
         ConstInitValAST *constinitval = dynamic_cast<ConstInitValAST *>(const_init_val.get());
         if (constinitval->type == ConstInitValAST::EMPTY)
         {
@@ -551,45 +704,13 @@ void ConstDefAST::GenerateIR_void(koopa_raw_type_tag_t tag) const
         }
         else
         {
-            const_init_val->ArrayInit(init_vec, size_vec);
-            if (init_vec.size() != size)
+            const_init_val->ArrayInit(init_list, pos, size_vec, true);
+            if (pos != size)
             {
                 std::cout << "Error: Array size not match" << std::endl;
                 assert(0);
             }
-            std::vector<koopa_raw_value_data_t *> get_vec;
-            for (int i = 0; i < size; i++)
-            {
-                int tmp = i;
-                int tmp_size = size;
-                for (int j = 0; j < size_vec.size(); j++)
-                {
-                    tmp_size /= size_vec[j];
-                    int index = tmp / tmp_size;
-                    tmp = tmp % tmp_size;
-                    if (j < get_vec.size())
-                    {
-                        if (index == get_vec[j]->kind.data.get_elem_ptr.index->kind.data.integer.value)
-                        {
-                            continue;
-                        }
-                        else
-                        {
-                            while (j < get_vec.size())
-                            {
-                                get_vec.pop_back();
-                            }
-                        }
-                    }
-                    koopa_raw_value_t src = j == 0 ? (koopa_raw_value_t)ret : (koopa_raw_value_t)get_vec[j - 1];
-                    koopa_raw_value_data_t *get = generate_getelemptr_inst(src, generate_number(index));
-                    get_vec.push_back(get);
-                    block_list.add_inst(get);
-                }
-                koopa_raw_value_data_t *store =
-                    generate_store_inst((koopa_raw_value_t)get_vec[size_vec.size() - 1], (koopa_raw_value_t)init_vec[i]);
-                block_list.add_inst(store);
-            }
+            init_local_array(ret, init_list, size_vec, size);
         }
         return;
     }
@@ -598,12 +719,12 @@ void ConstDefAST::GenerateIR_void(koopa_raw_type_tag_t tag) const
 void *ConstInitValAST::GenerateIR_ret(std::vector<const void *> &init_vec, std::vector<size_t> size_vec, int level) const
 {
     assert(type == ARRAY);
-    std::vector<const void *> *init_val = new std::vector<const void *>();
+    std::vector<const void *> init_val;
     if (level == size_vec.size() - 1)
     {
         for (int i = 0; i < size_vec[level]; i++)
         {
-            init_val->push_back(*init_vec.begin());
+            init_val.push_back(*init_vec.begin());
             init_vec.erase(init_vec.begin());
         }
     }
@@ -611,7 +732,7 @@ void *ConstInitValAST::GenerateIR_ret(std::vector<const void *> &init_vec, std::
     {
         for (int i = 0; i < size_vec[level]; i++)
         {
-            init_val->push_back(GenerateIR_ret(init_vec, size_vec, level + 1));
+            init_val.push_back(GenerateIR_ret(init_vec, size_vec, level + 1));
         }
     }
     std::vector<size_t> sub_size_vec;
@@ -619,7 +740,7 @@ void *ConstInitValAST::GenerateIR_ret(std::vector<const void *> &init_vec, std::
     {
         sub_size_vec.push_back(size_vec[i]);
     }
-    koopa_raw_slice_t elements = generate_slice(*init_val, KOOPA_RSIK_VALUE);
+    koopa_raw_slice_t elements = generate_slice(init_val, KOOPA_RSIK_VALUE);
     koopa_raw_value_data_t *ret = generate_aggregate(generate_linked_list_type(generate_type(KOOPA_RTT_INT32), sub_size_vec), elements);
     return ret;
 }
@@ -678,7 +799,8 @@ void VarDefAST::GenerateIR_void(koopa_raw_type_tag_t tag) const
 
         if (is_init)
         {
-            std::vector<const void *> init_vec;
+            ArrayInitList init_list;
+            size_t pos = 0;
             InitValAST *initval = dynamic_cast<InitValAST *>(init_val.get());
             if (initval->type == InitValAST::EMPTY)
             {
@@ -687,45 +809,14 @@ void VarDefAST::GenerateIR_void(koopa_raw_type_tag_t tag) const
             }
             else
             {
-                init_val->ArrayInit(init_vec, size_vec);
-                if (init_vec.size() != size)
+                // 局部变量的初值在运行时求值
+                init_val->ArrayInit(init_list, pos, size_vec, false);
+                if (pos != size)
                 {
                     std::cout << "Error: Array size not match" << std::endl;
                     assert(0);
                 }
-                std::vector<koopa_raw_value_data_t *> get_vec;
-                for (int i = 0; i < size; i++)
-                {
-                    int tmp = i;
-                    int tmp_size = size;
-                    for (int j = 0; j < size_vec.size(); j++)
-                    {
-                        tmp_size /= size_vec[j];
-                        int index = tmp / tmp_size;
-                        tmp = tmp % tmp_size;
-                        if (j < get_vec.size())
-                        {
-                            if (index == get_vec[j]->kind.data.get_elem_ptr.index->kind.data.integer.value)
-                            {
-                                continue;
-                            }
-                            else
-                            {
-                                while (j < get_vec.size())
-                                {
-                                    get_vec.pop_back();
-                                }
-                            }
-                        }
-                        koopa_raw_value_t src = j == 0 ? (koopa_raw_value_t)ret : (koopa_raw_value_t)get_vec[j - 1];
-                        koopa_raw_value_data_t *get = generate_getelemptr_inst(src, generate_number(index));
-                        get_vec.push_back(get);
-                        block_list.add_inst(get);
-                    }
-                    koopa_raw_value_data_t *store =
-                        generate_store_inst((koopa_raw_value_t)get_vec[size_vec.size() - 1], (koopa_raw_value_t)init_vec[i]);
-                    block_list.add_inst(store);
-                }
+                init_local_array(ret, init_list, size_vec, size);
             }
         }
         else
@@ -740,12 +831,12 @@ void VarDefAST::GenerateIR_void(koopa_raw_type_tag_t tag) const
 void *InitValAST::GenerateIR_ret(std::vector<const void *> &init_vec, std::vector<size_t> size_vec, int level) const
 {
     assert(type == ARRAY);
-    std::vector<const void *> *init_val = new std::vector<const void *>();
+    std::vector<const void *> init_val;
     if (level == size_vec.size() - 1)
     {
         for (int i = 0; i < size_vec[level]; i++)
         {
-            init_val->push_back(*init_vec.begin());
+            init_val.push_back(*init_vec.begin());
             init_vec.erase(init_vec.begin());
         }
     }
@@ -753,7 +844,7 @@ void *InitValAST::GenerateIR_ret(std::vector<const void *> &init_vec, std::vecto
     {
         for (int i = 0; i < size_vec[level]; i++)
         {
-            init_val->push_back(GenerateIR_ret(init_vec, size_vec, level + 1));
+            init_val.push_back(GenerateIR_ret(init_vec, size_vec, level + 1));
         }
     }
     std::vector<size_t> sub_size_vec;
@@ -761,7 +852,7 @@ void *InitValAST::GenerateIR_ret(std::vector<const void *> &init_vec, std::vecto
     {
         sub_size_vec.push_back(size_vec[i]);
     }
-    koopa_raw_slice_t elements = generate_slice(*init_val, KOOPA_RSIK_VALUE);
+    koopa_raw_slice_t elements = generate_slice(init_val, KOOPA_RSIK_VALUE);
     koopa_raw_value_data_t *ret = generate_aggregate(generate_linked_list_type(generate_type(KOOPA_RTT_INT32), sub_size_vec), elements);
     return ret;
 }
@@ -807,9 +898,7 @@ void StmtAST::GenerateIR_void() const
     {
         // check_return 是因为有可能有if，else里面出现return导致后面的块不会执行的问题
         // rearrange_block_list 其实可以解决这个问题。但是这里还是加上了check_return
-        koopa_raw_value_data_t *ret = (koopa_raw_value_data_t *)exp->GenerateIR_ret();
-        koopa_raw_basic_block_data_t *false_block =
-            (koopa_raw_basic_block_data_t *)ret->kind.data.branch.false_bb;
+        koopa_raw_basic_block_data_t *false_block = (koopa_raw_basic_block_data_t *)exp->GenerateIR_ret();
         bool true_block_no_return = block_list.check_return();
         if (stmt != nullptr)
         {
@@ -854,14 +943,14 @@ void *IfExpAST::GenerateIR_ret() const
 #ifdef DEBUG
     std::cout << "IfExp" << std::endl;
 #endif
-    koopa_raw_value_t cond = (koopa_raw_value_t)exp->GenerateIR_ret();
-    koopa_raw_value_data_t *ret =
-        generate_branch_inst(cond, generate_block("true"), generate_block("false"));
-    block_list.add_inst(ret);
+    // 返回 false 基本块, 由 StmtAST 接着生成 else 部分
+    koopa_raw_basic_block_data_t *true_block = generate_block("true");
+    koopa_raw_basic_block_data_t *false_block = generate_block("false");
+    exp->GenerateIR_cond(true_block, false_block);
     block_list.push_tmp_inst();
-    block_list.add_block((koopa_raw_basic_block_data_t *)ret->kind.data.branch.true_bb);
+    block_list.add_block(true_block);
     stmt->GenerateIR_void();
-    return ret;
+    return false_block;
 }
 
 void WhileExpAST::GenerateIR_void() const
@@ -879,9 +968,7 @@ void WhileExpAST::GenerateIR_void() const
         block_list.add_inst(generate_jump_inst(cond_block));
         block_list.push_tmp_inst();
         block_list.add_block(cond_block);
-        koopa_raw_value_t cond = (koopa_raw_value_t)exp->GenerateIR_ret();
-        koopa_raw_value_data_t *ret = generate_branch_inst(cond, body_block, end_block);
-        block_list.add_inst(ret);
+        exp->GenerateIR_cond(body_block, end_block);
         block_list.push_tmp_inst();
         block_list.add_block(body_block);
         stmt->GenerateIR_void();
@@ -1018,84 +1105,85 @@ void *ExpAST::GenerateIR_ret() const
     return lor_exp->GenerateIR_ret();
 }
 
+void BaseAST::GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const
+{
+    koopa_raw_value_t cond = (koopa_raw_value_t)GenerateIR_ret();
+    block_list.add_inst(generate_branch_inst(cond, true_bb, false_bb));
+}
+
+void ExpAST::GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const
+{
+    lor_exp->GenerateIR_cond(true_bb, false_bb);
+}
+
+// 逻辑表达式的值: 作为条件分别跳到 true 和 false, 两者以 1 和 0 跳到 end, 结果是 end 的参数
+static void *generate_logic_value(const BaseAST *exp)
+{
+    koopa_raw_basic_block_data_t *true_block = generate_block("true");
+    koopa_raw_basic_block_data_t *false_block = generate_block("false");
+    koopa_raw_basic_block_data_t *end_block = generate_block("end");
+    koopa_raw_value_data_t *result = generate_block_param(end_block, generate_type(KOOPA_RTT_INT32));
+    exp->GenerateIR_cond(true_block, false_block);
+
+    block_list.push_tmp_inst();
+    block_list.add_block(true_block);
+    block_list.add_inst(generate_jump_inst(end_block, {generate_number(1)}));
+    block_list.push_tmp_inst();
+    block_list.add_block(false_block);
+    block_list.add_inst(generate_jump_inst(end_block, {generate_number(0)}));
+    block_list.push_tmp_inst();
+    block_list.add_block(end_block);
+    return result;
+}
+
 void *LOrExpAST::GenerateIR_ret() const
 {
-// int result = 1;
-// if (lhs == 0) {
-//   result = rhs != 0;
-// }
-// 表达式的结果即是 result
 #ifdef DEBUG
     std::cout << "LOrExp" << std::endl;
 #endif
     if (type == 1)
         return land_exp->GenerateIR_ret();
-    koopa_raw_value_data_t *result = generate_alloc_inst("result", generate_type(KOOPA_RTT_INT32));
-    block_list.add_inst(result);
-
-    koopa_raw_value_data_t *store_1 = generate_store_inst((koopa_raw_value_t)result, (koopa_raw_value_t)generate_number(1));
-    block_list.add_inst(store_1);
-
-    koopa_raw_value_data_t *branch =
-        generate_branch_inst((koopa_raw_value_t)lor_exp->GenerateIR_ret(), generate_block("end"), generate_block("true"));
-    block_list.add_inst(branch);
-
-    block_list.push_tmp_inst();
-    block_list.add_block((koopa_raw_basic_block_data_t *)branch->kind.data.branch.false_bb);
-    koopa_raw_value_data_t *true_exp =
-        generate_binary_inst((koopa_raw_value_t)land_exp->GenerateIR_ret(), (koopa_raw_value_t)generate_number(0), KOOPA_RBO_NOT_EQ);
-    block_list.add_inst(true_exp);
-
-    koopa_raw_value_data_t *store_rhs =
-        generate_store_inst((koopa_raw_value_t)result, (koopa_raw_value_t)true_exp);
-    block_list.add_inst(store_rhs);
-    block_list.add_inst(generate_jump_inst((koopa_raw_basic_block_data_t *)branch->kind.data.branch.true_bb));
+    return generate_logic_value(this);
+}
 
+void LOrExpAST::GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const
+{
+    // lhs 非 0 时直接跳到 true_bb, 否则再判断 rhs
+    if (type == 1)
+    {
+        land_exp->GenerateIR_cond(true_bb, false_bb);
+        return;
+    }
+    koopa_raw_basic_block_data_t *rhs_block = generate_block("lor_rhs");
+    lor_exp->GenerateIR_cond(true_bb, rhs_block);
     block_list.push_tmp_inst();
-    block_list.add_block((koopa_raw_basic_block_data_t *)branch->kind.data.branch.true_bb);
-    koopa_raw_value_data_t *load_result = generate_load_inst((koopa_raw_value_t)result);
-    block_list.add_inst(load_result);
-    return load_result;
+    block_list.add_block(rhs_block);
+    land_exp->GenerateIR_cond(true_bb, false_bb);
 }
 
 void *LAndExpAST::GenerateIR_ret() const
 {
-// int result = 0;
-// if (lhs == 1) {
-//   result = rhs != 0;
-// }
-// 表达式的结果即是 result
 #ifdef DEBUG
     std::cout << "LAndExp" << std::endl;
 #endif
     if (type == 1)
         return eq_exp->GenerateIR_ret();
-    koopa_raw_value_data_t *result = generate_alloc_inst("result", generate_type(KOOPA_RTT_INT32));
-    block_list.add_inst(result);
-
-    koopa_raw_value_data_t *store_0 = generate_store_inst((koopa_raw_value_t)result, (koopa_raw_value_t)generate_number(0));
-    block_list.add_inst(store_0);
-
-    koopa_raw_value_data_t *branch =
-        generate_branch_inst((koopa_raw_value_t)land_exp->GenerateIR_ret(), generate_block("true"), generate_block("end"));
-    block_list.add_inst(branch);
-
-    block_list.push_tmp_inst();
-    block_list.add_block((koopa_raw_basic_block_data_t *)branch->kind.data.branch.true_bb);
-    koopa_raw_value_data_t *true_exp =
-        generate_binary_inst((koopa_raw_value_t)eq_exp->GenerateIR_ret(), (koopa_raw_value_t)generate_number(0), KOOPA_RBO_NOT_EQ);
-    block_list.add_inst(true_exp);
-
-    koopa_raw_value_data_t *store_rhs =
-        generate_store_inst((koopa_raw_value_t)result, (koopa_raw_value_t)true_exp);
-    block_list.add_inst(store_rhs);
-    block_list.add_inst(generate_jump_inst((koopa_raw_basic_block_data_t *)branch->kind.data.branch.false_bb));
+    return generate_logic_value(this);
+}
 
+void LAndExpAST::GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const
+{
+    // lhs 为 0 时直接跳到 false_bb, 否则再判断 rhs
+    if (type == 1)
+    {
+        eq_exp->GenerateIR_cond(true_bb, false_bb);
+        return;
+    }
+    koopa_raw_basic_block_data_t *rhs_block = generate_block("land_rhs");
+    land_exp->GenerateIR_cond(rhs_block, false_bb);
     block_list.push_tmp_inst();
-    block_list.add_block((koopa_raw_basic_block_data_t *)branch->kind.data.branch.false_bb);
-    koopa_raw_value_data_t *load_result = generate_load_inst((koopa_raw_value_t)result);
-    block_list.add_inst(load_result);
-    return load_result;
+    block_list.add_block(rhs_block);
+    eq_exp->GenerateIR_cond(true_bb, false_bb);
 }
 
 void *EqExpAST::GenerateIR_ret() const
@@ -1121,6 +1209,16 @@ void *EqExpAST::GenerateIR_ret() const
     return ret;
 }
 
+void EqExpAST::GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const
+{
+    if (type == 1)
+    {
+        rel_exp->GenerateIR_cond(true_bb, false_bb);
+        return;
+    }
+    BaseAST::GenerateIR_cond(true_bb, false_bb);
+}
+
 void *RelExpAST::GenerateIR_ret() const
 {
 #ifdef DEBUG
@@ -1152,6 +1250,16 @@ void *RelExpAST::GenerateIR_ret() const
     return ret;
 }
 
+void RelExpAST::GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const
+{
+    if (type == 1)
+    {
+        add_exp->GenerateIR_cond(true_bb, false_bb);
+        return;
+    }
+    BaseAST::GenerateIR_cond(true_bb, false_bb);
+}
+
 void *AddExpAST::GenerateIR_ret() const
 {
 #ifdef DEBUG
@@ -1175,6 +1283,16 @@ void *AddExpAST::GenerateIR_ret() const
     return ret;
 }
 
+void AddExpAST::GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const
+{
+    if (type == 1)
+    {
+        mul_exp->GenerateIR_cond(true_bb, false_bb);
+        return;
+    }
+    BaseAST::GenerateIR_cond(true_bb, false_bb);
+}
+
 void *MulExpAST::GenerateIR_ret() const
 {
 #ifdef DEBUG
@@ -1202,6 +1320,16 @@ void *MulExpAST::GenerateIR_ret() const
     return ret;
 }
 
+void MulExpAST::GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const
+{
+    if (type == 1)
+    {
+        unary_exp->GenerateIR_cond(true_bb, false_bb);
+        return;
+    }
+    BaseAST::GenerateIR_cond(true_bb, false_bb);
+}
+
 void *UnaryExpAST::GenerateIR_ret() const
 {
 #ifdef DEBUG
@@ -1249,6 +1377,27 @@ void *UnaryExpAST::GenerateIR_ret() const
     return nullptr;
 }
 
+void UnaryExpAST::GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const
+{
+    // 括号中的表达式可能是逻辑表达式, ! 交换两个目标
+    if (type == PRIMARY)
+    {
+        primary_exp->GenerateIR_cond(true_bb, false_bb);
+        return;
+    }
+    if (type == UNARY && unary_op == "+")
+    {
+        unary_exp->GenerateIR_cond(true_bb, false_bb);
+        return;
+    }
+    if (type == UNARY && unary_op == "!")
+    {
+        unary_exp->GenerateIR_cond(false_bb, true_bb);
+        return;
+    }
+    BaseAST::GenerateIR_cond(true_bb, false_bb);
+}
+
 void *PrimaryExpAST::GenerateIR_ret() const
 {
 #ifdef DEBUG
@@ -1262,6 +1411,16 @@ void *PrimaryExpAST::GenerateIR_ret() const
         return generate_number(number);
 }
 
+void PrimaryExpAST::GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const
+{
+    if (type == 1)
+    {
+        exp->GenerateIR_cond(true_bb, false_bb);
+        return;
+    }
+    BaseAST::GenerateIR_cond(true_bb, false_bb);
+}
+
 /*******************************************************************************************************************/
 /************************************************CalculateValue*****************************************************/
 /*******************************************************************************************************************/
@@ -1440,7 +1599,8 @@ void ConstDefAST::GenerateGlobalValues(std::vector<const void *> &values, koopa_
             size *= tmp;
         }
 
-        std::vector<const void *> init_vec;
+        ArrayInitList init_list;
+        size_t pos = 0;
         ConstInitValAST *constinitval = dynamic_cast<ConstInitValAST *>(const_init_val.get());
         koopa_raw_value_t init;
         if (constinitval->type == ConstInitValAST::EMPTY)
@@ -1449,12 +1609,13 @@ void ConstDefAST::GenerateGlobalValues(std::vector<const void *> &values, koopa_
         }
         else
         {
-            const_init_val->ArrayInit(init_vec, size_vec);
-            if (init_vec.size() != size)
+            const_init_val->ArrayInit(init_list, pos, size_vec, true);
+            if (pos != size)
             {
                 std::cout << "Error: Array size not match" << std::endl;
                 assert(0);
             }
+            std::vector<const void *> init_vec = dense_array_init(init_list, size);
             init = (koopa_raw_value_t)const_init_val->GenerateIR_ret(init_vec, size_vec, 0);
         }
         koopa_raw_value_data_t *ret = generate_global_alloc(ident, init, (generate_linked_list_type(generate_type(tag), size_vec)));
@@ -1492,7 +1653,9 @@ void VarDefAST::GenerateGlobalValues(std::vector<const void *> &values, koopa_ra
         koopa_raw_value_t value;
         if (is_init)
         {
-            value = (koopa_raw_value_t)init_val->GenerateIR_ret();
+            // 全局变量的初值是常量表达式, 在编译时求值, 不能生成指令
+            InitValAST *initval = dynamic_cast<InitValAST *>(init_val.get());
+            value = generate_number(initval->exp->CalculateValue());
         }
         else
         {
@@ -1518,7 +1681,8 @@ void VarDefAST::GenerateGlobalValues(std::vector<const void *> &values, koopa_ra
         koopa_raw_value_t init;
         if (is_init)
         {
-            std::vector<const void *> init_vec;
+            ArrayInitList init_list;
+            size_t pos = 0;
             InitValAST *initval = dynamic_cast<InitValAST *>(init_val.get());
             if (initval->type == InitValAST::EMPTY)
             {
@@ -1526,12 +1690,13 @@ void VarDefAST::GenerateGlobalValues(std::vector<const void *> &values, koopa_ra
             }
             else
             {
-                init_val->ArrayInit(init_vec, size_vec);
-                if (init_vec.size() != size)
+                init_val->ArrayInit(init_list, pos, size_vec, true);
+                if (pos != size)
                 {
                     std::cout << "Error: Array size not match" << std::endl;
                     assert(0);
                 }
+                std::vector<const void *> init_vec = dense_array_init(init_list, size);
                 init = (koopa_raw_value_t)init_val->GenerateIR_ret(init_vec, size_vec, 0);
             }
         }
@@ -1675,7 +1840,7 @@ void *LValAST::GetLeftValue() const
     return nullptr;
 }
 
-void ConstInitValAST::ArrayInit(std::vector<const void *> &init_vec, std::vector<size_t> size_vec) const
+void ConstInitValAST::ArrayInit(ArrayInitList &init_list, size_t &pos, std::vector<size_t> size_vec, bool is_const) const
 {
     if (type != EMPTY)
     {
@@ -1684,11 +1849,11 @@ void ConstInitValAST::ArrayInit(std::vector<const void *> &init_vec, std::vector
             ConstInitValAST *init_val = dynamic_cast<ConstInitValAST *>((*init).get());
             if (init_val->type == ConstInitValAST::INT)
             {
-                init_vec.push_back(generate_number(init_val->const_exp->CalculateValue()));
+                init_list.push_back({pos++, generate_number(init_val->const_exp->CalculateValue())});
             }
             else if (init_val->type == ConstInitValAST::ARRAY || init_val->type == ConstInitValAST::EMPTY)
             {
-                int cur_size = init_vec.size();
+                int cur_size = pos;
                 int len_n = size_vec.back();
                 assert(len_n != 0);
                 if (cur_size % len_n != 0)
@@ -1713,7 +1878,7 @@ void ConstInitValAST::ArrayInit(std::vector<const void *> &init_vec, std::vector
                 {
                     sub_size_vec.push_back(size_vec[i]);
                 }
-                init_val->ArrayInit(init_vec, sub_size_vec);
+                init_val->ArrayInit(init_list, pos, sub_size_vec, is_const);
             }
         }
     }
@@ -1724,23 +1889,19 @@ void ConstInitValAST::ArrayInit(std::vector<const void *> &init_vec, std::vector
         {
             size *= size_vec[i];
         }
-        for (int i = 0; i < size; i++)
-        {
-            init_vec.push_back(generate_number(0));
-        }
+        // 省略的元素为 0, 不记录
+        pos += size;
     }
     int total_size = 1;
     for (auto size = size_vec.begin(); size != size_vec.end(); size++)
     {
         total_size *= (*size);
     }
-    while (init_vec.size() % total_size != 0)
-    {
-        init_vec.push_back(generate_number(0));
-    }
+    // 跳过补齐到 total_size 的倍数的部分
+    pos = (pos + total_size - 1) / total_size * total_size;
 }
 
-void InitValAST::ArrayInit(std::vector<const void *> &init_vec, std::vector<size_t> size_vec) const
+void InitValAST::ArrayInit(ArrayInitList &init_list, size_t &pos, std::vector<size_t> size_vec, bool is_const) const
 {
     if (type != EMPTY)
     {
@@ -1755,11 +1916,12 @@ void InitValAST::ArrayInit(std::vector<const void *> &init_vec, std::vector<size
 #endif
             if (init_val->type == InitValAST::INT)
             {
-                init_vec.push_back(generate_number(init_val->exp->CalculateValue()));
+                const void *value = is_const ? generate_number(init_val->exp->CalculateValue()) : init_val->exp->GenerateIR_ret();
+                init_list.push_back({pos++, value});
             }
             else if (init_val->type == InitValAST::ARRAY || init_val->type == InitValAST::EMPTY)
             {
-                int cur_size = init_vec.size();
+                int cur_size = pos;
                 int len_n = size_vec.back();
 #ifdef DEBUG2
                 std::cout << "cur_size = " << cur_size << std::endl;
@@ -1791,7 +1953,7 @@ void InitValAST::ArrayInit(std::vector<const void *> &init_vec, std::vector<size
                 {
                     sub_size_vec.push_back(size_vec[i]);
                 }
-                init_val->ArrayInit(init_vec, sub_size_vec);
+                init_val->ArrayInit(init_list, pos, sub_size_vec, is_const);
             }
         }
     }
@@ -1802,28 +1964,21 @@ void InitValAST::ArrayInit(std::vector<const void *> &init_vec, std::vector<size
         {
             size *= size_vec[i];
         }
-        for (int i = 0; i < size; i++)
-        {
-            init_vec.push_back(generate_number(0));
-        }
+        // 省略的元素为 0, 不记录
+        pos += size;
     }
     int total_size = 1;
     for (auto size = size_vec.begin(); size != size_vec.end(); size++)
     {
         total_size *= (*size);
     }
-    while (init_vec.size() % total_size != 0)
-    {
-        init_vec.push_back(generate_number(0));
-    }
+    // 跳过补齐到 total_size 的倍数的部分
+    pos = (pos + total_size - 1) / total_size * total_size;
 }
 
 const char *generate_var_name(std::string ident)
 {
-    char *ret = new char[ident.size() + 2];
-    ret[ident.size() + 1] = '\0';
-    strcpy(ret, ("@" + ident).c_str());
-    return ret;
+    return raw_arena.make_string("@" + ident);
 }
 
 koopa_raw_slice_t generate_slice(koopa_raw_slice_item_kind_t kind)
@@ -1840,7 +1995,7 @@ koopa_raw_slice_t generate_slice(std::vector<const void *> &vec,
 {
     koopa_raw_slice_t ret;
     ret.kind = kind;
-    ret.buffer = new const void *[vec.size()];
+    ret.buffer = raw_arena.make_array<const void *>(vec.size());
     std::copy(vec.begin(), vec.end(), ret.buffer);
     ret.len = vec.size();
     return ret;
@@ -1850,7 +2005,7 @@ koopa_raw_slice_t generate_slice(const void *data, koopa_raw_slice_item_kind_t k
 {
     koopa_raw_slice_t ret;
     ret.kind = kind;
-    ret.buffer = new const void *[1];
+    ret.buffer = raw_arena.make_array<const void *>(1);
     ret.buffer[0] = data;
     ret.len = 1;
     return ret;
@@ -1858,66 +2013,54 @@ koopa_raw_slice_t generate_slice(const void *data, koopa_raw_slice_item_kind_t k
 
 koopa_raw_type_t generate_type(koopa_raw_type_tag_t tag)
 {
-    koopa_raw_type_kind_t *ret = new koopa_raw_type_kind_t();
-    ret->tag = tag;
-    return (koopa_raw_type_t)ret;
+    return type_table.get_type(tag);
 }
 
 koopa_raw_type_t generate_type_pointer(koopa_raw_type_t base)
 {
-    koopa_raw_type_kind_t *ret = new koopa_raw_type_kind_t();
-    ret->tag = KOOPA_RTT_POINTER;
-    ret->data.pointer.base = base;
-    return (koopa_raw_type_t)ret;
+    return type_table.get_pointer(base);
 }
 
 koopa_raw_type_t generate_type_array(koopa_raw_type_t base, size_t size)
 {
-    koopa_raw_type_kind_t *ret = new koopa_raw_type_kind_t();
-    ret->tag = KOOPA_RTT_ARRAY;
-    ret->data.array.base = base;
-    ret->data.array.len = size;
-    return (koopa_raw_type_t)ret;
+    return type_table.get_array(base, size);
 }
 
 koopa_raw_type_t generate_type_func(koopa_raw_type_t func_type, koopa_raw_slice_t params)
 {
-    koopa_raw_type_kind_t *ret = new koopa_raw_type_kind_t();
-    ret->tag = KOOPA_RTT_FUNCTION;
-    ret->data.function.ret = func_type;
-    ret->data.function.params = params;
-    return (koopa_raw_type_t)ret;
+    return type_table.get_function(func_type, params);
 }
 
 koopa_raw_type_t generate_linked_list_type(koopa_raw_type_t base, std::vector<size_t> size_vec)
 {
-    std::vector<koopa_raw_type_kind_t *> type_vec;
     koopa_raw_type_t last = base;
     for (auto size = size_vec.rbegin(); size != size_vec.rend(); size++)
     {
-        koopa_raw_type_kind_t *type = new koopa_raw_type_kind_t();
-        type->tag = KOOPA_RTT_ARRAY;
-        type->data.array.len = *size;
-        type->data.array.base = last;
-        last = type;
+        last = type_table.get_array(last, *size);
     }
     return last;
 }
 
 koopa_raw_value_data_t *generate_number(int32_t number)
 {
-    koopa_raw_value_data_t *ret = new koopa_raw_value_data();
+    koopa_raw_value_data_t *ret = const_pool.find(number);
+    if (ret != nullptr)
+    {
+        return ret;
+    }
+    ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = generate_type(KOOPA_RTT_INT32);
     ret->name = nullptr;
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
     ret->kind.tag = KOOPA_RVT_INTEGER;
     ret->kind.data.integer.value = number;
+    const_pool.add(number, ret);
     return ret;
 }
 
 koopa_raw_value_data_t *generate_zero_init(koopa_raw_type_t type)
 {
-    koopa_raw_value_data_t *ret = new koopa_raw_value_data();
+    koopa_raw_value_data_t *ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = type;
     ret->name = nullptr;
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
@@ -1927,18 +2070,22 @@ koopa_raw_value_data_t *generate_zero_init(koopa_raw_type_t type)
 
 koopa_raw_value_data_t *generate_aggregate(koopa_raw_type_t type, koopa_raw_slice_t elements)
 {
-    koopa_raw_value_data *ret = new koopa_raw_value_data();
+    koopa_raw_value_data *ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = type;
     ret->name = nullptr;
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
     ret->kind.tag = KOOPA_RVT_AGGREGATE;
     ret->kind.data.aggregate.elems = elements;
+    for (uint32_t i = 0; i < elements.len; i++)
+    {
+        add_use((koopa_raw_value_t)elements.buffer[i], ret);
+    }
     return ret;
 }
 
 koopa_raw_value_data_t *generate_func_arg_ref(koopa_raw_type_t ty, std::string ident)
 {
-    koopa_raw_value_data_t *ret = new koopa_raw_value_data();
+    koopa_raw_value_data_t *ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = ty;
     ret->name = generate_var_name(ident);
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
@@ -1949,7 +2096,7 @@ koopa_raw_value_data_t *generate_func_arg_ref(koopa_raw_type_t ty, std::string i
 
 koopa_raw_function_data_t *generate_function_decl(std::string ident, std::vector<const void *> &params_ty, koopa_raw_type_t func_type)
 {
-    koopa_raw_function_data_t *ret = new koopa_raw_function_data_t();
+    koopa_raw_function_data_t *ret = raw_arena.make<koopa_raw_function_data_t>();
     koopa_raw_slice_t params;
     if (params_ty.size() == 0)
     {
@@ -1968,7 +2115,7 @@ koopa_raw_function_data_t *generate_function_decl(std::string ident, std::vector
 
 koopa_raw_function_data_t *generate_function(std::string ident, std::vector<const void *> &params, koopa_raw_type_t func_type)
 {
-    koopa_raw_function_data_t *ret = new koopa_raw_function_data_t();
+    koopa_raw_function_data_t *ret = raw_arena.make<koopa_raw_function_data_t>();
     koopa_raw_slice_t params_type;
     if (params.size() == 0)
     {
@@ -1992,7 +2139,7 @@ koopa_raw_function_data_t *generate_function(std::string ident, std::vector<cons
 
 koopa_raw_basic_block_data_t *generate_block(std::string name)
 {
-    koopa_raw_basic_block_data_t *ret = new koopa_raw_basic_block_data_t();
+    koopa_raw_basic_block_data_t *ret = raw_arena.make<koopa_raw_basic_block_data_t>();
     ret->name = block_list.generate_block_name(name);
     ret->insts.buffer = nullptr;
     ret->insts.len = 0;
@@ -2001,20 +2148,39 @@ koopa_raw_basic_block_data_t *generate_block(std::string name)
     return ret;
 }
 
+// 在基本块末尾新增一个参数
+koopa_raw_value_data_t *generate_block_param(koopa_raw_basic_block_data_t *block, koopa_raw_type_t ty)
+{
+    koopa_raw_value_data_t *ret = raw_arena.make<koopa_raw_value_data_t>();
+    ret->ty = ty;
+    ret->name = nullptr;
+    ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
+    ret->kind.tag = KOOPA_RVT_BLOCK_ARG_REF;
+    ret->kind.data.block_arg_ref.index = block->params.len;
+    std::vector<const void *> params(block->params.buffer, block->params.buffer + block->params.len);
+    params.push_back(ret);
+    block->params = generate_slice(params, KOOPA_RSIK_VALUE);
+    return ret;
+}
+
 koopa_raw_value_data_t *generate_global_alloc(std::string ident, koopa_raw_value_t value, koopa_raw_type_t base)
 {
-    koopa_raw_value_data_t *ret = new koopa_raw_value_data();
+    koopa_raw_value_data_t *ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = generate_type_pointer(base);
     ret->name = generate_var_name(ident);
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
     ret->kind.tag = KOOPA_RVT_GLOBAL_ALLOC;
     ret->kind.data.global_alloc.init = value;
+    if (value != nullptr)
+    {
+        add_use(value, ret);
+    }
     return ret;
 }
 
 koopa_raw_value_data_t *generate_alloc_inst(std::string ident, koopa_raw_type_t base)
 {
-    koopa_raw_value_data_t *ret = new koopa_raw_value_data();
+    koopa_raw_value_data_t *ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = generate_type_pointer(base);
     ret->name = generate_var_name(ident);
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
@@ -2024,7 +2190,7 @@ koopa_raw_value_data_t *generate_alloc_inst(std::string ident, koopa_raw_type_t
 
 koopa_raw_value_data_t *generate_getelemptr_inst(koopa_raw_value_t src, koopa_raw_value_t index)
 {
-    koopa_raw_value_data_t *ret = new koopa_raw_value_data();
+    koopa_raw_value_data_t *ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = generate_type_pointer(src->ty->data.pointer.base->data.array.base);
     ret->name = nullptr;
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
@@ -2034,12 +2200,13 @@ koopa_raw_value_data_t *generate_getelemptr_inst(koopa_raw_value_t src, koopa_ra
 #endif
     ret->kind.data.get_elem_ptr.src = src;
     ret->kind.data.get_elem_ptr.index = index;
+    add_operand_uses(ret);
     return ret;
 }
 
 koopa_raw_value_data_t *generate_getptr_inst(koopa_raw_value_t src, koopa_raw_value_t index)
 {
-    koopa_raw_value_data_t *ret = new koopa_raw_value_data();
+    koopa_raw_value_data_t *ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = src->ty;
     ret->name = nullptr;
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
@@ -2049,12 +2216,13 @@ koopa_raw_value_data_t *generate_getptr_inst(koopa_raw_value_t src, koopa_raw_va
 #endif
     ret->kind.data.get_ptr.src = src;
     ret->kind.data.get_ptr.index = index;
+    add_operand_uses(ret);
     return ret;
 }
 
 koopa_raw_value_data_t *generate_store_inst(koopa_raw_value_t dest, koopa_raw_value_t value)
 {
-    koopa_raw_value_data_t *ret = new koopa_raw_value_data();
+    koopa_raw_value_data_t *ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = generate_type(KOOPA_RTT_UNIT);
     ret->name = nullptr;
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
@@ -2062,12 +2230,13 @@ koopa_raw_value_data_t *generate_store_inst(koopa_raw_value_t dest, koopa_raw_va
     auto &store = ret->kind.data.store;
     store.dest = dest;
     store.value = value;
+    add_operand_uses(ret);
     return ret;
 }
 
 koopa_raw_value_data_t *generate_load_inst(koopa_raw_value_t src)
 {
-    koopa_raw_value_data_t *ret = new koopa_raw_value_data();
+    koopa_raw_value_data_t *ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = generate_type(KOOPA_RTT_INT32);
     ret->name = nullptr;
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
@@ -2076,12 +2245,13 @@ koopa_raw_value_data_t *generate_load_inst(koopa_raw_value_t src)
     std::cout << "load" << src->ty->tag << std::endl;
 #endif
     ret->kind.data.load.src = src;
+    add_operand_uses(ret);
     return ret;
 }
 
 koopa_raw_value_data_t *generate_binary_inst(koopa_raw_value_t lhs, koopa_raw_value_t rhs, koopa_raw_binary_op_t op)
 {
-    koopa_raw_value_data_t *ret = new koopa_raw_value_data();
+    koopa_raw_value_data_t *ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = generate_type(KOOPA_RTT_INT32);
     ret->name = nullptr;
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
@@ -2090,36 +2260,39 @@ koopa_raw_value_data_t *generate_binary_inst(koopa_raw_value_t lhs, koopa_raw_va
     binary.op = op;
     binary.lhs = lhs;
     binary.rhs = rhs;
+    add_operand_uses(ret);
     return ret;
 }
 
 koopa_raw_value_data_t *generate_return_inst(koopa_raw_value_t value)
 {
-    koopa_raw_value_data_t *ret = new koopa_raw_value_data();
+    koopa_raw_value_data_t *ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = generate_type(KOOPA_RTT_UNIT);
     ret->name = nullptr;
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
     ret->kind.tag = KOOPA_RVT_RETURN;
     ret->kind.data.ret.value = value;
+    add_operand_uses(ret);
     return ret;
 }
 
-koopa_raw_value_data_t *generate_jump_inst(koopa_raw_basic_block_data_t *dest)
+koopa_raw_value_data_t *generate_jump_inst(koopa_raw_basic_block_data_t *dest, std::vector<const void *> args)
 {
-    koopa_raw_value_data_t *ret = new koopa_raw_value_data();
+    koopa_raw_value_data_t *ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = generate_type(KOOPA_RTT_UNIT);
     ret->name = nullptr;
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
     ret->kind.tag = KOOPA_RVT_JUMP;
-    ret->kind.data.jump.args = generate_slice(KOOPA_RSIK_VALUE);
+    ret->kind.data.jump.args = generate_slice(args, KOOPA_RSIK_VALUE);
     ret->kind.data.jump.target = dest;
+    add_operand_uses(ret);
     return ret;
 }
 
 koopa_raw_value_data_t *generate_branch_inst(
     koopa_raw_value_t cond, koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb)
 {
-    koopa_raw_value_data_t *ret = new koopa_raw_value_data();
+    koopa_raw_value_data_t *ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = generate_type(KOOPA_RTT_UNIT);
     ret->name = nullptr;
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
@@ -2129,12 +2302,13 @@ koopa_raw_value_data_t *generate_branch_inst(
     ret->kind.data.branch.false_bb = false_bb;
     ret->kind.data.branch.true_args = generate_slice(KOOPA_RSIK_VALUE);
     ret->kind.data.branch.false_args = generate_slice(KOOPA_RSIK_VALUE);
+    add_operand_uses(ret);
     return ret;
 }
 
 koopa_raw_value_data_t *generate_call_inst(koopa_raw_function_t func, std::vector<const void *> &args)
 {
-    koopa_raw_value_data_t *ret = new koopa_raw_value_data();
+    koopa_raw_value_data_t *ret = raw_arena.make<koopa_raw_value_data_t>();
     ret->ty = func->ty->data.function.ret;
     ret->name = nullptr;
     ret->used_by = generate_slice(KOOPA_RSIK_VALUE);
@@ -2144,6 +2318,7 @@ koopa_raw_value_data_t *generate_call_inst(koopa_raw_function_t func, std::vecto
         ret->kind.data.call.args = generate_slice(KOOPA_RSIK_VALUE);
     else
         ret->kind.data.call.args = generate_slice(args, KOOPA_RSIK_VALUE);
+    add_operand_uses(ret);
     return ret;
 }
 
@@ -7,7 +7,10 @@
 #include <fstream>
 #include <cstring>
 #include <unordered_map>
+#include <array>
 #include "koopa.h"
+#include "arena.h"
+#include "type_table.h"
 
 // #define DEBUG
 // #define DEBUG2
@@ -136,7 +139,8 @@ public:
 private:
     std::vector<std::unordered_map<std::string, SymbolTable::Value>> symbol_table_stack;
 };
-static SymbolTable symbol_table;
+// 生成 IR 时的状态都是 thread_local 的, 批量编译时每个线程各有一份
+static thread_local SymbolTable symbol_table;
 
 /******************************************************************************************************************/
 /************************************************BlockList*****************************************************/
@@ -159,7 +163,7 @@ public:
     void rearrange_block_list();
     std::vector<const void *> get_block_list();
 };
-static BlockList block_list;
+static thread_local BlockList block_list;
 
 /******************************************************************************************************************/
 /************************************************LoopList**********************************************************/
@@ -189,11 +193,41 @@ public:
     bool is_inside_loop();
 };
 
-static LoopStack loop_stack;
+static thread_local LoopStack loop_stack;
+
+/******************************************************************************************************************/
+/************************************************ConstPool*********************************************************/
+/******************************************************************************************************************/
+
+// 整数常量池: 同一个函数内相同的整数只生成一个 value, 之后的 pass 可以按指针比较常量
+// 函数之外 (全局变量的初值) 不共享, 每次都生成新的 value
+// pass 修改已有的函数时用 enter_func(func) 进入, 新建的常量与函数中已有的常量共享
+class ConstPool
+{
+private:
+    // 常用的小整数直接放在数组里, 其余的放在 pool 中
+    static const int SMALL_MIN = -128;
+    static const int SMALL_MAX = 1024;
+    bool in_func = false;
+    std::array<koopa_raw_value_data_t *, SMALL_MAX - SMALL_MIN> small_pool = {};
+    std::unordered_map<int32_t, koopa_raw_value_data_t *> pool;
+
+public:
+    void enter_func();
+    void enter_func(const koopa_raw_function_data_t *func);
+    void exit_func();
+    koopa_raw_value_data_t *find(int32_t number);
+    void add(int32_t number, koopa_raw_value_data_t *value);
+};
+
+extern thread_local ConstPool const_pool;
 /********************************************************************************************************/
 /************************************************AST*****************************************************/
 /********************************************************************************************************/
 
+// 数组初值中显式给出的元素: 按行优先展开后的下标和值, 下标递增
+using ArrayInitList = std::vector<std::pair<size_t, const void *>>;
+
 class BaseAST
 {
 public:
@@ -202,11 +236,15 @@ public:
     virtual void *GetLeftValue() const { return nullptr; };
     virtual std::int32_t CalculateValue() const { return 0; };
     virtual void GenerateGlobalValues(std::vector<const void *> &vec) const { return; };
-    virtual void ArrayInit(std::vector<const void *> &init_vec, std::vector<size_t> size_vec) const { return; };
+    // 把数组初值按行优先展开, 显式给出的元素以 (下标, 值) 追加到 init_list, pos 是下一个元素的下标, 省略的元素跳过.
+    // is_const 为 false 时 (局部变量) 初值在运行时求值, 否则在编译时求值
+    virtual void ArrayInit(ArrayInitList &init_list, size_t &pos, std::vector<size_t> size_vec, bool is_const) const { return; };
     virtual void GenerateGlobalValues(std::vector<const void *> &values, koopa_raw_type_tag_t tag) const { return; };
     virtual void *GenerateIR_ret() const { return nullptr; };
     virtual void *GenerateIR_ret(std::vector<const void *> &init_vec, std::vector<size_t> size_vec, int level) const { return nullptr; };
     virtual void GenerateIR_void() const { return; };
+    // 作为条件生成 IR: 值非 0 时跳到 true_bb, 否则跳到 false_bb
+    virtual void GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const;
     virtual void GenerateIR_void(koopa_raw_type_tag_t tag) const { return; };
     virtual void GenerateIR_void(std::vector<const void *> &funcs, std::vector<const void *> &values) const { return; };
     virtual void GenerateIR_void(std::vector<const void *> &funcs) const { return; };
@@ -367,7 +405,7 @@ public:
     void Dump() const override;
     std::int32_t CalculateValue() const override;
     void *GenerateIR_ret(std::vector<const void *> &init_vec, std::vector<size_t> size_vec, int level) const override;
-    void ArrayInit(std::vector<const void *> &init_vec, std::vector<size_t> size_vec) const override;
+    void ArrayInit(ArrayInitList &init_list, size_t &pos, std::vector<size_t> size_vec, bool is_const) const override;
 };
 
 // ConstExp    ::= Exp;
@@ -428,7 +466,7 @@ public:
     void Dump() const override;
     void *GenerateIR_ret() const override;
     void *GenerateIR_ret(std::vector<const void *> &init_vec, std::vector<size_t> size_vec, int level) const override;
-    void ArrayInit(std::vector<const void *> &init_vec, std::vector<size_t> size_vec) const override;
+    void ArrayInit(ArrayInitList &init_list, size_t &pos, std::vector<size_t> size_vec, bool is_const) const override;
 };
 
 // Stmt          :: = LVal "=" Exp ";"
@@ -514,6 +552,7 @@ public:
 
     void Dump() const override;
     void *GenerateIR_ret() const override;
+    void GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const override;
     std::int32_t CalculateValue() const override;
 };
 
@@ -527,6 +566,7 @@ public:
 
     void Dump() const override;
     void *GenerateIR_ret() const override;
+    void GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const override;
     std::int32_t CalculateValue() const override;
 };
 
@@ -540,6 +580,7 @@ public:
 
     void Dump() const override;
     void *GenerateIR_ret() const override;
+    void GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const override;
     std::int32_t CalculateValue() const override;
 };
 
@@ -555,6 +596,7 @@ public:
 
     void Dump() const override;
     void *GenerateIR_ret() const override;
+    void GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const override;
     std::int32_t CalculateValue() const override;
 };
 
@@ -570,6 +612,7 @@ public:
 
     void Dump() const override;
     void *GenerateIR_ret() const override;
+    void GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const override;
     std::int32_t CalculateValue() const override;
 };
 
@@ -585,6 +628,7 @@ public:
 
     void Dump() const override;
     void *GenerateIR_ret() const override;
+    void GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const override;
     std::int32_t CalculateValue() const override;
 };
 
@@ -600,6 +644,7 @@ public:
 
     void Dump() const override;
     void *GenerateIR_ret() const override;
+    void GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const override;
     std::int32_t CalculateValue() const override;
 };
 
@@ -624,6 +669,7 @@ public:
 
     void Dump() const override;
     void *GenerateIR_ret() const override;
+    void GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const override;
     std::int32_t CalculateValue() const override;
 };
 
@@ -638,6 +684,7 @@ public:
 
     void Dump() const override;
     void *GenerateIR_ret() const override;
+    void GenerateIR_cond(koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb) const override;
     std::int32_t CalculateValue() const override;
 };
 
@@ -665,6 +712,7 @@ koopa_raw_value_data_t *generate_func_arg_ref(koopa_raw_type_t ty, std::string i
 koopa_raw_function_data_t *generate_function_decl(std::string ident, std::vector<const void *> &params_ty, koopa_raw_type_t func_type);
 koopa_raw_function_data_t *generate_function(std::string ident, std::vector<const void *> &params, koopa_raw_type_t func_type);
 koopa_raw_basic_block_data_t *generate_block(std::string name);
+koopa_raw_value_data_t *generate_block_param(koopa_raw_basic_block_data_t *block, koopa_raw_type_t ty);
 koopa_raw_value_data_t *generate_global_alloc(std::string ident, koopa_raw_value_t value, koopa_raw_type_t tag);
 koopa_raw_value_data_t *generate_alloc_inst(std::string ident, koopa_raw_type_t base);
 koopa_raw_value_data_t *generate_getelemptr_inst(koopa_raw_value_t src, koopa_raw_value_t index);
@@ -673,6 +721,6 @@ koopa_raw_value_data_t *generate_store_inst(koopa_raw_value_t dest, koopa_raw_va
 koopa_raw_value_data_t *generate_load_inst(koopa_raw_value_t src);
 koopa_raw_value_data_t *generate_binary_inst(koopa_raw_value_t lhs, koopa_raw_value_t rhs, koopa_raw_binary_op_t op);
 koopa_raw_value_data_t *generate_return_inst(koopa_raw_value_t value);
-koopa_raw_value_data_t *generate_jump_inst(koopa_raw_basic_block_data_t *target);
+koopa_raw_value_data_t *generate_jump_inst(koopa_raw_basic_block_data_t *target, std::vector<const void *> args = {});
 koopa_raw_value_data_t *generate_branch_inst(koopa_raw_value_t cond, koopa_raw_basic_block_data_t *true_bb, koopa_raw_basic_block_data_t *false_bb);
 koopa_raw_value_data_t *generate_call_inst(koopa_raw_function_t func, std::vector<const void *> &args);
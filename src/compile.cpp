@@ -0,0 +1,186 @@
+#include "compile.h"
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include "visit.h"
+#include "koopa.h"
+#include "ast.h"
+#include "raw.h"
+#include "profile.h"
+#include "interp.h"
+#include "opt.h"
+
+using namespace std;
+
+// 声明可重入的 lexer 与 parser 的接口
+// 为什么不引用 sysy.tab.hpp 呢? 因为这个文件不是我们自己写的, 而是被 Bison 生成出来的
+// 你的代码编辑器/IDE 很可能找不到这个文件, 然后会给你报错 (虽然编译不会出错), 于是直接在这里声明
+// lexer 和 parser 必须是可重入的: 批量编译时多个线程同时解析不同的文件, 不能共享全局的 yyin 和解析状态,
+// 每次编译用自己的 yyscan_t 保存 lexer 的状态, parser 也不使用全局变量 (见 sysy.l 和 sysy.y 的选项)
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+extern int yylex_init(yyscan_t *scanner);
+extern void yyset_in(FILE *in, yyscan_t scanner);
+extern int yylex_destroy(yyscan_t scanner);
+extern int yyparse(yyscan_t scanner, unique_ptr<BaseAST> &ast);
+
+// 把 raw program 生成为 RISC-V 汇编, 经过窥孔优化后直接写入 fout
+static void generate_riscv(const koopa_raw_program_t &raw, ofstream &fout)
+{
+    phase_timer.begin("Visit");
+    BufferedWriter writer(fout);
+    PeepholeSink peephole(writer);
+    Visit(raw, peephole);
+    peephole.flush();
+    fout.close();
+    phase_timer.end();
+}
+
+int compile(const CompileOptions &options)
+{
+    const string &mode = options.mode;
+    phase_timer.clear();
+
+    // 打开输入文件, 并且指定 lexer 在解析的时候读取这个文件
+    FILE *fin = fopen(options.input.c_str(), "r");
+    if (fin == nullptr)
+    {
+        cerr << "error: cannot open " << options.input << endl;
+        return 1;
+    }
+    // 打开输出文件, 准备写入
+    ofstream fout(options.output);
+    if (!fout.is_open())
+    {
+        fclose(fin);
+        cerr << "error: cannot open " << options.output << endl;
+        return 1;
+    }
+    // 调用 parser 函数, parser 函数会进一步调用 lexer 解析输入文件的
+    unique_ptr<BaseAST> ast;
+    phase_timer.begin("yyparse");
+    yyscan_t scanner;
+    yylex_init(&scanner);
+    yyset_in(fin, scanner);
+    auto ret = yyparse(scanner, ast);
+    yylex_destroy(scanner);
+    fclose(fin);
+    phase_timer.end();
+    if (ret)
+    {
+        return 1;
+    }
+    // 打印 AST
+    if (mode == "-dump")
+    {
+        streambuf *oldcoutbuf = cout.rdbuf(fout.rdbuf());
+        ast->Dump();
+        cout.rdbuf(oldcoutbuf);
+        fout.close();
+        return 0;
+    }
+    // 生成 IR
+    phase_timer.begin("GenerateIR_ret");
+    koopa_raw_program_t raw = *(koopa_raw_program_t *)ast->GenerateIR_ret();
+    phase_timer.end();
+    if (options.optimize)
+    {
+        optimize_raw_program(raw, options.unroll);
+    }
+    if (mode == "-interp")
+    {
+        // 解释执行: 程序的输入输出为 stdin / stdout, 各函数和基本块的执行计数写入输出文件
+        phase_timer.begin("prepare_raw_program");
+        prepare_raw_program(raw);
+        phase_timer.end();
+        phase_timer.begin("interpret");
+        Interpreter interp(raw);
+        int32_t value = 0;
+        bool ok = interp.run(stdin, stdout, value);
+        fflush(stdout);
+        interp.report(fout);
+        fout.close();
+        raw_arena.release();
+        phase_timer.end();
+        if (!ok)
+        {
+            cerr << "interp error: " << interp.error << endl;
+            return 1;
+        }
+        return value & 0xff;
+    }
+    if (options.direct)
+    {
+        // 补全名字和 used_by 后, 输出与经过 libkoopa 往返时完全相同
+        phase_timer.begin("prepare_raw_program");
+        prepare_raw_program(raw);
+        phase_timer.end();
+        if (mode == "-koopa")
+        {
+            phase_timer.begin("dump_koopa");
+            dump_koopa(raw, fout);
+            fout.close();
+            phase_timer.end();
+        }
+        else if (mode == "-riscv" || mode == "-perf")
+        {
+            generate_riscv(raw, fout);
+        }
+        // raw program 的所有节点都在 raw_arena 中, 一次性释放
+        raw_arena.release();
+        return 0;
+    }
+    phase_timer.begin("koopa_generate_raw_to_koopa");
+    koopa_program_t program;
+    koopa_error_code_t error = koopa_generate_raw_to_koopa(&raw, &program);
+    // libkoopa 已经复制了一份, GenerateIR 构建的 raw program 不再需要
+    raw_arena.release();
+    phase_timer.end();
+    if (error != KOOPA_EC_SUCCESS)
+    {
+        cerr << "generate raw to koopa error: " << error << endl;
+        return 1;
+    }
+    phase_timer.begin("dump/parse round trip");
+    size_t len = 0;
+    koopa_dump_to_string(program, nullptr, &len);
+    char *buf = new char[len + 1];
+    len++;
+    error = koopa_dump_to_string(program, buf, &len);
+    koopa_delete_program(program);
+    if (error != KOOPA_EC_SUCCESS)
+    {
+        delete[] buf;
+        cerr << "dump to string error: " << error << endl;
+        return 1;
+    }
+    koopa_parse_from_string(buf, &program);
+    delete[] buf;
+
+    if (mode == "-koopa")
+    {
+        phase_timer.end();
+        phase_timer.begin("koopa_dump_to_file");
+        koopa_dump_to_file(program, options.output.c_str());
+        koopa_delete_program(program);
+        phase_timer.end();
+    }
+    else if (mode == "-riscv" || mode == "-perf")
+    {
+        koopa_raw_program_builder_t builder = koopa_new_raw_program_builder();
+        koopa_raw_program_t raw = koopa_build_raw_program(builder, program);
+        koopa_delete_program(program);
+        phase_timer.end();
+        generate_riscv(raw, fout);
+        koopa_delete_raw_program_builder(builder);
+    }
+    else
+    {
+        koopa_delete_program(program);
+        phase_timer.end();
+    }
+    return 0;
+}
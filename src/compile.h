@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+
+/**********************************************************************************************************/
+/************************************************Compile***************************************************/
+/**********************************************************************************************************/
+
+// 一次编译任务的参数
+class CompileOptions
+{
+public:
+    std::string mode;
+    std::string input;
+    std::string output;
+    // 不经过 Koopa 文本的 dump/parse 往返
+    bool direct = false;
+    // 是否在 raw program 上运行优化 pass
+    bool optimize = true;
+    // 循环部分展开的倍数
+    int unroll = 4;
+};
+
+// 编译一个文件, 成功时返回 0; -interp 模式下返回被解释程序 main 的返回值的低 8 位
+// 编译用到的状态 (符号表, 基本块列表, 栈帧, raw_arena 等) 都是 thread_local 的,
+// 因此不同线程可以同时调用 compile 编译不同的文件
+int compile(const CompileOptions &options);
@@ -0,0 +1,130 @@
+#include "opt.h"
+
+/**********************************************************************************************************/
+/**************************************************DCE*****************************************************/
+/**********************************************************************************************************/
+
+// 标记-清除式的死代码删除:
+// 1. 有副作用的指令 (store, 调用不是只读的函数) 和终结指令是根, 从根出发沿操作数标记所有活跃的值
+// 2. 跳转的实参不随终结指令一起标记, 只有目标基本块的参数活跃时, 所有入边上对应的实参才活跃
+// 3. 删除没有被标记的指令和基本块参数
+
+static bool has_side_effect(koopa_raw_value_t inst)
+{
+    switch (inst->kind.tag)
+    {
+    case KOOPA_RVT_CALL:
+        return !mod_ref.get(inst->kind.data.call.callee).readonly();
+    case KOOPA_RVT_STORE:
+    case KOOPA_RVT_BRANCH:
+    case KOOPA_RVT_JUMP:
+    case KOOPA_RVT_RETURN:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void dce(koopa_raw_function_data_t *func)
+{
+    CFG cfg(func);
+    // 基本块参数所在的基本块
+    std::unordered_map<koopa_raw_value_t, koopa_raw_basic_block_t> param_block;
+    for (auto bb : cfg.blocks)
+    {
+        for (uint32_t i = 0; i < bb->params.len; i++)
+            param_block[(koopa_raw_value_t)bb->params.buffer[i]] = bb;
+    }
+
+    std::unordered_map<koopa_raw_value_t, bool> live;
+    std::vector<koopa_raw_value_t> worklist;
+    auto mark = [&](koopa_raw_value_t value)
+    {
+        auto it = live.find(value);
+        if (it != live.end() && !it->second)
+        {
+            it->second = true;
+            worklist.push_back(value);
+        }
+    };
+    for (auto &item : param_block)
+        live[item.first] = false;
+    for (auto bb : cfg.blocks)
+    {
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+            live[(koopa_raw_value_t)bb->insts.buffer[i]] = false;
+    }
+    for (auto bb : cfg.blocks)
+    {
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+        {
+            auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+            if (has_side_effect(inst))
+                mark(inst);
+        }
+    }
+
+    while (!worklist.empty())
+    {
+        auto value = worklist.back();
+        worklist.pop_back();
+        auto it = param_block.find(value);
+        if (it != param_block.end())
+        {
+            // 参数活跃时, 每条入边上对应的实参活跃
+            auto bb = it->second;
+            size_t index = value->kind.data.block_arg_ref.index;
+            for (uint32_t i = 0; i < bb->used_by.len; i++)
+            {
+                for_each_edge((koopa_raw_value_t)bb->used_by.buffer[i], [&](koopa_raw_basic_block_t target, koopa_raw_slice_t &args)
+                              {
+                                  if (target == bb)
+                                      mark((koopa_raw_value_t)args.buffer[index]); });
+            }
+            continue;
+        }
+        auto &kind = const_cast<koopa_raw_value_kind_t &>(value->kind);
+        if (kind.tag == KOOPA_RVT_BRANCH)
+        {
+            mark(kind.data.branch.cond);
+            continue;
+        }
+        if (kind.tag == KOOPA_RVT_JUMP)
+            continue;
+        for_each_operand(value, [&](koopa_raw_value_t &op)
+                         { mark(op); });
+    }
+
+    // 先删除指令, 再删除不再被使用的参数
+    for (auto bb : cfg.blocks)
+    {
+        uint32_t len = 0;
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+        {
+            auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+            if (!live[inst])
+            {
+                drop_operand_uses(inst);
+                continue;
+            }
+            bb->insts.buffer[len++] = inst;
+        }
+        bb->insts.len = len;
+    }
+    for (size_t b = 0; b < cfg.blocks.size(); b++)
+    {
+        auto bb = cfg.blocks[b];
+        std::vector<char> keep(bb->params.len, 1);
+        bool changed = false;
+        for (uint32_t i = 0; i < bb->params.len; i++)
+        {
+            if (!live[(koopa_raw_value_t)bb->params.buffer[i]])
+            {
+                keep[i] = 0;
+                changed = true;
+            }
+        }
+        if (changed)
+            remove_block_params(cfg, b, keep);
+    }
+}
@@ -0,0 +1,188 @@
+#include "opt.h"
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include "ast.h"
+
+/**********************************************************************************************************/
+/**************************************************DSE*****************************************************/
+/**********************************************************************************************************/
+
+// 删除局部变量和局部数组中不会再被读取的 store:
+// 1. 只处理不逃逸的 alloc, 即由它得到的指针只用于 load, store 的地址和 getelemptr / getptr,
+//    这样函数调用和通过其他指针的访问都不会读到它
+// 2. 以 (alloc, 常量偏移) 为位置做活跃分析, 读取是使用, 对常量偏移的 i32 store 是定值
+// 3. 写入的位置在之后不会被读取 (包括在读取前被再次覆盖) 的 store 是死的
+// 4. 对整个数组的 store zeroinit 之后只有少数常量偏移会被读取时, 改为只对这些位置 store 0
+// 删除 store 后不再使用的地址计算留给之后的 DCE
+
+// base 指向的对象中偏移为 offset 个字的 i32 的地址, 需要的 getelemptr 追加到 insts.
+// 基本块中之后已有的常量下标 getelemptr (位置记录在 later 中) 移到这里复用, 否则新建
+static koopa_raw_value_t element_ptr(koopa_raw_value_t base, int64_t offset, std::vector<const void *> &insts,
+                                     std::unordered_map<koopa_raw_value_t, bool> &later)
+{
+    koopa_raw_value_t ptr = base;
+    auto ty = base->ty->data.pointer.base;
+    while (ty->tag == KOOPA_RTT_ARRAY)
+    {
+        int64_t stride = words_of(ty->data.array.base);
+        int32_t index = offset / stride;
+        koopa_raw_value_t get = nullptr;
+        for (uint32_t i = 0; i < ptr->used_by.len && get == nullptr; i++)
+        {
+            auto user = (koopa_raw_value_t)ptr->used_by.buffer[i];
+            const auto &kind = user->kind;
+            if (later.count(user) != 0 && kind.tag == KOOPA_RVT_GET_ELEM_PTR && kind.data.get_elem_ptr.src == ptr &&
+                kind.data.get_elem_ptr.index->kind.tag == KOOPA_RVT_INTEGER && kind.data.get_elem_ptr.index->kind.data.integer.value == index)
+                get = user;
+        }
+        if (get == nullptr)
+        {
+            get = generate_getelemptr_inst(ptr, generate_number(index));
+            insts.push_back(get);
+        }
+        else if (!later[get])
+        {
+            // 第一次复用时移动
+            later[get] = true;
+            insts.push_back(get);
+        }
+        ptr = get;
+        offset %= stride;
+        ty = ty->data.array.base;
+    }
+    return ptr;
+}
+
+void dse(koopa_raw_function_data_t *func)
+{
+    CFG cfg(func);
+    size_t n = cfg.blocks.size();
+    AliasAnalysis alias(cfg);
+
+    // 活跃的位置: (alloc, 偏移) 表示这个位置之后可能被读取, 偏移为 -1 表示可能按非常量的偏移读取 alloc 的任意位置
+    using Location = std::pair<koopa_raw_value_t, int64_t>;
+    using LiveSet = std::set<Location>;
+    auto any_live = [](const LiveSet &live, koopa_raw_value_t base)
+    {
+        auto it = live.lower_bound({base, INT64_MIN});
+        return it != live.end() && it->first == base;
+    };
+    // 从后向前经过一条指令, 返回它是否是死的 store
+    auto transfer = [&](koopa_raw_value_t inst, LiveSet &live)
+    {
+        const auto &kind = inst->kind;
+        if (kind.tag == KOOPA_RVT_LOAD)
+        {
+            auto info = alias.get(kind.data.load.src);
+            if (alias.is_private(info.base))
+                live.insert({info.base, info.offset});
+            return false;
+        }
+        if (kind.tag != KOOPA_RVT_STORE)
+            return false;
+        auto info = alias.get(kind.data.store.dest);
+        if (!alias.is_private(info.base))
+            return false;
+        if (!any_live(live, info.base))
+            return true;
+        // 对整个数组的 store (zeroinit 或 aggregate) 不是 i32, 偏移为常量的 i32 store 完全覆盖了这个位置
+        if (kind.data.store.value->ty->tag != KOOPA_RTT_INT32 || info.offset < 0)
+            return false;
+        if (!live.count({info.base, -1}) && !live.count({info.base, info.offset}))
+            return true;
+        live.erase({info.base, info.offset});
+        return false;
+    };
+
+    // 求每个基本块出口处的活跃位置
+    std::vector<LiveSet> live_in(n), live_out(n);
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (auto it = cfg.rpo.rbegin(); it != cfg.rpo.rend(); ++it)
+        {
+            int b = *it;
+            LiveSet live;
+            for (int s : cfg.succs[b])
+                live.insert(live_in[s].begin(), live_in[s].end());
+            live_out[b] = live;
+            auto bb = cfg.blocks[b];
+            for (uint32_t i = bb->insts.len; i-- > 0;)
+                transfer((koopa_raw_value_t)bb->insts.buffer[i], live);
+            if (live != live_in[b])
+            {
+                live_in[b] = std::move(live);
+                changed = true;
+            }
+        }
+    }
+
+    // 删除死的 store, 之后只读取少数位置的 store zeroinit 改为逐个 store 0
+    for (int b : cfg.rpo)
+    {
+        auto bb = cfg.blocks[b];
+        LiveSet live = live_out[b];
+        std::vector<char> dead(bb->insts.len, 0);
+        std::unordered_map<uint32_t, std::vector<int64_t>> split;
+        for (uint32_t i = bb->insts.len; i-- > 0;)
+        {
+            auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+            const auto &kind = inst->kind;
+            if (kind.tag == KOOPA_RVT_STORE && kind.data.store.value->kind.tag == KOOPA_RVT_ZERO_INIT &&
+                alias.is_private(kind.data.store.dest) && !live.count({kind.data.store.dest, -1}))
+            {
+                int64_t words = words_of(kind.data.store.value->ty);
+                std::vector<int64_t> offsets;
+                for (auto it = live.lower_bound({kind.data.store.dest, 0}); it != live.end() && it->first == kind.data.store.dest; ++it)
+                    offsets.push_back(it->second);
+                // 清零循环每个字约一条指令, 单独的 store 0 连同地址计算约四条
+                if (!offsets.empty() && (int64_t)offsets.size() * 4 < words && offsets.back() < words)
+                    split[i] = offsets;
+            }
+            dead[i] = transfer(inst, live);
+        }
+        if (!split.empty() || std::find(dead.begin(), dead.end(), 1) != dead.end())
+        {
+            // 当前位置之后的 getelemptr, 值为是否已经移到前面
+            std::unordered_map<koopa_raw_value_t, bool> later;
+            for (uint32_t i = 0; i < bb->insts.len; i++)
+            {
+                auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+                if (inst->kind.tag == KOOPA_RVT_GET_ELEM_PTR)
+                    later[inst] = false;
+            }
+            std::vector<const void *> insts;
+            for (uint32_t i = 0; i < bb->insts.len; i++)
+            {
+                auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+                auto moved = later.find(inst);
+                if (moved != later.end())
+                {
+                    bool skip = moved->second;
+                    later.erase(moved);
+                    if (skip)
+                        continue;
+                }
+                if (dead[i] || split.count(i) != 0)
+                    drop_operand_uses(inst);
+                if (split.count(i) != 0)
+                {
+                    auto base = inst->kind.data.store.dest;
+                    for (auto offset : split[i])
+                    {
+                        auto ptr = element_ptr(base, offset, insts, later);
+                        insts.push_back(generate_store_inst(ptr, generate_number(0)));
+                    }
+                }
+                else if (!dead[i])
+                {
+                    insts.push_back(inst);
+                }
+            }
+            bb->insts.len = 0;
+            slice_append(bb->insts, insts);
+        }
+    }
+}
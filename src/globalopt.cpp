@@ -0,0 +1,214 @@
+#include "opt.h"
+#include <algorithm>
+#include <unordered_set>
+#include "ast.h"
+
+/**********************************************************************************************************/
+/***********************************************GlobalOpt**************************************************/
+/**********************************************************************************************************/
+
+// 全局变量优化:
+// 1. 地址只用于 load 和常量下标的 getelemptr 以外的地址计算的全局变量不会被写, 以常量下标读取的值直接用初值代替,
+//    只为这些 load 服务的地址计算一起删除
+// 2. 只在 main 中通过 load / store 访问的 i32 全局变量改为 main 的局部变量, 在入口处用初值初始化, 之后由 mem2reg 提升.
+//    main 不会被调用, 局部变量和全局变量一样只有一份
+// 3. 删除不再被使用的全局变量
+
+// 全局变量的地址是否只被读取
+static bool is_read_only(koopa_raw_value_t global)
+{
+    std::vector<koopa_raw_value_t> worklist = {global};
+    while (!worklist.empty())
+    {
+        auto ptr = worklist.back();
+        worklist.pop_back();
+        for (uint32_t i = 0; i < ptr->used_by.len; i++)
+        {
+            auto user = (koopa_raw_value_t)ptr->used_by.buffer[i];
+            const auto &kind = user->kind;
+            if (kind.tag == KOOPA_RVT_LOAD)
+                continue;
+            if ((kind.tag == KOOPA_RVT_GET_ELEM_PTR && kind.data.get_elem_ptr.src == ptr) ||
+                (kind.tag == KOOPA_RVT_GET_PTR && kind.data.get_ptr.src == ptr))
+            {
+                worklist.push_back(user);
+                continue;
+            }
+            // store, 传给函数或基本块参数
+            return false;
+        }
+    }
+    return true;
+}
+
+// ptr 由 global 经过常量下标的 getelemptr 得到时, 求出它指向的 i32 的初值
+static bool initial_value(koopa_raw_value_t ptr, koopa_raw_value_t global, int32_t &value)
+{
+    std::vector<int32_t> path;
+    while (ptr->kind.tag == KOOPA_RVT_GET_ELEM_PTR)
+    {
+        auto index = ptr->kind.data.get_elem_ptr.index;
+        if (index->kind.tag != KOOPA_RVT_INTEGER)
+            return false;
+        path.push_back(index->kind.data.integer.value);
+        ptr = ptr->kind.data.get_elem_ptr.src;
+    }
+    if (ptr != global)
+        return false;
+    auto init = global->kind.data.global_alloc.init;
+    auto ty = global->ty->data.pointer.base;
+    for (auto it = path.rbegin(); it != path.rend(); ++it)
+    {
+        if (ty->tag != KOOPA_RTT_ARRAY || *it < 0 || (size_t)*it >= ty->data.array.len)
+            return false;
+        ty = ty->data.array.base;
+        if (init->kind.tag == KOOPA_RVT_AGGREGATE)
+            init = (koopa_raw_value_t)init->kind.data.aggregate.elems.buffer[*it];
+    }
+    if (ty->tag != KOOPA_RTT_INT32)
+        return false;
+    value = init->kind.tag == KOOPA_RVT_INTEGER ? init->kind.data.integer.value : 0;
+    return true;
+}
+
+void optimize_globals(koopa_raw_program_t &program)
+{
+    // 指令所在的函数, 以及 main 是否被调用
+    std::unordered_map<koopa_raw_value_t, koopa_raw_function_data_t *> func_of;
+    koopa_raw_function_data_t *main_func = nullptr;
+    bool main_called = false;
+    for (uint32_t f = 0; f < program.funcs.len; f++)
+    {
+        auto func = (koopa_raw_function_data_t *)program.funcs.buffer[f];
+        if (func->bbs.len != 0 && std::string(func->name) == "@main")
+            main_func = func;
+        for (uint32_t b = 0; b < func->bbs.len; b++)
+        {
+            auto bb = (koopa_raw_basic_block_t)func->bbs.buffer[b];
+            for (uint32_t i = 0; i < bb->insts.len; i++)
+            {
+                auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+                func_of[inst] = func;
+                if (inst->kind.tag == KOOPA_RVT_CALL && std::string(inst->kind.data.call.callee->name) == "@main")
+                    main_called = true;
+            }
+        }
+    }
+
+    // 只读全局变量中能确定初值的 load, 之后按函数分组替换
+    std::vector<std::pair<koopa_raw_value_t, int32_t>> folds;
+    for (uint32_t g = 0; g < program.values.len; g++)
+    {
+        auto global = (koopa_raw_value_t)program.values.buffer[g];
+        if (global->kind.tag != KOOPA_RVT_GLOBAL_ALLOC || !is_read_only(global))
+            continue;
+        std::vector<koopa_raw_value_t> worklist = {global};
+        while (!worklist.empty())
+        {
+            auto ptr = worklist.back();
+            worklist.pop_back();
+            for (uint32_t i = 0; i < ptr->used_by.len; i++)
+            {
+                auto user = (koopa_raw_value_t)ptr->used_by.buffer[i];
+                int32_t value;
+                if (user->kind.tag != KOOPA_RVT_LOAD)
+                    worklist.push_back(user);
+                else if (initial_value(ptr, global, value))
+                    folds.push_back({user, value});
+            }
+        }
+    }
+
+    // 新的常量与所在函数中已有的常量共享, 每个函数只进入一次
+    std::unordered_set<koopa_raw_value_t> removed;
+    std::stable_sort(folds.begin(), folds.end(), [&](const std::pair<koopa_raw_value_t, int32_t> &a, const std::pair<koopa_raw_value_t, int32_t> &b)
+                     { return func_of[a.first] < func_of[b.first]; });
+    koopa_raw_function_t current = nullptr;
+    for (const auto &fold : folds)
+    {
+        auto load = fold.first;
+        if (func_of[load] != current)
+        {
+            current = func_of[load];
+            const_pool.enter_func(current);
+        }
+        auto ptr = load->kind.data.load.src;
+        replace_all_uses(load, generate_number(fold.second));
+        drop_operand_uses(load);
+        removed.insert(load);
+        // 不再被使用的地址计算
+        while (ptr->kind.tag != KOOPA_RVT_GLOBAL_ALLOC && ptr->used_by.len == 0)
+        {
+            drop_operand_uses(ptr);
+            removed.insert(ptr);
+            ptr = ptr->kind.data.get_elem_ptr.src;
+        }
+    }
+    const_pool.exit_func();
+
+    std::vector<const void *> localized;
+    if (main_func != nullptr)
+        const_pool.enter_func(main_func);
+    for (uint32_t g = 0; g < program.values.len; g++)
+    {
+        auto global = (koopa_raw_value_t)program.values.buffer[g];
+        if (global->kind.tag != KOOPA_RVT_GLOBAL_ALLOC)
+            continue;
+
+        // 只在 main 中读写的 i32
+        bool local = main_func != nullptr && !main_called && global->used_by.len != 0 &&
+                     global->ty->data.pointer.base->tag == KOOPA_RTT_INT32;
+        for (uint32_t i = 0; local && i < global->used_by.len; i++)
+        {
+            auto user = (koopa_raw_value_t)global->used_by.buffer[i];
+            local = func_of[user] == main_func &&
+                    (user->kind.tag == KOOPA_RVT_LOAD || (user->kind.tag == KOOPA_RVT_STORE && user->kind.data.store.value != global));
+        }
+        if (local)
+        {
+            auto init = global->kind.data.global_alloc.init;
+            auto alloc = generate_alloc_inst(global->name + 1, global->ty->data.pointer.base);
+            replace_all_uses(global, alloc);
+            localized.push_back(alloc);
+            localized.push_back(generate_store_inst(alloc, generate_number(init->kind.tag == KOOPA_RVT_INTEGER ? init->kind.data.integer.value : 0)));
+        }
+    }
+    const_pool.exit_func();
+
+    // main 的入口处分配并初始化局部变量
+    if (!localized.empty())
+    {
+        auto entry = (koopa_raw_basic_block_data_t *)main_func->bbs.buffer[0];
+        localized.insert(localized.end(), entry->insts.buffer, entry->insts.buffer + entry->insts.len);
+        entry->insts.len = 0;
+        slice_append(entry->insts, localized);
+    }
+
+    if (!removed.empty())
+    {
+        for (uint32_t f = 0; f < program.funcs.len; f++)
+        {
+            auto func = (koopa_raw_function_data_t *)program.funcs.buffer[f];
+            for (uint32_t b = 0; b < func->bbs.len; b++)
+            {
+                auto bb = (koopa_raw_basic_block_data_t *)func->bbs.buffer[b];
+                uint32_t len = 0;
+                for (uint32_t i = 0; i < bb->insts.len; i++)
+                {
+                    if (removed.count((koopa_raw_value_t)bb->insts.buffer[i]) == 0)
+                        bb->insts.buffer[len++] = bb->insts.buffer[i];
+                }
+                bb->insts.len = len;
+            }
+        }
+    }
+
+    uint32_t len = 0;
+    for (uint32_t g = 0; g < program.values.len; g++)
+    {
+        auto global = (koopa_raw_value_t)program.values.buffer[g];
+        if (global->kind.tag != KOOPA_RVT_GLOBAL_ALLOC || global->used_by.len != 0)
+            program.values.buffer[len++] = global;
+    }
+    program.values.len = len;
+}
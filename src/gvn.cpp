@@ -0,0 +1,316 @@
+#include "opt.h"
+#include <cstdint>
+#include <map>
+#include <set>
+#include "ast.h"
+
+/**********************************************************************************************************/
+/**************************************************GVN*****************************************************/
+/**********************************************************************************************************/
+
+// 沿支配树做基于哈希的值编号:
+// 1. binary, getelemptr 和 getptr 按 (指令种类, 运算, 操作数) 编号, 支配它的等价指令可以直接代替它,
+//    可交换的运算先把操作数排序, 整数常量按值比较
+// 2. 可用的 load 按地址记录, 遇到可能写同一位置的 store 或可能访问它的函数调用时失效,
+//    store 之后对同一地址的 load 直接使用 store 的值
+// 3. 只有一个前驱且前驱是直接支配者的基本块继承前驱出口处的可用 load, 否则从空表开始
+// 4. 纯函数的调用按 (函数, 实参) 编号, 其余调用只使被调用者可能改写的 load 失效
+// 5. store zeroinit 之后, 对同一对象常量偏移处且没有被再次写过的 load 的值是 0
+
+class ExprKey
+{
+public:
+    int tag;
+    int op;
+    uint64_t lhs;
+    uint64_t rhs;
+
+    bool operator==(const ExprKey &other) const
+    {
+        return tag == other.tag && op == other.op && lhs == other.lhs && rhs == other.rhs;
+    }
+};
+
+class ExprKeyHash
+{
+public:
+    size_t operator()(const ExprKey &key) const
+    {
+        size_t h = std::hash<uint64_t>()(key.lhs);
+        h = h * 31 + std::hash<uint64_t>()(key.rhs);
+        return h * 31 + key.tag * 64 + key.op;
+    }
+};
+
+// 整数常量可能不是同一个对象, 按值编号, 最低位为 1 以区别于指针
+static uint64_t operand_id(koopa_raw_value_t value)
+{
+    if (value->kind.tag == KOOPA_RVT_INTEGER)
+        return ((uint64_t)(uint32_t)value->kind.data.integer.value << 1) | 1;
+    return (uint64_t)(uintptr_t)value;
+}
+
+static bool is_commutative(koopa_raw_binary_op_t op)
+{
+    return op == KOOPA_RBO_ADD || op == KOOPA_RBO_MUL || op == KOOPA_RBO_EQ || op == KOOPA_RBO_NOT_EQ ||
+           op == KOOPA_RBO_AND || op == KOOPA_RBO_OR || op == KOOPA_RBO_XOR;
+}
+
+// 纯指令的键, 其余指令返回 false
+static bool expr_key(koopa_raw_value_t inst, ExprKey &key)
+{
+    const auto &kind = inst->kind;
+    key.tag = kind.tag;
+    key.op = 0;
+    switch (kind.tag)
+    {
+    case KOOPA_RVT_BINARY:
+        key.op = kind.data.binary.op;
+        key.lhs = operand_id(kind.data.binary.lhs);
+        key.rhs = operand_id(kind.data.binary.rhs);
+        if (is_commutative(kind.data.binary.op) && key.lhs > key.rhs)
+            std::swap(key.lhs, key.rhs);
+        return true;
+    case KOOPA_RVT_GET_ELEM_PTR:
+        key.lhs = operand_id(kind.data.get_elem_ptr.src);
+        key.rhs = operand_id(kind.data.get_elem_ptr.index);
+        return true;
+    case KOOPA_RVT_GET_PTR:
+        key.lhs = operand_id(kind.data.get_ptr.src);
+        key.rhs = operand_id(kind.data.get_ptr.index);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// 纯函数调用的键, 第一个元素是被调用的函数, 之后是实参
+static std::vector<uint64_t> call_key(koopa_raw_value_t inst)
+{
+    const auto &call = inst->kind.data.call;
+    std::vector<uint64_t> key = {(uint64_t)(uintptr_t)call.callee};
+    for (uint32_t i = 0; i < call.args.len; i++)
+        key.push_back(operand_id((koopa_raw_value_t)call.args.buffer[i]));
+    return key;
+}
+
+// 可用的 load, 按指向的对象分组以便失效
+class LoadTable
+{
+private:
+    const AliasAnalysis *alias;
+    std::unordered_map<koopa_raw_value_t, koopa_raw_value_t> value_of;
+    std::unordered_map<koopa_raw_value_t, std::vector<koopa_raw_value_t>> by_base;
+    // 被 store zeroinit 清零的对象, 以及之后被写过的常量偏移
+    std::unordered_map<koopa_raw_value_t, std::set<int64_t>> zeroed;
+
+    // 删除 base 分组中满足条件的地址
+    template <typename F>
+    void kill_in(koopa_raw_value_t base, F pred)
+    {
+        auto it = by_base.find(base);
+        if (it == by_base.end())
+            return;
+        auto &ptrs = it->second;
+        size_t len = 0;
+        for (auto ptr : ptrs)
+        {
+            if (pred(ptr))
+                value_of.erase(ptr);
+            else
+                ptrs[len++] = ptr;
+        }
+        ptrs.resize(len);
+    }
+
+public:
+    explicit LoadTable(const AliasAnalysis *alias) : alias(alias) {}
+
+    koopa_raw_value_t find(koopa_raw_value_t ptr) const
+    {
+        auto it = value_of.find(ptr);
+        if (it != value_of.end())
+            return it->second;
+        auto info = alias->get(ptr);
+        auto zero = zeroed.find(info.base);
+        if (zero != zeroed.end() && alias->in_bounds(info) && zero->second.count(info.offset) == 0)
+            return generate_number(0);
+        return nullptr;
+    }
+
+    void insert(koopa_raw_value_t ptr, koopa_raw_value_t value)
+    {
+        if (value_of.count(ptr) == 0)
+            by_base[alias->get(ptr).base].push_back(ptr);
+        value_of[ptr] = value;
+    }
+
+    // 对 base 整个对象的 store zeroinit
+    void insert_zero(koopa_raw_value_t base)
+    {
+        zeroed[base].clear();
+    }
+
+    // 写入 info 指向的位置后, 删除可能被改写的 load
+    void kill_store(const PointerInfo &info)
+    {
+        for (auto it = zeroed.begin(); it != zeroed.end();)
+        {
+            if (!alias->may_alias({it->first, -1}, info))
+                ++it;
+            else if (info.base == it->first && info.offset >= 0)
+                (it++)->second.insert(info.offset);
+            else
+                it = zeroed.erase(it);
+        }
+        auto aliases = [&](koopa_raw_value_t ptr)
+        { return alias->may_alias(alias->get(ptr), info); };
+        if (info.base != nullptr)
+        {
+            kill_in(info.base, aliases);
+            if (!alias->is_private(info.base))
+                kill_in(nullptr, aliases);
+            return;
+        }
+        for (auto &item : by_base)
+        {
+            if (item.first == nullptr || !alias->is_private(item.first))
+                kill_in(item.first, aliases);
+        }
+    }
+
+    // 函数调用后, 删除所有可能被调用者改写的 load
+    void kill_call(koopa_raw_value_t call)
+    {
+        auto clobbered = [&](koopa_raw_value_t ptr)
+        { return mod_ref.call_may_mod(call, *alias, alias->get(ptr)); };
+        for (auto &item : by_base)
+            kill_in(item.first, clobbered);
+        for (auto it = zeroed.begin(); it != zeroed.end();)
+        {
+            if (mod_ref.call_may_mod(call, *alias, {it->first, -1}))
+                it = zeroed.erase(it);
+            else
+                ++it;
+        }
+    }
+};
+
+void gvn(koopa_raw_function_data_t *func)
+{
+    CFG cfg(func);
+    AliasAnalysis alias(cfg);
+    std::unordered_map<ExprKey, koopa_raw_value_t, ExprKeyHash> table;
+    std::map<std::vector<uint64_t>, koopa_raw_value_t> calls;
+
+    class GVNFrame
+    {
+    public:
+        int block;
+        size_t child;
+        std::vector<ExprKey> inserted;
+        std::vector<std::vector<uint64_t>> inserted_calls;
+        LoadTable loads;
+    };
+    std::vector<GVNFrame> stack;
+
+    auto enter = [&](int b, const LoadTable *inherited)
+    {
+        stack.push_back({b, 0, {}, {}, inherited != nullptr ? *inherited : LoadTable(&alias)});
+        auto &frame = stack.back();
+        auto bb = cfg.blocks[b];
+        uint32_t len = 0;
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+        {
+            auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+            const auto &kind = inst->kind;
+            ExprKey key;
+            if (expr_key(inst, key))
+            {
+                auto it = table.find(key);
+                if (it != table.end())
+                {
+                    replace_all_uses(inst, it->second);
+                    drop_operand_uses(inst);
+                    continue;
+                }
+                table[key] = inst;
+                frame.inserted.push_back(key);
+            }
+            else if (kind.tag == KOOPA_RVT_LOAD)
+            {
+                auto value = frame.loads.find(kind.data.load.src);
+                if (value != nullptr)
+                {
+                    replace_all_uses(inst, value);
+                    drop_operand_uses(inst);
+                    continue;
+                }
+                frame.loads.insert(kind.data.load.src, inst);
+            }
+            else if (kind.tag == KOOPA_RVT_STORE)
+            {
+                auto info = alias.get(kind.data.store.dest);
+                // zeroinit 和 aggregate 写入整个对象
+                bool scalar = kind.data.store.value->ty->tag == KOOPA_RTT_INT32;
+                if (!scalar)
+                    info.offset = -1;
+                frame.loads.kill_store(info);
+                if (scalar)
+                    frame.loads.insert(kind.data.store.dest, kind.data.store.value);
+                else if (kind.data.store.value->kind.tag == KOOPA_RVT_ZERO_INIT && info.base == kind.data.store.dest)
+                    frame.loads.insert_zero(info.base);
+            }
+            else if (kind.tag == KOOPA_RVT_CALL)
+            {
+                if (inst->ty->tag != KOOPA_RTT_UNIT && mod_ref.get(kind.data.call.callee).pure())
+                {
+                    auto key = call_key(inst);
+                    auto it = calls.find(key);
+                    if (it != calls.end())
+                    {
+                        replace_all_uses(inst, it->second);
+                        drop_operand_uses(inst);
+                        continue;
+                    }
+                    calls[key] = inst;
+                    frame.inserted_calls.push_back(key);
+                }
+                frame.loads.kill_call(inst);
+            }
+            bb->insts.buffer[len++] = inst;
+        }
+        bb->insts.len = len;
+    };
+
+    enter(cfg.rpo[0], nullptr);
+    while (!stack.empty())
+    {
+        auto &top = stack.back();
+        const auto &children = cfg.dom_children[top.block];
+        if (top.child < children.size())
+        {
+            int child = children[top.child++];
+            const auto &preds = cfg.preds[child];
+            bool inherit = preds.size() == 1 && preds[0] == top.block;
+            // enter 可能使 top 失效, 先复制需要继承的表
+            if (inherit)
+            {
+                LoadTable loads = top.loads;
+                enter(child, &loads);
+            }
+            else
+            {
+                enter(child, nullptr);
+            }
+        }
+        else
+        {
+            for (const auto &key : top.inserted)
+                table.erase(key);
+            for (const auto &key : top.inserted_calls)
+                calls.erase(key);
+            stack.pop_back();
+        }
+    }
+}
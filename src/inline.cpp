@@ -0,0 +1,301 @@
+#include "opt.h"
+#include <algorithm>
+#include <string>
+#include "arena.h"
+#include "ast.h"
+
+/**********************************************************************************************************/
+/*************************************************Inline***************************************************/
+/**********************************************************************************************************/
+
+// 函数内联:
+// 1. 按调用图的后序处理函数, 被调用者先于调用者, 这样内联进来的函数体已经内联过它自己的调用
+// 2. 直接或间接递归的函数不内联; 指令数不超过 INLINE_SIZE 的函数在每个调用点内联,
+//    只有一个调用点的函数无论大小都内联. 后端为每个值分配栈槽, 栈帧超过 2048 字节后访问栈需要额外的指令,
+//    所以内联后调用者栈帧的估计大小不能超过 MAX_FRAME_WORDS
+// 3. 内联时在调用处把基本块拆成两半, 前一半跳到复制出的函数体, 复制体中的 ret 改为跳到后一半,
+//    返回值作为后一半的基本块参数; 复制体中的 alloc 移到调用者的入口基本块
+// 4. 最后删除除 main 以外不再被调用的函数
+
+static const int INLINE_SIZE = 40;
+static const int MAX_FRAME_WORDS = 400;
+
+static int function_size(koopa_raw_function_t func)
+{
+    int size = 0;
+    for (uint32_t i = 0; i < func->bbs.len; i++)
+        size += ((koopa_raw_basic_block_t)func->bbs.buffer[i])->insts.len;
+    return size;
+}
+
+// 后端为函数分配的栈槽个数: 每个有值的指令和基本块参数一个, 局部数组按大小计算
+static int frame_words(koopa_raw_function_t func)
+{
+    int words = 0;
+    for (uint32_t i = 0; i < func->bbs.len; i++)
+    {
+        auto bb = (koopa_raw_basic_block_t)func->bbs.buffer[i];
+        words += bb->params.len;
+        for (uint32_t j = 0; j < bb->insts.len; j++)
+        {
+            auto inst = (koopa_raw_value_t)bb->insts.buffer[j];
+            if (inst->kind.tag == KOOPA_RVT_ALLOC)
+                words += words_of(inst->ty->data.pointer.base);
+            else if (inst->ty->tag != KOOPA_RTT_UNIT)
+                words++;
+        }
+    }
+    return words;
+}
+
+template <typename F>
+static void for_each_call(koopa_raw_function_t func, F fn)
+{
+    for (uint32_t i = 0; i < func->bbs.len; i++)
+    {
+        auto bb = (koopa_raw_basic_block_t)func->bbs.buffer[i];
+        for (uint32_t j = 0; j < bb->insts.len; j++)
+        {
+            auto inst = (koopa_raw_value_t)bb->insts.buffer[j];
+            if (inst->kind.tag == KOOPA_RVT_CALL)
+                fn(inst);
+        }
+    }
+}
+
+// 新的基本块命名为 %调用者_原名, 重名由 assign_names 处理
+static const char *caller_block_name(koopa_raw_function_t caller, const char *name)
+{
+    if (name == nullptr)
+        return nullptr;
+    return raw_arena.make_string("%" + std::string(caller->name + 1) + "_" + (name + 1));
+}
+
+// 把 caller->bbs[b] 中第 k 条指令 (对 callee 的调用) 替换为 callee 的函数体
+static void inline_call(koopa_raw_function_data_t *caller, uint32_t b, uint32_t k)
+{
+    auto bb = (koopa_raw_basic_block_data_t *)caller->bbs.buffer[b];
+    auto call = (koopa_raw_value_t)bb->insts.buffer[k];
+    auto callee = call->kind.data.call.callee;
+
+    // 调用之后的指令移到新的基本块, 返回值是它的参数
+    std::string callee_name = callee->name + 1;
+    auto next = raw_arena.make<koopa_raw_basic_block_data_t>();
+    next->name = caller_block_name(caller, ("%" + callee_name + "_ret").c_str());
+    next->params = generate_slice(KOOPA_RSIK_VALUE);
+    next->insts = generate_slice(KOOPA_RSIK_VALUE);
+    next->used_by = generate_slice(KOOPA_RSIK_VALUE);
+    koopa_raw_value_t result = nullptr;
+    if (call->ty->tag != KOOPA_RTT_UNIT)
+    {
+        result = make_block_param(call->ty, call->name, 0);
+        slice_append(next->params, {result});
+        replace_all_uses(call, result);
+    }
+    slice_append(next->insts, std::vector<const void *>(bb->insts.buffer + k + 1, bb->insts.buffer + bb->insts.len));
+    drop_operand_uses(call);
+    bb->insts.len = k;
+
+    // 复制函数体, 参数替换为实参, ret 改为跳到调用之后
+    std::unordered_map<koopa_raw_value_t, koopa_raw_value_t> value_map;
+    for (uint32_t i = 0; i < callee->params.len; i++)
+        value_map[(koopa_raw_value_t)callee->params.buffer[i]] = (koopa_raw_value_t)call->kind.data.call.args.buffer[i];
+    std::vector<koopa_raw_basic_block_t> callee_bbs;
+    for (uint32_t i = 0; i < callee->bbs.len; i++)
+        callee_bbs.push_back((koopa_raw_basic_block_t)callee->bbs.buffer[i]);
+    auto blocks = clone_blocks(callee_bbs, value_map);
+    std::vector<const void *> allocs;
+    for (auto new_bb : blocks)
+    {
+        new_bb->name = caller_block_name(caller, new_bb->name);
+        uint32_t len = 0;
+        for (uint32_t i = 0; i < new_bb->insts.len; i++)
+        {
+            auto inst = (koopa_raw_value_t)new_bb->insts.buffer[i];
+            auto &kind = const_cast<koopa_raw_value_kind_t &>(inst->kind);
+            if (kind.tag == KOOPA_RVT_ALLOC)
+            {
+                allocs.push_back(inst);
+                continue;
+            }
+            if (kind.tag == KOOPA_RVT_RETURN)
+            {
+                drop_operand_uses(inst);
+                koopa_raw_value_t value = kind.data.ret.value;
+                kind.tag = KOOPA_RVT_JUMP;
+                kind.data.jump.target = next;
+                kind.data.jump.args = generate_slice(KOOPA_RSIK_VALUE);
+                if (result != nullptr)
+                    slice_append(kind.data.jump.args, {value != nullptr ? value : generate_number(0)});
+                add_operand_uses(inst);
+            }
+            new_bb->insts.buffer[len++] = inst;
+        }
+        new_bb->insts.len = len;
+    }
+    auto jump = generate_jump_inst(blocks[0]);
+    slice_append(bb->insts, {jump});
+
+    // alloc 放在入口基本块的开头
+    if (!allocs.empty())
+    {
+        auto entry = (koopa_raw_basic_block_data_t *)caller->bbs.buffer[0];
+        allocs.insert(allocs.end(), entry->insts.buffer, entry->insts.buffer + entry->insts.len);
+        entry->insts.len = 0;
+        slice_append(entry->insts, allocs);
+    }
+
+    // 复制体和后一半放在调用所在的基本块之后
+    std::vector<const void *> bbs(caller->bbs.buffer, caller->bbs.buffer + b + 1);
+    bbs.insert(bbs.end(), blocks.begin(), blocks.end());
+    bbs.push_back(next);
+    bbs.insert(bbs.end(), caller->bbs.buffer + b + 1, caller->bbs.buffer + caller->bbs.len);
+    caller->bbs.len = 0;
+    slice_append(caller->bbs, bbs);
+}
+
+void inline_functions(koopa_raw_program_t &program)
+{
+    std::vector<koopa_raw_function_data_t *> funcs;
+    std::unordered_map<koopa_raw_function_t, int> index;
+    for (uint32_t i = 0; i < program.funcs.len; i++)
+    {
+        auto func = (koopa_raw_function_data_t *)program.funcs.buffer[i];
+        if (func->bbs.len == 0)
+            continue;
+        index[func] = funcs.size();
+        funcs.push_back(func);
+    }
+    size_t n = funcs.size();
+
+    // 调用图, 以及每个函数的调用点个数
+    std::vector<std::vector<int>> callees(n);
+    std::vector<int> sites(n, 0), size(n), frame(n);
+    for (size_t f = 0; f < n; f++)
+    {
+        size[f] = function_size(funcs[f]);
+        frame[f] = frame_words(funcs[f]);
+        for_each_call(funcs[f], [&](koopa_raw_value_t call)
+                      {
+                          auto it = index.find(call->kind.data.call.callee);
+                          if (it == index.end())
+                              return;
+                          callees[f].push_back(it->second);
+                          sites[it->second]++; });
+    }
+
+    // 从函数自身的被调用者出发能回到自身的函数是递归的
+    std::vector<char> recursive(n, 0);
+    for (size_t f = 0; f < n; f++)
+    {
+        std::vector<char> visited(n, 0);
+        std::vector<int> worklist = callees[f];
+        while (!worklist.empty() && !recursive[f])
+        {
+            int g = worklist.back();
+            worklist.pop_back();
+            if (visited[g])
+                continue;
+            visited[g] = 1;
+            recursive[f] = g == (int)f;
+            worklist.insert(worklist.end(), callees[g].begin(), callees[g].end());
+        }
+    }
+
+    // 调用图的后序
+    std::vector<int> order;
+    std::vector<char> visited(n, 0);
+    for (size_t root = 0; root < n; root++)
+    {
+        if (visited[root])
+            continue;
+        std::vector<std::pair<int, size_t>> dfs = {{root, 0}};
+        visited[root] = 1;
+        while (!dfs.empty())
+        {
+            auto &top = dfs.back();
+            if (top.second < callees[top.first].size())
+            {
+                int g = callees[top.first][top.second++];
+                if (!visited[g])
+                {
+                    visited[g] = 1;
+                    dfs.push_back({g, 0});
+                }
+            }
+            else
+            {
+                order.push_back(top.first);
+                dfs.pop_back();
+            }
+        }
+    }
+
+    for (int f : order)
+    {
+        auto caller = funcs[f];
+        const_pool.enter_func(caller);
+        for (uint32_t b = 0; b < caller->bbs.len; b++)
+        {
+            auto bb = (koopa_raw_basic_block_t)caller->bbs.buffer[b];
+            for (uint32_t k = 0; k < bb->insts.len; k++)
+            {
+                auto inst = (koopa_raw_value_t)bb->insts.buffer[k];
+                if (inst->kind.tag != KOOPA_RVT_CALL)
+                    continue;
+                auto it = index.find(inst->kind.data.call.callee);
+                if (it == index.end())
+                    continue;
+                int g = it->second;
+                if (recursive[g] || g == f || std::string(funcs[g]->name) == "@main")
+                    continue;
+                if (size[g] > INLINE_SIZE && sites[g] != 1)
+                    continue;
+                if (frame[f] + frame[g] > MAX_FRAME_WORDS)
+                    continue;
+                // 复制体中的调用成为新的调用点, 之后的指令在新的基本块中, 从下一个基本块继续
+                for_each_call(funcs[g], [&](koopa_raw_value_t call)
+                              {
+                                  auto it = index.find(call->kind.data.call.callee);
+                                  if (it != index.end())
+                                      sites[it->second]++; });
+                sites[g]--;
+                size[f] += size[g];
+                frame[f] += frame[g];
+                inline_call(caller, b, k);
+                break;
+            }
+        }
+        const_pool.exit_func();
+    }
+
+    // 删除不再被调用的函数, 调用者先于被调用者处理, 被删除的函数中的调用不再计数
+    std::vector<char> dead(n, 0);
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+        int f = *it;
+        if (sites[f] != 0 || std::string(funcs[f]->name) == "@main")
+            continue;
+        dead[f] = 1;
+        for_each_call(funcs[f], [&](koopa_raw_value_t call)
+                      {
+                          auto it = index.find(call->kind.data.call.callee);
+                          if (it != index.end())
+                              sites[it->second]--; });
+        for (uint32_t j = 0; j < funcs[f]->bbs.len; j++)
+        {
+            auto bb = (koopa_raw_basic_block_t)funcs[f]->bbs.buffer[j];
+            for (uint32_t k = 0; k < bb->insts.len; k++)
+                drop_operand_uses((koopa_raw_value_t)bb->insts.buffer[k]);
+        }
+    }
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < program.funcs.len; i++)
+    {
+        auto func = (koopa_raw_function_data_t *)program.funcs.buffer[i];
+        auto it = index.find(func);
+        if (it == index.end() || !dead[it->second])
+            program.funcs.buffer[len++] = func;
+    }
+    program.funcs.len = len;
+}
@@ -0,0 +1,743 @@
+#include "interp.h"
+#include <cstring>
+#include <iomanip>
+#include <algorithm>
+
+/**********************************************************************************************************/
+/*************************************************Decode***************************************************/
+/**********************************************************************************************************/
+
+// 预解码指令的操作码
+enum InterpOp
+{
+    // 二元运算: dst = a op b, 顺序与 koopa_raw_binary_op 相同
+    OP_NOT_EQ,
+    OP_EQ,
+    OP_GT,
+    OP_LT,
+    OP_GE,
+    OP_LE,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_AND,
+    OP_OR,
+    OP_XOR,
+    OP_SHL,
+    OP_SHR,
+    OP_SAR,
+    // dst = 帧基址 + a
+    OP_ALLOC,
+    // dst = mem[a]
+    OP_LOAD,
+    // mem[b] = a
+    OP_STORE,
+    // 从 mem[b] 开始写入 aggregates 中下标 a 处的聚合常量
+    OP_STORE_AGG,
+    // dst = a + b * c
+    OP_GET_PTR,
+    // 跳转到基本块 a
+    OP_JUMP,
+    // 按 edges 中下标 a 处的边跳转并传递基本块参数
+    OP_JUMP_ARGS,
+    // a 非 0 时跳转到基本块 b, 否则跳转到 c
+    OP_BRANCH,
+    // 按 branches 中下标 a 处的记录跳转并传递基本块参数
+    OP_BRANCH_ARGS,
+    // 调用函数 a, 实参槽位为 call_args[b, b + c), 返回值写入 dst (dst < 0 时忽略)
+    OP_CALL,
+    // 调用运行时库函数 a, 其余同 OP_CALL
+    OP_CALL_LIB,
+    // 返回 a (a < 0 时没有返回值)
+    OP_RET,
+};
+
+// 运行时库函数
+enum LibFunc
+{
+    LIB_GETINT,
+    LIB_GETCH,
+    LIB_GETARRAY,
+    LIB_PUTINT,
+    LIB_PUTCH,
+    LIB_PUTARRAY,
+    LIB_STARTTIME,
+    LIB_STOPTIME,
+};
+
+static const char *lib_names[] = {"getint", "getch", "getarray", "putint",
+                                  "putch", "putarray", "starttime", "stoptime"};
+
+// 内存和槽位栈的上限 (字), 超出时视为栈溢出
+static const size_t MEM_LIMIT_WORDS = (size_t)1 << 26;
+static const size_t REGS_LIMIT = (size_t)1 << 26;
+
+int32_t type_words(koopa_raw_type_t ty)
+{
+    switch (ty->tag)
+    {
+    case KOOPA_RTT_INT32:
+    case KOOPA_RTT_POINTER:
+        return 1;
+    case KOOPA_RTT_ARRAY:
+        return ty->data.array.len * type_words(ty->data.array.base);
+    default:
+        return 0;
+    }
+}
+
+// 把全局初始值或聚合常量展开成字
+static void flatten_init(koopa_raw_value_t value, std::vector<int32_t> &words)
+{
+    switch (value->kind.tag)
+    {
+    case KOOPA_RVT_INTEGER:
+        words.push_back(value->kind.data.integer.value);
+        break;
+    case KOOPA_RVT_AGGREGATE:
+    {
+        const koopa_raw_slice_t &elems = value->kind.data.aggregate.elems;
+        for (uint32_t i = 0; i < elems.len; i++)
+        {
+            flatten_init((koopa_raw_value_t)elems.buffer[i], words);
+        }
+        break;
+    }
+    default:
+        // zeroinit 和 undef
+        words.insert(words.end(), type_words(value->ty), 0);
+        break;
+    }
+}
+
+Interpreter::Interpreter(const koopa_raw_program_t &program)
+{
+    main_func = -1;
+    decode_globals(program.values);
+
+    std::vector<koopa_raw_function_t> all_funcs;
+    for (uint32_t i = 0; i < program.funcs.len; i++)
+    {
+        koopa_raw_function_t func = (koopa_raw_function_t)program.funcs.buffer[i];
+        all_funcs.push_back(func);
+        if (func->bbs.len == 0)
+        {
+            continue;
+        }
+        func_index[func] = funcs.size();
+        if (strcmp(func->name, "@main") == 0)
+        {
+            main_func = funcs.size();
+        }
+        funcs.emplace_back();
+        funcs.back().func = func;
+    }
+    for (Function &func : funcs)
+    {
+        decode_function(func, all_funcs);
+    }
+    block_counts.assign(blocks.size(), 0);
+    if (main_func < 0 && error.empty())
+    {
+        error = "no main function";
+    }
+}
+
+void Interpreter::decode_globals(const koopa_raw_slice_t &values)
+{
+    // 0 号字保留, 使空指针访问可以被发现
+    std::vector<int32_t> words(1, 0);
+    for (uint32_t i = 0; i < values.len; i++)
+    {
+        koopa_raw_value_t value = (koopa_raw_value_t)values.buffer[i];
+        global_addr[value] = words.size();
+        flatten_init(value->kind.data.global_alloc.init, words);
+    }
+    global_words = words.size();
+    mem = words;
+    mem.resize(global_words + ((size_t)1 << 16));
+}
+
+void Interpreter::decode_function(Function &func, const std::vector<koopa_raw_function_t> &all_funcs)
+{
+    koopa_raw_function_t raw = func.func;
+    std::unordered_map<koopa_raw_value_t, int32_t> slot_of;
+    std::unordered_map<int32_t, int32_t> const_slot;
+    std::unordered_map<koopa_raw_basic_block_t, int32_t> block_of;
+    func.calls = 0;
+    func.frame_words = 0;
+
+    // 先为参数, 基本块参数和指令结果分配槽位, 常量放在最后
+    int32_t next_slot = raw->params.len;
+    func.block_begin = blocks.size();
+    for (uint32_t i = 0; i < raw->bbs.len; i++)
+    {
+        koopa_raw_basic_block_t bb = (koopa_raw_basic_block_t)raw->bbs.buffer[i];
+        block_of[bb] = blocks.size();
+        Block block;
+        block.bb = bb;
+        block.start = 0;
+        block.param_base = next_slot;
+        block.inst_count = bb->insts.len;
+        blocks.push_back(block);
+        for (uint32_t j = 0; j < bb->params.len; j++)
+        {
+            slot_of[(koopa_raw_value_t)bb->params.buffer[j]] = next_slot++;
+        }
+        for (uint32_t j = 0; j < bb->insts.len; j++)
+        {
+            koopa_raw_value_t inst = (koopa_raw_value_t)bb->insts.buffer[j];
+            if (inst->ty->tag != KOOPA_RTT_UNIT)
+            {
+                slot_of[inst] = next_slot++;
+            }
+        }
+    }
+    func.block_end = blocks.size();
+    func.const_base = next_slot;
+
+    auto constant = [&](int32_t value) -> int32_t
+    {
+        auto it = const_slot.find(value);
+        if (it != const_slot.end())
+        {
+            return it->second;
+        }
+        int32_t slot = func.const_base + func.const_values.size();
+        func.const_values.push_back(value);
+        const_slot[value] = slot;
+        return slot;
+    };
+    auto operand = [&](koopa_raw_value_t value) -> int32_t
+    {
+        switch (value->kind.tag)
+        {
+        case KOOPA_RVT_INTEGER:
+            return constant(value->kind.data.integer.value);
+        case KOOPA_RVT_UNDEF:
+            return constant(0);
+        case KOOPA_RVT_GLOBAL_ALLOC:
+            return constant(global_addr.at(value));
+        case KOOPA_RVT_FUNC_ARG_REF:
+            return value->kind.data.func_arg_ref.index;
+        default:
+            return slot_of.at(value);
+        }
+    };
+    // 边的实参, 返回在 edges 中的下标, 没有实参时返回 -1
+    auto edge = [&](koopa_raw_basic_block_t target, const koopa_raw_slice_t &args) -> int32_t
+    {
+        if (args.len == 0)
+        {
+            return -1;
+        }
+        int32_t index = edges.size();
+        edges.push_back(block_of.at(target));
+        edges.push_back(args.len);
+        for (uint32_t i = 0; i < args.len; i++)
+        {
+            edges.push_back(operand((koopa_raw_value_t)args.buffer[i]));
+        }
+        return index;
+    };
+
+    for (int32_t b = func.block_begin; b < func.block_end; b++)
+    {
+        koopa_raw_basic_block_t bb = blocks[b].bb;
+        blocks[b].start = func.code.size();
+        for (uint32_t j = 0; j < bb->insts.len; j++)
+        {
+            koopa_raw_value_t value = (koopa_raw_value_t)bb->insts.buffer[j];
+            const koopa_raw_value_kind_t &kind = value->kind;
+            Interpreter::Inst inst = {0, -1, 0, 0, 0};
+            auto it = slot_of.find(value);
+            if (it != slot_of.end())
+            {
+                inst.dst = it->second;
+            }
+            switch (kind.tag)
+            {
+            case KOOPA_RVT_ALLOC:
+                inst.op = OP_ALLOC;
+                inst.a = func.frame_words;
+                func.frame_words += type_words(value->ty->data.pointer.base);
+                break;
+            case KOOPA_RVT_LOAD:
+                inst.op = OP_LOAD;
+                inst.a = operand(kind.data.load.src);
+                break;
+            case KOOPA_RVT_STORE:
+            {
+                koopa_raw_value_t stored = kind.data.store.value;
+                inst.b = operand(kind.data.store.dest);
+                if (stored->kind.tag == KOOPA_RVT_AGGREGATE || stored->kind.tag == KOOPA_RVT_ZERO_INIT)
+                {
+                    std::vector<int32_t> words;
+                    flatten_init(stored, words);
+                    inst.op = OP_STORE_AGG;
+                    inst.a = aggregates.size();
+                    aggregates.push_back(words.size());
+                    aggregates.insert(aggregates.end(), words.begin(), words.end());
+                }
+                else
+                {
+                    inst.op = OP_STORE;
+                    inst.a = operand(stored);
+                }
+                break;
+            }
+            case KOOPA_RVT_GET_PTR:
+                inst.op = OP_GET_PTR;
+                inst.a = operand(kind.data.get_ptr.src);
+                inst.b = operand(kind.data.get_ptr.index);
+                inst.c = type_words(kind.data.get_ptr.src->ty->data.pointer.base);
+                break;
+            case KOOPA_RVT_GET_ELEM_PTR:
+                inst.op = OP_GET_PTR;
+                inst.a = operand(kind.data.get_elem_ptr.src);
+                inst.b = operand(kind.data.get_elem_ptr.index);
+                inst.c = type_words(kind.data.get_elem_ptr.src->ty->data.pointer.base->data.array.base);
+                break;
+            case KOOPA_RVT_BINARY:
+                inst.op = OP_NOT_EQ + kind.data.binary.op;
+                inst.a = operand(kind.data.binary.lhs);
+                inst.b = operand(kind.data.binary.rhs);
+                break;
+            case KOOPA_RVT_JUMP:
+            {
+                int32_t e = edge(kind.data.jump.target, kind.data.jump.args);
+                inst.op = e < 0 ? OP_JUMP : OP_JUMP_ARGS;
+                inst.a = e < 0 ? block_of.at(kind.data.jump.target) : e;
+                break;
+            }
+            case KOOPA_RVT_BRANCH:
+            {
+                const koopa_raw_branch_t &br = kind.data.branch;
+                int32_t true_edge = edge(br.true_bb, br.true_args);
+                int32_t false_edge = edge(br.false_bb, br.false_args);
+                if (true_edge < 0 && false_edge < 0)
+                {
+                    inst.op = OP_BRANCH;
+                    inst.a = operand(br.cond);
+                    inst.b = block_of.at(br.true_bb);
+                    inst.c = block_of.at(br.false_bb);
+                }
+                else
+                {
+                    inst.op = OP_BRANCH_ARGS;
+                    inst.a = branches.size();
+                    branches.push_back(operand(br.cond));
+                    branches.push_back(block_of.at(br.true_bb));
+                    branches.push_back(true_edge);
+                    branches.push_back(block_of.at(br.false_bb));
+                    branches.push_back(false_edge);
+                }
+                break;
+            }
+            case KOOPA_RVT_CALL:
+            {
+                koopa_raw_function_t callee = kind.data.call.callee;
+                auto callee_it = func_index.find(callee);
+                if (callee_it != func_index.end())
+                {
+                    inst.op = OP_CALL;
+                    inst.a = callee_it->second;
+                }
+                else
+                {
+                    inst.op = OP_CALL_LIB;
+                    inst.a = -1;
+                    for (int32_t id = LIB_GETINT; id <= LIB_STOPTIME; id++)
+                    {
+                        if (strcmp(callee->name + 1, lib_names[id]) == 0)
+                        {
+                            inst.a = id;
+                        }
+                    }
+                    if (inst.a < 0 && error.empty())
+                    {
+                        error = std::string("undefined function ") + callee->name;
+                    }
+                }
+                inst.b = call_args.size();
+                inst.c = kind.data.call.args.len;
+                for (uint32_t k = 0; k < kind.data.call.args.len; k++)
+                {
+                    call_args.push_back(operand((koopa_raw_value_t)kind.data.call.args.buffer[k]));
+                }
+                break;
+            }
+            case KOOPA_RVT_RETURN:
+                inst.op = OP_RET;
+                inst.a = kind.data.ret.value == nullptr ? -1 : operand(kind.data.ret.value);
+                break;
+            default:
+                if (error.empty())
+                {
+                    error = std::string("unsupported instruction in ") + raw->name;
+                }
+                break;
+            }
+            func.code.push_back(inst);
+        }
+    }
+    func.slot_count = func.const_base + func.const_values.size();
+}
+
+/**********************************************************************************************************/
+/**************************************************Run*****************************************************/
+/**********************************************************************************************************/
+
+bool Interpreter::call_lib(int32_t id, const int32_t *args, int32_t &ret, FILE *in, FILE *out)
+{
+    ret = 0;
+    switch (id)
+    {
+    case LIB_GETINT:
+        if (fscanf(in, "%d", &ret) != 1)
+        {
+            ret = 0;
+        }
+        return true;
+    case LIB_GETCH:
+        ret = fgetc(in);
+        return true;
+    case LIB_GETARRAY:
+    {
+        int32_t n = 0;
+        if (fscanf(in, "%d", &n) != 1)
+        {
+            n = 0;
+        }
+        if (n < 0 || (uint32_t)args[0] + (size_t)n > mem.size())
+        {
+            error = "getarray: out of bounds";
+            return false;
+        }
+        for (int32_t i = 0; i < n; i++)
+        {
+            if (fscanf(in, "%d", &mem[args[0] + i]) != 1)
+            {
+                mem[args[0] + i] = 0;
+            }
+        }
+        ret = n;
+        return true;
+    }
+    case LIB_PUTINT:
+        fprintf(out, "%d", args[0]);
+        return true;
+    case LIB_PUTCH:
+        fputc(args[0], out);
+        return true;
+    case LIB_PUTARRAY:
+    {
+        int32_t n = args[0];
+        if (n < 0 || (uint32_t)args[1] + (size_t)n > mem.size())
+        {
+            error = "putarray: out of bounds";
+            return false;
+        }
+        fprintf(out, "%d:", n);
+        for (int32_t i = 0; i < n; i++)
+        {
+            fprintf(out, " %d", mem[args[1] + i]);
+        }
+        fputc('\n', out);
+        return true;
+    }
+    default:
+        // starttime / stoptime 只用于计时, 这里不需要做什么
+        return true;
+    }
+}
+
+bool Interpreter::run(FILE *in, FILE *out, int32_t &ret)
+{
+    if (!error.empty())
+    {
+        return false;
+    }
+
+    // 调用者的现场
+    class Frame
+    {
+    public:
+        int32_t func;
+        int32_t pc;
+        size_t reg_base;
+        int32_t fp;
+        int32_t ret_dst;
+    };
+    std::vector<Frame> frames;
+    std::vector<int32_t> regs(std::max<size_t>(funcs[main_func].slot_count, (size_t)1 << 16));
+    std::vector<int32_t> tmp;
+
+    int32_t cur = main_func;
+    const Function *f = &funcs[cur];
+    const Inst *code = f->code.data();
+    size_t reg_base = 0;
+    int32_t *r = regs.data();
+    int32_t fp = global_words;
+    int32_t pc;
+    std::copy(f->const_values.begin(), f->const_values.end(), r + f->const_base);
+    if ((size_t)fp + f->frame_words > mem.size())
+    {
+        mem.resize(fp + f->frame_words);
+    }
+    funcs[cur].calls++;
+    block_counts[f->block_begin]++;
+    pc = blocks[f->block_begin].start;
+
+    // 跳转到基本块 target
+#define ENTER_BLOCK(target)                 \
+    do                                      \
+    {                                       \
+        int32_t target_ = (target);         \
+        block_counts[target_]++;            \
+        pc = blocks[target_].start;         \
+    } while (0)
+
+    // 沿着 edges 中下标为 e 的边跳转, 先读出所有实参再写入, 以免实参与形参相互覆盖
+    auto take_edge = [&](int32_t e)
+    {
+        int32_t target = edges[e];
+        int32_t nargs = edges[e + 1];
+        tmp.resize(nargs);
+        for (int32_t i = 0; i < nargs; i++)
+        {
+            tmp[i] = r[edges[e + 2 + i]];
+        }
+        int32_t *params = r + blocks[target].param_base;
+        for (int32_t i = 0; i < nargs; i++)
+        {
+            params[i] = tmp[i];
+        }
+        return target;
+    };
+    auto fail = [&](const char *msg)
+    {
+        error = std::string(msg) + " in " + funcs[cur].func->name;
+        return false;
+    };
+
+    for (;;)
+    {
+        const Inst &inst = code[pc++];
+        switch (inst.op)
+        {
+        case OP_NOT_EQ:
+            r[inst.dst] = r[inst.a] != r[inst.b];
+            break;
+        case OP_EQ:
+            r[inst.dst] = r[inst.a] == r[inst.b];
+            break;
+        case OP_GT:
+            r[inst.dst] = r[inst.a] > r[inst.b];
+            break;
+        case OP_LT:
+            r[inst.dst] = r[inst.a] < r[inst.b];
+            break;
+        case OP_GE:
+            r[inst.dst] = r[inst.a] >= r[inst.b];
+            break;
+        case OP_LE:
+            r[inst.dst] = r[inst.a] <= r[inst.b];
+            break;
+        case OP_ADD:
+            r[inst.dst] = (uint32_t)r[inst.a] + (uint32_t)r[inst.b];
+            break;
+        case OP_SUB:
+            r[inst.dst] = (uint32_t)r[inst.a] - (uint32_t)r[inst.b];
+            break;
+        case OP_MUL:
+            r[inst.dst] = (uint32_t)r[inst.a] * (uint32_t)r[inst.b];
+            break;
+        case OP_DIV:
+            if (r[inst.b] == 0)
+                return fail("division by zero");
+            // INT_MIN / -1 按 RISC-V 的规则得到 INT_MIN
+            r[inst.dst] = r[inst.b] == -1 ? (int32_t)(0u - (uint32_t)r[inst.a]) : r[inst.a] / r[inst.b];
+            break;
+        case OP_MOD:
+            if (r[inst.b] == 0)
+                return fail("division by zero");
+            r[inst.dst] = r[inst.b] == -1 ? 0 : r[inst.a] % r[inst.b];
+            break;
+        case OP_AND:
+            r[inst.dst] = r[inst.a] & r[inst.b];
+            break;
+        case OP_OR:
+            r[inst.dst] = r[inst.a] | r[inst.b];
+            break;
+        case OP_XOR:
+            r[inst.dst] = r[inst.a] ^ r[inst.b];
+            break;
+        case OP_SHL:
+            r[inst.dst] = (uint32_t)r[inst.a] << (r[inst.b] & 31);
+            break;
+        case OP_SHR:
+            r[inst.dst] = (uint32_t)r[inst.a] >> (r[inst.b] & 31);
+            break;
+        case OP_SAR:
+            r[inst.dst] = r[inst.a] >> (r[inst.b] & 31);
+            break;
+        case OP_ALLOC:
+            r[inst.dst] = fp + inst.a;
+            break;
+        case OP_LOAD:
+        {
+            uint32_t addr = r[inst.a];
+            if (addr == 0 || addr >= mem.size())
+                return fail("invalid load");
+            r[inst.dst] = mem[addr];
+            break;
+        }
+        case OP_STORE:
+        {
+            uint32_t addr = r[inst.b];
+            if (addr == 0 || addr >= mem.size())
+                return fail("invalid store");
+            mem[addr] = r[inst.a];
+            break;
+        }
+        case OP_STORE_AGG:
+        {
+            uint32_t addr = r[inst.b];
+            int32_t words = aggregates[inst.a];
+            if (addr == 0 || (size_t)addr + words > mem.size())
+                return fail("invalid store");
+            std::copy(&aggregates[inst.a + 1], &aggregates[inst.a + 1] + words, &mem[addr]);
+            break;
+        }
+        case OP_GET_PTR:
+            r[inst.dst] = (uint32_t)r[inst.a] + (uint32_t)r[inst.b] * (uint32_t)inst.c;
+            break;
+        case OP_JUMP:
+            ENTER_BLOCK(inst.a);
+            break;
+        case OP_JUMP_ARGS:
+            ENTER_BLOCK(take_edge(inst.a));
+            break;
+        case OP_BRANCH:
+            ENTER_BLOCK(r[inst.a] ? inst.b : inst.c);
+            break;
+        case OP_BRANCH_ARGS:
+        {
+            const int32_t *br = &branches[inst.a];
+            int32_t e = r[br[0]] ? br[2] : br[4];
+            ENTER_BLOCK(e < 0 ? (r[br[0]] ? br[1] : br[3]) : take_edge(e));
+            break;
+        }
+        case OP_CALL:
+        {
+            const Function &callee = funcs[inst.a];
+            size_t new_base = reg_base + f->slot_count;
+            size_t new_fp = (size_t)fp + f->frame_words;
+            if (new_base + callee.slot_count > regs.size())
+            {
+                if (new_base + callee.slot_count > REGS_LIMIT)
+                    return fail("stack overflow");
+                regs.resize(std::max(regs.size() * 2, new_base + callee.slot_count));
+                r = regs.data() + reg_base;
+            }
+            if (new_fp + callee.frame_words > mem.size())
+            {
+                if (new_fp + callee.frame_words > MEM_LIMIT_WORDS)
+                    return fail("stack overflow");
+                mem.resize(std::min(std::max(mem.size() * 2, new_fp + callee.frame_words), MEM_LIMIT_WORDS));
+            }
+            int32_t *callee_r = regs.data() + new_base;
+            for (int32_t i = 0; i < inst.c; i++)
+            {
+                callee_r[i] = r[call_args[inst.b + i]];
+            }
+            std::copy(callee.const_values.begin(), callee.const_values.end(), callee_r + callee.const_base);
+            frames.push_back({cur, pc, reg_base, fp, inst.dst});
+
+            cur = inst.a;
+            f = &callee;
+            code = f->code.data();
+            reg_base = new_base;
+            r = callee_r;
+            fp = new_fp;
+            funcs[cur].calls++;
+            ENTER_BLOCK(f->block_begin);
+            break;
+        }
+        case OP_CALL_LIB:
+        {
+            int32_t args[2] = {0, 0};
+            for (int32_t i = 0; i < inst.c && i < 2; i++)
+            {
+                args[i] = r[call_args[inst.b + i]];
+            }
+            int32_t value;
+            if (!call_lib(inst.a, args, value, in, out))
+                return false;
+            if (inst.dst >= 0)
+                r[inst.dst] = value;
+            break;
+        }
+        case OP_RET:
+        {
+            int32_t value = inst.a < 0 ? 0 : r[inst.a];
+            if (frames.empty())
+            {
+                ret = value;
+                return true;
+            }
+            const Frame &frame = frames.back();
+            cur = frame.func;
+            f = &funcs[cur];
+            code = f->code.data();
+            pc = frame.pc;
+            reg_base = frame.reg_base;
+            r = regs.data() + reg_base;
+            fp = frame.fp;
+            if (frame.ret_dst >= 0)
+                r[frame.ret_dst] = value;
+            frames.pop_back();
+            break;
+        }
+        }
+    }
+#undef ENTER_BLOCK
+}
+
+/**********************************************************************************************************/
+/*************************************************Report***************************************************/
+/**********************************************************************************************************/
+
+uint64_t Interpreter::total_insts() const
+{
+    uint64_t total = 0;
+    for (size_t b = 0; b < blocks.size(); b++)
+    {
+        total += block_counts[b] * blocks[b].inst_count;
+    }
+    return total;
+}
+
+void Interpreter::report(std::ostream &os) const
+{
+    os << "total insts: " << total_insts() << "\n";
+    for (const Function &func : funcs)
+    {
+        uint64_t insts = 0;
+        for (int32_t b = func.block_begin; b < func.block_end; b++)
+        {
+            insts += block_counts[b] * blocks[b].inst_count;
+        }
+        os << "\n"
+           << "fun " << func.func->name << ": calls " << func.calls << ", insts " << insts << "\n";
+        for (int32_t b = func.block_begin; b < func.block_end; b++)
+        {
+            os << "  " << std::left << std::setw(24) << blocks[b].bb->name << std::right
+               << std::setw(12) << block_counts[b] << " x " << std::setw(3) << blocks[b].inst_count
+               << " = " << block_counts[b] * blocks[b].inst_count << "\n";
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <ostream>
+#include "koopa.h"
+
+/**********************************************************************************************************/
+/***********************************************Interpreter************************************************/
+/**********************************************************************************************************/
+
+// Koopa IR 解释器: 直接执行 GenerateIR 得到的 raw program, 并统计每个函数, 每个基本块执行的指令条数
+// 执行前先把每个函数翻译成紧凑的线性指令序列: 操作数都是帧内的槽位下标, 常量预先放在槽位里,
+// 跳转目标解析为基本块下标, 因此执行时不需要查表或者解析 raw value
+// 内存按 32 位字寻址, 指针的值就是字下标; 运行时库 (getint, putint 等) 在 in / out 上模拟
+class Interpreter
+{
+public:
+    // 一条预解码的指令, 各字段的含义由 op 决定
+    class Inst
+    {
+    public:
+        uint32_t op;
+        int32_t dst;
+        int32_t a;
+        int32_t b;
+        int32_t c;
+    };
+
+    class Block
+    {
+    public:
+        koopa_raw_basic_block_t bb;
+        // 第一条指令在函数指令序列中的位置
+        int32_t start;
+        // 基本块参数占用的第一个槽位
+        int32_t param_base;
+        // 基本块中 Koopa 指令的条数, 用于由执行次数推出指令条数
+        uint32_t inst_count;
+    };
+
+    class Function
+    {
+    public:
+        koopa_raw_function_t func;
+        std::vector<Inst> code;
+        // 在全局基本块数组中的下标范围, 第一个是入口
+        int32_t block_begin;
+        int32_t block_end;
+        // 槽位依次为参数, 基本块参数, 指令结果, 最后是常量 (从 const_base 开始, 进入函数时复制)
+        std::vector<int32_t> const_values;
+        int32_t const_base;
+        int32_t slot_count;
+        // 局部变量 (alloc) 占用的字数
+        int32_t frame_words;
+        uint64_t calls;
+    };
+
+    explicit Interpreter(const koopa_raw_program_t &program);
+
+    // 执行 main 函数, 成功时返回 true, ret 为 main 的返回值
+    // 执行出错 (除零, 访问越界, 栈溢出等) 时返回 false, 错误信息见 error
+    bool run(FILE *in, FILE *out, int32_t &ret);
+
+    // 输出每个函数和基本块的执行次数与执行的指令条数
+    void report(std::ostream &os) const;
+
+    // 执行的 Koopa 指令总条数
+    uint64_t total_insts() const;
+
+    std::string error;
+
+private:
+    std::vector<Function> funcs;
+    std::unordered_map<koopa_raw_function_t, int32_t> func_index;
+    std::unordered_map<koopa_raw_value_t, int32_t> global_addr;
+    std::vector<Block> blocks;
+    std::vector<uint64_t> block_counts;
+    // 带参数的跳转: 每条边 {目标块, 实参个数, 实参槽位...} 依次存放
+    std::vector<int32_t> edges;
+    // 带参数的 br: {条件槽位, 真目标, 真边, 假目标, 假边}, 无参数的边为 -1
+    std::vector<int32_t> branches;
+    // 函数调用的实参槽位依次存放
+    std::vector<int32_t> call_args;
+    // store 聚合常量 (zeroinit 或 {...}) 时的展开值: {字数, 值...}
+    std::vector<int32_t> aggregates;
+    // 内存, 全局变量在最前面, 之后是各个函数的栈帧
+    std::vector<int32_t> mem;
+    int32_t global_words;
+    int32_t main_func;
+
+    void decode_globals(const koopa_raw_slice_t &values);
+    void decode_function(Function &func, const std::vector<koopa_raw_function_t> &all_funcs);
+    bool call_lib(int32_t id, const int32_t *args, int32_t &ret, FILE *in, FILE *out);
+};
+
+// 类型占用的字数
+int32_t type_words(koopa_raw_type_t ty);
@@ -0,0 +1,148 @@
+#include "opt.h"
+
+/**********************************************************************************************************/
+/*************************************************LICM*****************************************************/
+/**********************************************************************************************************/
+
+// 循环不变代码外提:
+// 1. 先为没有 preheader 的循环新建 preheader, 再重新构建 CFG 和循环
+// 2. 从内层循环到外层循环, 按逆后序找出操作数都在循环外定义 (或已被外提) 的指令, 移到 preheader 的末尾,
+//    外提到内层循环 preheader 的指令之后还可以继续外提到外层循环的 preheader
+// 3. 外提的指令可能在循环一次都不执行时被执行, 所以只外提不会出错的指令:
+//    getelemptr, getptr, 除数为非零常量的除法和取模以外的 binary,
+//    以及地址一定有效, 且循环中没有可能改写它的 store 和函数调用的 load
+
+// 外提后也不会出错的纯运算
+static bool is_speculatable(koopa_raw_value_t inst)
+{
+    const auto &kind = inst->kind;
+    switch (kind.tag)
+    {
+    case KOOPA_RVT_GET_ELEM_PTR:
+    case KOOPA_RVT_GET_PTR:
+        return true;
+    case KOOPA_RVT_BINARY:
+    {
+        auto op = kind.data.binary.op;
+        if (op != KOOPA_RBO_DIV && op != KOOPA_RBO_MOD)
+            return true;
+        auto rhs = kind.data.binary.rhs;
+        return rhs->kind.tag == KOOPA_RVT_INTEGER && rhs->kind.data.integer.value != 0;
+    }
+    default:
+        return false;
+    }
+}
+
+void licm(koopa_raw_function_data_t *func)
+{
+    insert_preheaders(func);
+    CFG cfg(func);
+    LoopInfo loops(cfg);
+    AliasAnalysis alias(cfg);
+
+    // 函数内定义的值所在的基本块, 其余的值 (常量, 全局变量, 函数参数) 在所有循环之外
+    std::unordered_map<koopa_raw_value_t, int> block_of;
+    for (int b : cfg.rpo)
+    {
+        auto bb = cfg.blocks[b];
+        for (uint32_t i = 0; i < bb->params.len; i++)
+            block_of[(koopa_raw_value_t)bb->params.buffer[i]] = b;
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+            block_of[(koopa_raw_value_t)bb->insts.buffer[i]] = b;
+    }
+
+    for (size_t l = 0; l < loops.loops.size(); l++)
+    {
+        const auto &loop = loops.loops[l];
+        int pre = loops.preheader(cfg, l);
+        if (pre < 0)
+            continue;
+        auto invariant = [&](koopa_raw_value_t value)
+        {
+            auto it = block_of.find(value);
+            return it == block_of.end() || !loops.contains(l, it->second);
+        };
+
+        // 循环中所有 store 写入的位置, 以及所有函数调用
+        std::vector<PointerInfo> stores;
+        std::vector<koopa_raw_value_t> calls;
+        for (int b : loop.blocks)
+        {
+            auto bb = cfg.blocks[b];
+            for (uint32_t i = 0; i < bb->insts.len; i++)
+            {
+                auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+                const auto &kind = inst->kind;
+                if (kind.tag == KOOPA_RVT_STORE)
+                {
+                    auto info = alias.get(kind.data.store.dest);
+                    if (kind.data.store.value->ty->tag != KOOPA_RTT_INT32)
+                        info.offset = -1;
+                    stores.push_back(info);
+                }
+                else if (kind.tag == KOOPA_RVT_CALL)
+                {
+                    calls.push_back(inst);
+                }
+            }
+        }
+        auto load_invariant = [&](koopa_raw_value_t ptr)
+        {
+            auto info = alias.get(ptr);
+            if (!alias.in_bounds(info))
+                return false;
+            for (auto call : calls)
+            {
+                if (mod_ref.call_may_mod(call, alias, info))
+                    return false;
+            }
+            for (const auto &store : stores)
+            {
+                if (alias.may_alias(store, info))
+                    return false;
+            }
+            return true;
+        };
+
+        std::vector<const void *> hoisted;
+        for (int b : loop.blocks)
+        {
+            auto bb = cfg.blocks[b];
+            uint32_t len = 0;
+            for (uint32_t i = 0; i < bb->insts.len; i++)
+            {
+                auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+                const auto &kind = inst->kind;
+                bool hoist = false;
+                if (is_speculatable(inst))
+                {
+                    hoist = true;
+                    for_each_operand(inst, [&](koopa_raw_value_t &op)
+                                     { hoist = hoist && invariant(op); });
+                }
+                else if (kind.tag == KOOPA_RVT_LOAD)
+                {
+                    hoist = invariant(kind.data.load.src) && load_invariant(kind.data.load.src);
+                }
+                if (hoist)
+                {
+                    hoisted.push_back(inst);
+                    block_of[inst] = pre;
+                    continue;
+                }
+                bb->insts.buffer[len++] = inst;
+            }
+            bb->insts.len = len;
+        }
+        if (hoisted.empty())
+            continue;
+
+        // 放在 preheader 的 jump 之前
+        auto pre_bb = cfg.blocks[pre];
+        auto jump = terminator(pre_bb);
+        pre_bb->insts.len--;
+        hoisted.push_back(jump);
+        slice_append(pre_bb->insts, hoisted);
+    }
+}
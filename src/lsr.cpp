@@ -0,0 +1,262 @@
+#include "opt.h"
+#include <cstdlib>
+#include <map>
+#include <unordered_set>
+#include "ast.h"
+
+/**********************************************************************************************************/
+/**************************************************LSR*****************************************************/
+/**********************************************************************************************************/
+
+// 循环中数组下标的强度削弱:
+// 1. 基本归纳变量是 header 的 i32 参数 i, 每个 latch 传给它的值都是 i 经过若干次加减常量得到的值
+// 2. 循环中源在循环外定义, 下标为 i + k (k 为常量) 的 getelemptr / getptr 按 (指令种类, 源, i) 分组,
+//    每组为 header 新增一个指针参数 p, 它总是等于源 + i 个元素: preheader 传入由 i 的初值算出的地址,
+//    latch 传入 getptr p, step
+// 3. 组内的地址计算改为 getptr p, k, k 为 0 时直接用 p 代替. 常量下标在后端只需要一条 addi, 不再需要乘法
+// 4. 后端把每个值都放在栈上, 维护 p 每次迭代也需要几条指令, 只改写估计节省的指令多于这个开销的组
+// 改写后只被自己的更新使用的归纳变量由之后的 DCE 删除
+
+// 后端中下标不是常量的 getelemptr / getptr 的指令数 (步长不是 2 的幂时多一条), 常量下标时的指令数,
+// 以及每次迭代维护一个指针参数 (latch 中的 getptr 和参数的复制) 的指令数
+static const int VARIABLE_INDEX_COST = 5;
+static const int CONSTANT_INDEX_COST = 3;
+static const int POINTER_IV_COST = 5;
+// 偏移的绝对值上限, 避免累加溢出
+static const int64_t MAX_OFFSET = 1 << 20;
+
+// value 等于 base + offset, 沿加减常量的链找到 base
+static koopa_raw_value_t linear_base(koopa_raw_value_t value, int64_t &offset)
+{
+    offset = 0;
+    while (value->kind.tag == KOOPA_RVT_BINARY && std::abs(offset) <= MAX_OFFSET)
+    {
+        const auto &binary = value->kind.data.binary;
+        if (binary.op == KOOPA_RBO_ADD && binary.rhs->kind.tag == KOOPA_RVT_INTEGER)
+        {
+            offset += binary.rhs->kind.data.integer.value;
+            value = binary.lhs;
+        }
+        else if (binary.op == KOOPA_RBO_ADD && binary.lhs->kind.tag == KOOPA_RVT_INTEGER)
+        {
+            offset += binary.lhs->kind.data.integer.value;
+            value = binary.rhs;
+        }
+        else if (binary.op == KOOPA_RBO_SUB && binary.rhs->kind.tag == KOOPA_RVT_INTEGER)
+        {
+            offset -= binary.rhs->kind.data.integer.value;
+            value = binary.lhs;
+        }
+        else
+        {
+            break;
+        }
+    }
+    return value;
+}
+
+// 在基本块的终结指令之前插入指令
+static void insert_before_terminator(koopa_raw_basic_block_data_t *bb, koopa_raw_value_t inst)
+{
+    std::vector<const void *> insts(bb->insts.buffer, bb->insts.buffer + bb->insts.len);
+    insts.insert(insts.end() - 1, inst);
+    bb->insts.len = 0;
+    slice_append(bb->insts, insts);
+}
+
+// 在终结指令跳到 target 的每条边上追加实参
+static void append_edge_arg(koopa_raw_value_t term, koopa_raw_basic_block_t target, koopa_raw_value_t arg)
+{
+    for_each_edge(term, [&](koopa_raw_basic_block_t to, koopa_raw_slice_t &args)
+                  {
+                      if (to != target)
+                          return;
+                      slice_append(args, {arg});
+                      add_use(arg, term); });
+}
+
+// 一组以同一个源和归纳变量计算的地址
+class AddressGroup
+{
+public:
+    koopa_raw_value_tag_t tag;
+    koopa_raw_value_t src;
+    // 归纳变量是 header 的第 index 个参数
+    size_t index;
+    std::vector<std::pair<koopa_raw_value_t, int32_t>> uses;
+};
+
+void lsr(koopa_raw_function_data_t *func)
+{
+    insert_preheaders(func);
+    CFG cfg(func);
+    LoopInfo loops(cfg);
+
+    std::unordered_map<koopa_raw_value_t, int> block_of;
+    for (int b : cfg.rpo)
+    {
+        auto bb = cfg.blocks[b];
+        for (uint32_t i = 0; i < bb->params.len; i++)
+            block_of[(koopa_raw_value_t)bb->params.buffer[i]] = b;
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+            block_of[(koopa_raw_value_t)bb->insts.buffer[i]] = b;
+    }
+    std::unordered_set<koopa_raw_value_t> removed;
+
+    for (size_t l = 0; l < loops.loops.size(); l++)
+    {
+        const auto &loop = loops.loops[l];
+        int pre = loops.preheader(cfg, l);
+        if (pre < 0)
+            continue;
+        auto header = cfg.blocks[loop.header];
+        auto invariant = [&](koopa_raw_value_t value)
+        {
+            auto it = block_of.find(value);
+            return it == block_of.end() || !loops.contains(l, it->second);
+        };
+
+        // 基本归纳变量在每个 latch 上的步长
+        std::unordered_map<koopa_raw_value_t, std::vector<int32_t>> steps;
+        for (uint32_t k = 0; k < header->params.len; k++)
+        {
+            auto param = (koopa_raw_value_t)header->params.buffer[k];
+            if (param->ty->tag != KOOPA_RTT_INT32)
+                continue;
+            std::vector<int32_t> param_steps;
+            bool ok = true;
+            for (int latch : loop.latches)
+            {
+                int64_t step = 0;
+                bool first = true;
+                for_each_edge(terminator(cfg.blocks[latch]), [&](koopa_raw_basic_block_t target, koopa_raw_slice_t &args)
+                              {
+                                  if (target != header)
+                                      return;
+                                  int64_t offset = 0;
+                                  ok = ok && linear_base((koopa_raw_value_t)args.buffer[k], offset) == param &&
+                                       std::abs(offset) <= MAX_OFFSET && (first || offset == step);
+                                  step = offset;
+                                  first = false; });
+                param_steps.push_back((int32_t)step);
+            }
+            if (ok)
+                steps[param] = param_steps;
+        }
+        if (steps.empty())
+            continue;
+
+        // 按在循环中出现的顺序分组
+        std::vector<AddressGroup> groups;
+        std::map<std::tuple<int, koopa_raw_value_t, koopa_raw_value_t>, size_t> group_of;
+        for (int b : loop.blocks)
+        {
+            auto bb = cfg.blocks[b];
+            for (uint32_t i = 0; i < bb->insts.len; i++)
+            {
+                auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+                const auto &kind = inst->kind;
+                koopa_raw_value_t src, index;
+                // 内层循环中已经被 p 代替的地址
+                if (removed.count(inst) != 0)
+                    continue;
+                if (kind.tag == KOOPA_RVT_GET_ELEM_PTR)
+                {
+                    src = kind.data.get_elem_ptr.src;
+                    index = kind.data.get_elem_ptr.index;
+                }
+                else if (kind.tag == KOOPA_RVT_GET_PTR)
+                {
+                    src = kind.data.get_ptr.src;
+                    index = kind.data.get_ptr.index;
+                }
+                else
+                {
+                    continue;
+                }
+                int64_t offset;
+                auto iv = linear_base(index, offset);
+                if (steps.count(iv) == 0 || std::abs(offset) > MAX_OFFSET || !invariant(src))
+                    continue;
+                auto key = std::make_tuple((int)kind.tag, src, iv);
+                auto it = group_of.find(key);
+                if (it == group_of.end())
+                {
+                    it = group_of.insert({key, groups.size()}).first;
+                    groups.push_back({kind.tag, src, iv->kind.data.block_arg_ref.index, {}});
+                }
+                groups[it->second].uses.push_back({inst, (int32_t)offset});
+            }
+        }
+
+        for (const auto &group : groups)
+        {
+            auto ty = group.uses[0].first->ty;
+            int variable_cost = VARIABLE_INDEX_COST;
+            int64_t size = words_of(ty->data.pointer.base);
+            if ((size & (size - 1)) != 0)
+                variable_cost++;
+            int saved = -POINTER_IV_COST;
+            for (const auto &use : group.uses)
+                saved += use.second == 0 ? variable_cost : variable_cost - CONSTANT_INDEX_COST;
+            if (saved <= 0)
+                continue;
+
+            // header 的新参数, preheader 传入初值对应的地址, latch 传入前进 step 个元素后的地址
+            auto p = make_block_param(ty, nullptr, header->params.len);
+            slice_append(header->params, {p});
+            block_of[p] = loop.header;
+            auto pre_term = terminator(cfg.blocks[pre]);
+            auto init = (koopa_raw_value_t)pre_term->kind.data.jump.args.buffer[group.index];
+            auto start = group.tag == KOOPA_RVT_GET_ELEM_PTR ? generate_getelemptr_inst(group.src, init)
+                                                             : generate_getptr_inst(group.src, init);
+            insert_before_terminator(cfg.blocks[pre], start);
+            block_of[start] = pre;
+            append_edge_arg(pre_term, header, start);
+            const auto &iv_steps = steps[(koopa_raw_value_t)header->params.buffer[group.index]];
+            for (size_t i = 0; i < loop.latches.size(); i++)
+            {
+                int latch = loop.latches[i];
+                koopa_raw_value_t next = p;
+                if (iv_steps[i] != 0)
+                {
+                    next = generate_getptr_inst(p, generate_number(iv_steps[i]));
+                    insert_before_terminator(cfg.blocks[latch], next);
+                    block_of[next] = latch;
+                }
+                append_edge_arg(terminator(cfg.blocks[latch]), header, next);
+            }
+
+            // 组内的地址改为 p 加常量
+            for (const auto &use : group.uses)
+            {
+                auto inst = use.first;
+                drop_operand_uses(inst);
+                if (use.second == 0)
+                {
+                    replace_all_uses(inst, p);
+                    removed.insert(inst);
+                    continue;
+                }
+                auto &kind = const_cast<koopa_raw_value_kind_t &>(inst->kind);
+                kind.tag = KOOPA_RVT_GET_PTR;
+                kind.data.get_ptr.src = p;
+                kind.data.get_ptr.index = generate_number(use.second);
+                add_operand_uses(inst);
+            }
+        }
+    }
+
+    if (removed.empty())
+        return;
+    for (auto bb : cfg.blocks)
+    {
+        uint32_t len = 0;
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+        {
+            if (removed.count((koopa_raw_value_t)bb->insts.buffer[i]) == 0)
+                bb->insts.buffer[len++] = bb->insts.buffer[i];
+        }
+        bb->insts.len = len;
+    }
+}
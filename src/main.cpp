@@ -1,103 +1,156 @@
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <memory>
 #include <string>
+#include <vector>
+#include <thread>
+#include "compile.h"
+#include "profile.h"
+#include "thread_pool.h"
 #include "visit.h"
-#include "koopa.h"
-#include "ast.h"
 
 using namespace std;
 
-// 声明 lexer 的输入, 以及 parser 函数
-// 为什么不引用 sysy.tab.hpp 呢? 因为首先里面没有 yyin 的定义
-// 其次, 因为这个文件不是我们自己写的, 而是被 Bison 生成出来的
-// 你的代码编辑器/IDE 很可能找不到这个文件, 然后会给你报错 (虽然编译不会出错)
-// 看起来会很烦人, 于是干脆采用这种看起来 dirty 但实际很有效的手段
-extern FILE *yyin;
-extern int yyparse(unique_ptr<BaseAST> &ast);
-
-int main(int argc, const char *argv[])
+// 输出各阶段的耗时统计, json_path 为空时输出到 stderr
+static void report_phases(const string &json_path)
 {
-  // 解析命令行参数. 测试脚本/评测平台要求你的编译器能接收如下参数:
-  // compiler 模式 输入文件 -o 输出文件
-  assert(argc == 5);
-  auto mode = argv[1];
-  auto input = argv[2];
-  auto output = argv[4];
+  if (json_path.empty())
+  {
+    phase_timer.report(cerr);
+    return;
+  }
+  ofstream json(json_path);
+  assert(json.is_open());
+  phase_timer.report_json(json);
+}
 
-  // 打开输入文件, 并且指定 lexer 在解析的时候读取这个文件
-  yyin = fopen(input, "r");
-  assert(yyin);
-  // 打开输出文件, 准备写入
-  ofstream fout(output);
-  assert(fout.is_open());
-  // 调用 parser 函数, parser 函数会进一步调用 lexer 解析输入文件的
-  unique_ptr<BaseAST> ast;
-  auto ret = yyparse(ast);
-  assert(!ret);
-  // 打印 AST
-  if (string(mode) == "-dump")
+// 批量编译: 清单文件的每一行是 "输入文件 输出文件", 空行和 # 开头的行被忽略
+// 所有文件在线程池 pool 上并行编译, 有文件编译失败时返回非 0
+static int compile_batch(const CompileOptions &base, const string &manifest, ThreadPool &pool)
+{
+  ifstream fin(manifest);
+  assert(fin.is_open());
+  vector<CompileOptions> tasks;
+  string line;
+  while (getline(fin, line))
   {
-    streambuf *oldcoutbuf = cout.rdbuf(fout.rdbuf());
-    ast->Dump();
-    cout.rdbuf(oldcoutbuf);
-    fout.close();
-    return 0;
+    istringstream iss(line);
+    CompileOptions options = base;
+    if (!(iss >> options.input) || options.input[0] == '#')
+      continue;
+    if (!(iss >> options.output))
+    {
+      cerr << "error: no output file for " << options.input << endl;
+      return 1;
+    }
+    tasks.push_back(options);
   }
-  // 生成 IR
-  koopa_raw_program_t raw = *(koopa_raw_program_t *)ast->GenerateIR_ret();
-  koopa_program_t program;
-  koopa_error_code_t error = koopa_generate_raw_to_koopa(&raw, &program);
-  if (error != KOOPA_EC_SUCCESS)
+
+  vector<int> results(tasks.size(), 0);
+  ThreadPool::TaskGroup group;
+  for (size_t i = 0; i < tasks.size(); i++)
   {
-    std::cout << "generate raw to koopa error: " << error << std::endl;
-    return 0;
+    pool.submit([&tasks, &results, i]
+                { results[i] = compile(tasks[i]); },
+                group);
   }
-  size_t len = 0;
-  koopa_dump_to_string(program, nullptr, &len);
-  char *buf = new char[len + 1];
-  len++;
-  error = koopa_dump_to_string(program, buf, &len);
-  if (error != KOOPA_EC_SUCCESS)
+  pool.wait(group);
+
+  int failed = 0;
+  for (size_t i = 0; i < tasks.size(); i++)
   {
-    std::cout << "dump to string error: " << error << std::endl;
-    return 0;
+    if (results[i] != 0)
+    {
+      cerr << "error: failed to compile " << tasks[i].input << endl;
+      failed++;
+    }
   }
-  koopa_parse_from_string(buf, &program);
+  return failed == 0 ? 0 : 1;
+}
 
-  if (string(mode) == "-koopa")
+int main(int argc, const char *argv[])
+{
+  // 解析命令行参数. 测试脚本/评测平台要求你的编译器能接收如下参数:
+  // compiler 模式 输入文件 -o 输出文件 [选项]
+  // 此外还支持批量编译:
+  // compiler 模式 -batch 清单文件 [选项]
+  // 模式 -interp 不生成代码, 而是解释执行生成的 Koopa IR: 程序的输入输出为 stdin / stdout,
+  // 各函数和基本块执行的指令条数写入输出文件, 编译器的返回值为程序 main 的返回值
+  // 选项:
+  //   -direct               不经过 Koopa 文本的 dump/parse 往返, 直接把内存中的 raw program 交给后端
+  //   -O0                   不运行 IR 上的优化 pass
+  //   -unroll=<n>           循环部分展开的倍数, 默认为 4, 小于 2 时不做部分展开
+  //   -time-phases          在 stderr 输出各阶段的耗时, 内存分配次数和峰值 RSS (仅单文件模式)
+  //   -time-phases=<file>   同上, 但以 JSON 格式写入 file
+  //   -jobs=<n>             使用的线程数. 批量编译时默认为 CPU 核数, 单文件时默认为 1
+  //                         线程数大于 1 时, 后端为各个函数并行生成代码
+  assert(argc >= 4);
+  CompileOptions options;
+  options.mode = argv[1];
+  bool batch = string(argv[2]) == "-batch";
+  string manifest = "";
+  int first_option = 4;
+  if (batch)
+  {
+    manifest = argv[3];
+  }
+  else
   {
-    koopa_dump_to_file(program, output);
-    koopa_delete_program(program);
+    assert(argc >= 5);
+    options.input = argv[2];
+    options.output = argv[4];
+    first_option = 5;
   }
-  else if (string(mode) == "-riscv")
+  bool time_phases = false;
+  string time_phases_json = "";
+  size_t jobs = 0;
+  for (int i = first_option; i < argc; i++)
   {
-    koopa_raw_program_builder_t builder = koopa_new_raw_program_builder();
-    koopa_raw_program_t raw = koopa_build_raw_program(builder, program);
-    koopa_delete_program(program);
-    streambuf *oldcoutbuf = cout.rdbuf(fout.rdbuf());
-    string ret = "";
-    ret += Visit(raw);
-    cout << ret;
-    cout.rdbuf(oldcoutbuf);
-    fout.close();
-    koopa_delete_raw_program_builder(builder);
+    string option = argv[i];
+    if (option == "-direct")
+      options.direct = true;
+    else if (option == "-O0")
+      options.optimize = false;
+    else if (option.rfind("-unroll=", 0) == 0)
+      options.unroll = stoi(option.substr(strlen("-unroll=")));
+    else if (option == "-time-phases")
+      time_phases = true;
+    else if (option.rfind("-time-phases=", 0) == 0)
+    {
+      time_phases = true;
+      time_phases_json = option.substr(strlen("-time-phases="));
+    }
+    else if (option.rfind("-jobs=", 0) == 0)
+      jobs = stoul(option.substr(strlen("-jobs=")));
+    else
+      assert(false);
   }
-  else if (string(mode) == "-perf")
+
+  if (jobs == 0)
+    jobs = batch ? thread::hardware_concurrency() : 1;
+  // 批量编译的各个文件与后端的各个函数共用一个线程池
+  unique_ptr<ThreadPool> pool;
+  if (jobs > 1 || batch)
   {
-    koopa_raw_program_builder_t builder = koopa_new_raw_program_builder();
-    koopa_raw_program_t raw = koopa_build_raw_program(builder, program);
-    koopa_delete_program(program);
-    streambuf *oldcoutbuf = cout.rdbuf(fout.rdbuf());
-    string ret = "";
-    ret += Visit(raw);
-    cout << ret;
-    cout.rdbuf(oldcoutbuf);
-    fout.close();
-    koopa_delete_raw_program_builder(builder);
+    pool.reset(new ThreadPool(jobs));
+    backend_pool = pool.get();
   }
-  return 0;
+
+  if (batch)
+  {
+    // 多个文件同时编译时各阶段的耗时没有意义; -dump 会改写 cout, -interp 使用 stdin / stdout, 也不能并行
+    assert(!time_phases);
+    assert(options.mode != "-dump");
+    assert(options.mode != "-interp");
+    return compile_batch(options, manifest, *pool);
+  }
+
+  int ret = compile(options);
+  if (time_phases)
+    report_phases(time_phases_json);
+  return ret;
 }
@@ -0,0 +1,247 @@
+#include "opt.h"
+#include <string>
+#include "arena.h"
+#include "ast.h"
+
+/**********************************************************************************************************/
+/************************************************Mem2Reg***************************************************/
+/**********************************************************************************************************/
+
+// 按 Cytron 等人的方法构造 SSA:
+// 1. 找出只作为 load 的地址和 store 的目标出现的 i32 alloc
+// 2. 在写入这些变量的基本块的迭代支配边界上, 且变量在此处活跃时, 为基本块添加参数 (pruned SSA)
+// 3. 沿支配树遍历, 把 load 替换为当前的值, 删除 store 和 alloc, 并在跳转时传入各个参数的值
+
+void mem2reg(koopa_raw_function_data_t *func)
+{
+    remove_unreachable_blocks(func);
+    CFG cfg(func);
+    size_t n = cfg.blocks.size();
+
+    // 可以提升的变量
+    std::unordered_map<koopa_raw_value_t, int> var_of;
+    std::vector<koopa_raw_value_t> vars;
+    for (auto bb : cfg.blocks)
+    {
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+        {
+            auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+            if (inst->kind.tag == KOOPA_RVT_ALLOC && inst->ty->data.pointer.base->tag == KOOPA_RTT_INT32)
+            {
+                var_of[inst] = vars.size();
+                vars.push_back(inst);
+            }
+        }
+    }
+    if (vars.empty())
+    {
+        return;
+    }
+    std::vector<char> promotable(vars.size(), 1);
+    for (auto bb : cfg.blocks)
+    {
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+        {
+            auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+            for_each_operand(inst, [&](koopa_raw_value_t &op)
+                             {
+                                 auto it = var_of.find(op);
+                                 if (it == var_of.end())
+                                     return;
+                                 bool is_addr = (inst->kind.tag == KOOPA_RVT_LOAD && &op == &inst->kind.data.load.src) ||
+                                                (inst->kind.tag == KOOPA_RVT_STORE && &op == &inst->kind.data.store.dest);
+                                 if (!is_addr)
+                                     promotable[it->second] = 0; });
+        }
+    }
+
+    // 每个变量被写入的基本块, 以及在写入之前就被读取的基本块
+    size_t var_count = vars.size();
+    std::vector<std::vector<int>> def_blocks(var_count), use_blocks(var_count);
+    std::vector<int> defined_in(var_count, -1), used_in(var_count, -1);
+    for (int b : cfg.rpo)
+    {
+        auto bb = cfg.blocks[b];
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+        {
+            auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+            if (inst->kind.tag == KOOPA_RVT_LOAD)
+            {
+                auto it = var_of.find(inst->kind.data.load.src);
+                if (it != var_of.end() && defined_in[it->second] != b && used_in[it->second] != b)
+                {
+                    used_in[it->second] = b;
+                    use_blocks[it->second].push_back(b);
+                }
+            }
+            else if (inst->kind.tag == KOOPA_RVT_STORE)
+            {
+                auto it = var_of.find(inst->kind.data.store.dest);
+                if (it != var_of.end() && defined_in[it->second] != b)
+                {
+                    defined_in[it->second] = b;
+                    def_blocks[it->second].push_back(b);
+                }
+            }
+        }
+    }
+
+    // 放置基本块参数
+    cfg.compute_frontiers();
+    std::vector<std::vector<int>> block_vars(n);
+    std::vector<std::vector<koopa_raw_value_t>> block_params(n);
+    std::vector<int> live_stamp(n, -1), def_stamp(n, -1), placed_stamp(n, -1);
+    std::vector<int> worklist;
+    for (size_t v = 0; v < var_count; v++)
+    {
+        if (!promotable[v])
+            continue;
+        // 变量在入口处活跃的基本块
+        for (int b : def_blocks[v])
+            def_stamp[b] = v;
+        worklist = use_blocks[v];
+        for (int b : worklist)
+            live_stamp[b] = v;
+        while (!worklist.empty())
+        {
+            int b = worklist.back();
+            worklist.pop_back();
+            for (int p : cfg.preds[b])
+            {
+                if (cfg.reachable(p) && live_stamp[p] != (int)v && def_stamp[p] != (int)v)
+                {
+                    live_stamp[p] = v;
+                    worklist.push_back(p);
+                }
+            }
+        }
+        // 迭代支配边界
+        worklist = def_blocks[v];
+        while (!worklist.empty())
+        {
+            int b = worklist.back();
+            worklist.pop_back();
+            for (int f : cfg.frontiers[b])
+            {
+                if (placed_stamp[f] == (int)v || live_stamp[f] != (int)v)
+                    continue;
+                placed_stamp[f] = v;
+                block_vars[f].push_back(v);
+                if (def_stamp[f] != (int)v)
+                {
+                    def_stamp[f] = v;
+                    worklist.push_back(f);
+                }
+            }
+        }
+    }
+    for (size_t b = 0; b < n; b++)
+    {
+        if (block_vars[b].empty())
+            continue;
+        auto bb = cfg.blocks[b];
+        std::vector<const void *> params;
+        for (int v : block_vars[b])
+        {
+            const char *name = nullptr;
+            if (vars[v]->name != nullptr)
+                name = raw_arena.make_string(std::string("%") + (vars[v]->name + 1));
+            auto param = make_block_param(vars[v]->ty->data.pointer.base, name, bb->params.len + params.size());
+            params.push_back(param);
+            block_params[b].push_back(param);
+        }
+        slice_append(bb->params, params);
+    }
+
+    // 沿支配树重命名, 未初始化的变量读到 0
+    koopa_raw_value_t zero = generate_number(0);
+    std::vector<koopa_raw_value_t> cur(var_count, zero);
+    // 每个栈帧记录进入基本块前被改写的变量的旧值, 离开时恢复
+    class RenameFrame
+    {
+    public:
+        int block;
+        size_t child;
+        std::vector<std::pair<int, koopa_raw_value_t>> saved;
+    };
+    std::vector<RenameFrame> stack;
+    auto enter = [&](int b)
+    {
+        stack.push_back({b, 0, {}});
+        auto &saved = stack.back().saved;
+        auto set = [&](int v, koopa_raw_value_t value)
+        {
+            saved.push_back({v, cur[v]});
+            cur[v] = value;
+        };
+        for (size_t k = 0; k < block_vars[b].size(); k++)
+            set(block_vars[b][k], block_params[b][k]);
+
+        auto bb = cfg.blocks[b];
+        uint32_t len = 0;
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+        {
+            auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+            auto &kind = inst->kind;
+            if (kind.tag == KOOPA_RVT_ALLOC && var_of.count(inst) && promotable[var_of[inst]])
+                continue;
+            // 支配树上 load 的使用者都在它之后, 替换后再访问到它们时操作数已经是当前的值
+            if (kind.tag == KOOPA_RVT_LOAD)
+            {
+                auto it = var_of.find(kind.data.load.src);
+                if (it != var_of.end() && promotable[it->second])
+                {
+                    replace_all_uses(inst, cur[it->second]);
+                    drop_operand_uses(inst);
+                    continue;
+                }
+            }
+            if (kind.tag == KOOPA_RVT_STORE)
+            {
+                auto it = var_of.find(kind.data.store.dest);
+                if (it != var_of.end() && promotable[it->second])
+                {
+                    set(it->second, kind.data.store.value);
+                    drop_operand_uses(inst);
+                    continue;
+                }
+            }
+            bb->insts.buffer[len++] = inst;
+        }
+        bb->insts.len = len;
+
+        // 向后继传递参数
+        for_each_edge(terminator(bb), [&](koopa_raw_basic_block_t target, koopa_raw_slice_t &args)
+                      {
+                          int t = cfg.index.at(target);
+                          std::vector<const void *> values;
+                          for (int v : block_vars[t])
+                          {
+                              values.push_back(cur[v]);
+                              add_use(cur[v], terminator(bb));
+                          }
+                          slice_append(args, values); });
+    };
+    auto leave = [&]()
+    {
+        auto &saved = stack.back().saved;
+        for (auto it = saved.rbegin(); it != saved.rend(); ++it)
+            cur[it->first] = it->second;
+        stack.pop_back();
+    };
+
+    enter(cfg.rpo[0]);
+    while (!stack.empty())
+    {
+        auto &top = stack.back();
+        const auto &children = cfg.dom_children[top.block];
+        if (top.child < children.size())
+        {
+            enter(children[top.child++]);
+        }
+        else
+        {
+            leave();
+        }
+    }
+}
@@ -0,0 +1,165 @@
+#include "opt.h"
+
+/**********************************************************************************************************/
+/************************************************ModRef****************************************************/
+/**********************************************************************************************************/
+
+thread_local ModRef mod_ref;
+
+bool FunctionEffects::pure() const
+{
+    return ref_globals.empty() && mod_globals.empty() && !ref_args && !mod_args && !io;
+}
+
+bool FunctionEffects::readonly() const
+{
+    return mod_globals.empty() && !mod_args && !io;
+}
+
+// 调用点: 被调用的函数, 以及指针实参指向的全局变量 (nullptr 表示调用者的参数指向的对象)
+// 指向局部 alloc 的实参在调用者之外不可见, 不记录
+class CallSite
+{
+public:
+    koopa_raw_function_t callee;
+    std::vector<koopa_raw_value_t> bases;
+};
+
+// 把被调用者的摘要合并到调用者中, 返回调用者是否改变
+static bool merge_callee(FunctionEffects &caller, const FunctionEffects &callee, const CallSite &site)
+{
+    size_t before = caller.ref_globals.size() + caller.mod_globals.size();
+    bool flags_before[] = {caller.ref_args, caller.mod_args, caller.io};
+    if (&caller != &callee)
+    {
+        caller.ref_globals.insert(callee.ref_globals.begin(), callee.ref_globals.end());
+        caller.mod_globals.insert(callee.mod_globals.begin(), callee.mod_globals.end());
+    }
+    caller.io = caller.io || callee.io;
+    for (auto base : site.bases)
+    {
+        if (callee.ref_args)
+        {
+            if (base == nullptr)
+                caller.ref_args = true;
+            else
+                caller.ref_globals.insert(base);
+        }
+        if (callee.mod_args)
+        {
+            if (base == nullptr)
+                caller.mod_args = true;
+            else
+                caller.mod_globals.insert(base);
+        }
+    }
+    return caller.ref_globals.size() + caller.mod_globals.size() != before || flags_before[0] != caller.ref_args ||
+           flags_before[1] != caller.mod_args || flags_before[2] != caller.io;
+}
+
+void ModRef::analyze(const koopa_raw_program_t &program)
+{
+    effects.clear();
+    std::vector<std::pair<koopa_raw_function_t, std::vector<CallSite>>> sites;
+    for (uint32_t f = 0; f < program.funcs.len; f++)
+    {
+        auto func = (koopa_raw_function_data_t *)program.funcs.buffer[f];
+        auto &effect = effects[func];
+        if (func->bbs.len == 0)
+        {
+            // 运行时库函数
+            effect.ref_args = true;
+            effect.mod_args = true;
+            effect.io = true;
+            continue;
+        }
+        CFG cfg(func);
+        AliasAnalysis alias(cfg);
+        // 访问的对象是局部 alloc 时不记录, 否则是全局变量或参数指向的对象
+        auto access = [&](koopa_raw_value_t ptr, std::unordered_set<koopa_raw_value_t> &globals, bool &args)
+        {
+            auto base = alias.get(ptr).base;
+            if (base == nullptr)
+                args = true;
+            else if (base->kind.tag == KOOPA_RVT_GLOBAL_ALLOC)
+                globals.insert(base);
+        };
+        sites.push_back({func, {}});
+        for (int b : cfg.rpo)
+        {
+            auto bb = cfg.blocks[b];
+            for (uint32_t i = 0; i < bb->insts.len; i++)
+            {
+                const auto &kind = ((koopa_raw_value_t)bb->insts.buffer[i])->kind;
+                if (kind.tag == KOOPA_RVT_LOAD)
+                {
+                    access(kind.data.load.src, effect.ref_globals, effect.ref_args);
+                }
+                else if (kind.tag == KOOPA_RVT_STORE)
+                {
+                    access(kind.data.store.dest, effect.mod_globals, effect.mod_args);
+                }
+                else if (kind.tag == KOOPA_RVT_CALL)
+                {
+                    CallSite site = {kind.data.call.callee, {}};
+                    const auto &args = kind.data.call.args;
+                    for (uint32_t j = 0; j < args.len; j++)
+                    {
+                        auto arg = (koopa_raw_value_t)args.buffer[j];
+                        if (arg->ty->tag != KOOPA_RTT_POINTER)
+                            continue;
+                        auto base = alias.get(arg).base;
+                        if (base == nullptr || base->kind.tag == KOOPA_RVT_GLOBAL_ALLOC)
+                            site.bases.push_back(base);
+                    }
+                    sites.back().second.push_back(site);
+                }
+            }
+        }
+    }
+
+    // 沿调用边传播到不动点, 摘要只会增大
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (const auto &item : sites)
+        {
+            auto &caller = effects[item.first];
+            for (const auto &site : item.second)
+                changed = merge_callee(caller, get(site.callee), site) || changed;
+        }
+    }
+}
+
+const FunctionEffects &ModRef::get(koopa_raw_function_t func) const
+{
+    auto it = effects.find(func);
+    return it == effects.end() ? unknown : it->second;
+}
+
+bool ModRef::call_may_mod(koopa_raw_value_t call, const AliasAnalysis &alias, const PointerInfo &info) const
+{
+    if (!alias.call_may_access(info))
+        return false;
+    auto it = effects.find(call->kind.data.call.callee);
+    if (it == effects.end())
+        return true;
+    const auto &effect = it->second;
+    // 调用者参数指向的对象可能是任何全局变量
+    if (info.base == nullptr ? !effect.mod_globals.empty() : effect.mod_globals.count(info.base) != 0)
+        return true;
+    if (!effect.mod_args)
+        return false;
+    const auto &args = call->kind.data.call.args;
+    for (uint32_t i = 0; i < args.len; i++)
+    {
+        auto arg = (koopa_raw_value_t)args.buffer[i];
+        if (arg->ty->tag != KOOPA_RTT_POINTER)
+            continue;
+        auto base = alias.get(arg).base;
+        if (base == nullptr || info.base == nullptr || base == info.base)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,827 @@
+#include "opt.h"
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include "arena.h"
+#include "ast.h"
+#include "profile.h"
+
+/**********************************************************************************************************/
+/***********************************************Optimize***************************************************/
+/**********************************************************************************************************/
+
+// 对每个有函数体的函数运行 pass, 并记录在 phase_timer 中
+// 新建的整数常量通过 const_pool 与函数中已有的常量共享
+template <typename F>
+static void run_pass(koopa_raw_program_t &program, const char *name, F pass)
+{
+    phase_timer.begin(name);
+    for (uint32_t i = 0; i < program.funcs.len; i++)
+    {
+        auto func = (koopa_raw_function_data_t *)program.funcs.buffer[i];
+        if (func->bbs.len != 0)
+        {
+            const_pool.enter_func(func);
+            pass(func);
+            const_pool.exit_func();
+        }
+    }
+    phase_timer.end();
+}
+
+void optimize_raw_program(koopa_raw_program_t &program, int unroll_factor)
+{
+    // 局部变量不计入副作用摘要, mem2reg 之前分析也同样精确
+    phase_timer.begin("modref");
+    mod_ref.analyze(program);
+    phase_timer.end();
+    run_pass(program, "mem2reg", mem2reg);
+    run_pass(program, "sccp", sccp);
+    run_pass(program, "dce", dce);
+    run_pass(program, "tailrec", tail_recursion);
+    phase_timer.begin("inline");
+    inline_functions(program);
+    phase_timer.end();
+    // 内联后更多的全局变量只在 main 中使用, 改为局部变量后再运行一次 mem2reg
+    phase_timer.begin("globalopt");
+    optimize_globals(program);
+    phase_timer.end();
+    run_pass(program, "mem2reg", mem2reg);
+    run_pass(program, "sccp", sccp);
+    run_pass(program, "dce", dce);
+    run_pass(program, "simplifycfg", simplify_cfg);
+    run_pass(program, "gvn", gvn);
+    run_pass(program, "licm", licm);
+    run_pass(program, "unroll", [&](koopa_raw_function_data_t *func)
+             { unroll(func, unroll_factor); });
+    // 展开后出现的常量下标
+    phase_timer.begin("globalopt");
+    optimize_globals(program);
+    phase_timer.end();
+    run_pass(program, "sccp", sccp);
+    run_pass(program, "simplifycfg", simplify_cfg);
+    run_pass(program, "gvn", gvn);
+    run_pass(program, "dse", dse);
+    // 指针参数会使 alloc 被视为逃逸, 在 DSE 之后运行
+    run_pass(program, "lsr", lsr);
+    run_pass(program, "dce", dce);
+    run_pass(program, "simplifycfg", simplify_cfg);
+}
+
+/**********************************************************************************************************/
+/**************************************************CFG*****************************************************/
+/**********************************************************************************************************/
+
+CFG::CFG(koopa_raw_function_t func)
+{
+    size_t n = func->bbs.len;
+    for (size_t i = 0; i < n; i++)
+    {
+        auto bb = (koopa_raw_basic_block_data_t *)func->bbs.buffer[i];
+        blocks.push_back(bb);
+        index[bb] = i;
+    }
+    succs.resize(n);
+    preds.resize(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        for_each_edge(terminator(blocks[i]), [&](koopa_raw_basic_block_t target, koopa_raw_slice_t &)
+                      {
+                          int j = index.at(target);
+                          succs[i].push_back(j);
+                          preds[j].push_back(i); });
+    }
+
+    // 非递归的深度优先遍历, 得到后序
+    std::vector<int> post;
+    std::vector<char> visited(n, 0);
+    std::vector<std::pair<int, size_t>> dfs;
+    if (n != 0)
+    {
+        dfs.push_back({0, 0});
+        visited[0] = 1;
+    }
+    while (!dfs.empty())
+    {
+        auto &top = dfs.back();
+        if (top.second < succs[top.first].size())
+        {
+            int next = succs[top.first][top.second++];
+            if (!visited[next])
+            {
+                visited[next] = 1;
+                dfs.push_back({next, 0});
+            }
+        }
+        else
+        {
+            post.push_back(top.first);
+            dfs.pop_back();
+        }
+    }
+    rpo.assign(post.rbegin(), post.rend());
+    rpo_index.assign(n, -1);
+    for (size_t i = 0; i < rpo.size(); i++)
+    {
+        rpo_index[rpo[i]] = i;
+    }
+    compute_dominators();
+}
+
+bool CFG::reachable(int b) const
+{
+    return rpo_index[b] >= 0;
+}
+
+bool CFG::dominates(int a, int b) const
+{
+    while (b != a && idom[b] != b)
+    {
+        b = idom[b];
+    }
+    return b == a;
+}
+
+// Cooper, Harvey, Kennedy 的迭代算法
+void CFG::compute_dominators()
+{
+    size_t n = blocks.size();
+    idom.assign(n, -1);
+    dom_children.assign(n, {});
+    if (rpo.empty())
+    {
+        return;
+    }
+    auto intersect = [&](int a, int b)
+    {
+        while (a != b)
+        {
+            while (rpo_index[a] > rpo_index[b])
+                a = idom[a];
+            while (rpo_index[b] > rpo_index[a])
+                b = idom[b];
+        }
+        return a;
+    };
+    idom[rpo[0]] = rpo[0];
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = 1; i < rpo.size(); i++)
+        {
+            int b = rpo[i];
+            int new_idom = -1;
+            for (int p : preds[b])
+            {
+                if (idom[p] < 0)
+                    continue;
+                new_idom = new_idom < 0 ? p : intersect(p, new_idom);
+            }
+            if (new_idom != idom[b])
+            {
+                idom[b] = new_idom;
+                changed = true;
+            }
+        }
+    }
+    for (size_t i = 1; i < rpo.size(); i++)
+    {
+        dom_children[idom[rpo[i]]].push_back(rpo[i]);
+    }
+}
+
+void CFG::compute_frontiers()
+{
+    frontiers.assign(blocks.size(), {});
+    for (int b : rpo)
+    {
+        if (preds[b].size() < 2)
+            continue;
+        for (int p : preds[b])
+        {
+            if (!reachable(p))
+                continue;
+            int runner = p;
+            while (runner != idom[b])
+            {
+                auto &df = frontiers[runner];
+                if (df.empty() || df.back() != b)
+                    df.push_back(b);
+                runner = idom[runner];
+            }
+        }
+    }
+}
+
+/**********************************************************************************************************/
+/*************************************************Loop*****************************************************/
+/**********************************************************************************************************/
+
+LoopInfo::LoopInfo(const CFG &cfg)
+{
+    size_t n = cfg.blocks.size();
+    // 按 header 收集回边, 再从 latch 沿前驱反向搜索到 header 得到循环体
+    std::unordered_map<int, size_t> loop_index;
+    for (int b : cfg.rpo)
+    {
+        for (int h : cfg.succs[b])
+        {
+            if (!cfg.dominates(h, b))
+                continue;
+            auto it = loop_index.find(h);
+            if (it == loop_index.end())
+            {
+                it = loop_index.insert({h, loops.size()}).first;
+                loops.push_back({h, {}, {}, -1, 1});
+            }
+            auto &latches = loops[it->second].latches;
+            if (std::find(latches.begin(), latches.end(), b) == latches.end())
+                latches.push_back(b);
+        }
+    }
+    std::vector<char> in_loop(n, 0);
+    for (auto &loop : loops)
+    {
+        std::vector<int> worklist = loop.latches;
+        loop.blocks.push_back(loop.header);
+        in_loop[loop.header] = 1;
+        while (!worklist.empty())
+        {
+            int b = worklist.back();
+            worklist.pop_back();
+            if (in_loop[b])
+                continue;
+            in_loop[b] = 1;
+            loop.blocks.push_back(b);
+            for (int p : cfg.preds[b])
+            {
+                if (cfg.reachable(p) && !in_loop[p])
+                    worklist.push_back(p);
+            }
+        }
+        for (int b : loop.blocks)
+            in_loop[b] = 0;
+        std::sort(loop.blocks.begin(), loop.blocks.end(), [&](int a, int b)
+                  { return cfg.rpo_index[a] < cfg.rpo_index[b]; });
+    }
+
+    // 外层循环比内层循环大, 从大到小处理时, header 当前所在的最内层循环就是直接外层循环
+    std::sort(loops.begin(), loops.end(), [](const Loop &a, const Loop &b)
+              { return a.blocks.size() > b.blocks.size(); });
+    loop_of.assign(n, -1);
+    for (size_t i = 0; i < loops.size(); i++)
+    {
+        auto &loop = loops[i];
+        loop.parent = loop_of[loop.header];
+        if (loop.parent >= 0)
+            loop.depth = loops[loop.parent].depth + 1;
+        for (int b : loop.blocks)
+            loop_of[b] = i;
+    }
+    // 改为内层循环在前
+    std::reverse(loops.begin(), loops.end());
+    int m = loops.size();
+    for (auto &loop : loops)
+    {
+        if (loop.parent >= 0)
+            loop.parent = m - 1 - loop.parent;
+    }
+    for (auto &l : loop_of)
+    {
+        if (l >= 0)
+            l = m - 1 - l;
+    }
+}
+
+bool LoopInfo::contains(int loop, int b) const
+{
+    for (int l = loop_of[b]; l >= 0; l = loops[l].parent)
+    {
+        if (l == loop)
+            return true;
+    }
+    return false;
+}
+
+int LoopInfo::preheader(const CFG &cfg, int loop) const
+{
+    int ret = -1;
+    for (int p : cfg.preds[loops[loop].header])
+    {
+        if (!cfg.reachable(p) || contains(loop, p))
+            continue;
+        if (ret >= 0 && ret != p)
+            return -1;
+        ret = p;
+    }
+    if (ret < 0 || cfg.succs[ret].size() != 1)
+        return -1;
+    return ret;
+}
+
+koopa_raw_basic_block_data_t *insert_preheader(koopa_raw_function_data_t *func, const CFG &cfg, const Loop &loop)
+{
+    auto header = cfg.blocks[loop.header];
+    auto pre = raw_arena.make<koopa_raw_basic_block_data_t>();
+    pre->name = header->name == nullptr ? nullptr : raw_arena.make_string(std::string(header->name) + "_preheader");
+    pre->params = generate_slice(KOOPA_RSIK_VALUE);
+    pre->used_by = generate_slice(KOOPA_RSIK_VALUE);
+
+    // preheader 的参数原样传给 header
+    std::vector<const void *> params;
+    for (uint32_t i = 0; i < header->params.len; i++)
+    {
+        auto param = (koopa_raw_value_t)header->params.buffer[i];
+        params.push_back(make_block_param(param->ty, param->name, i));
+    }
+    slice_append(pre->params, params);
+    auto jump = generate_jump_inst(header);
+    slice_append(jump->kind.data.jump.args, params);
+    for (auto param : params)
+    {
+        add_use((koopa_raw_value_t)param, jump);
+    }
+    pre->insts = generate_slice(KOOPA_RSIK_VALUE);
+    slice_append(pre->insts, {jump});
+
+    // 循环外的入边改为跳到 preheader, 实参不变
+    std::vector<int> preds = cfg.preds[loop.header];
+    std::sort(preds.begin(), preds.end());
+    preds.erase(std::unique(preds.begin(), preds.end()), preds.end());
+    for (int p : preds)
+    {
+        if (!cfg.reachable(p) || std::find(loop.blocks.begin(), loop.blocks.end(), p) != loop.blocks.end())
+        {
+            continue;
+        }
+        redirect_edges(terminator(cfg.blocks[p]), header, pre);
+    }
+    // 只有一条入边时实参直接传给 header, 之后的 pass 可以在 preheader 的 jump 上看到初值
+    if (pre->used_by.len == 1)
+    {
+        forward_block_params(pre);
+    }
+
+    // 放在 header 之前
+    std::vector<const void *> bbs;
+    for (uint32_t i = 0; i < func->bbs.len; i++)
+    {
+        if (func->bbs.buffer[i] == header)
+            bbs.push_back(pre);
+        bbs.push_back(func->bbs.buffer[i]);
+    }
+    func->bbs.len = 0;
+    slice_append(func->bbs, bbs);
+    return pre;
+}
+
+void insert_preheaders(koopa_raw_function_data_t *func)
+{
+    CFG cfg(func);
+    LoopInfo loops(cfg);
+    for (size_t l = 0; l < loops.loops.size(); l++)
+    {
+        // 入口基本块不能有前驱, 不会是 header
+        if (loops.preheader(cfg, l) < 0)
+            insert_preheader(func, cfg, loops.loops[l]);
+    }
+}
+
+/**********************************************************************************************************/
+/*************************************************Alias****************************************************/
+/**********************************************************************************************************/
+
+AliasAnalysis::AliasAnalysis(const CFG &cfg)
+{
+    // 按逆后序访问, 地址计算的源总是先被访问到
+    for (int b : cfg.rpo)
+    {
+        auto bb = cfg.blocks[b];
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+        {
+            auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+            const auto &kind = inst->kind;
+            if (kind.tag == KOOPA_RVT_ALLOC)
+            {
+                pointer[inst] = {inst, 0};
+                escaped[inst] = false;
+                continue;
+            }
+            koopa_raw_value_t src, index;
+            if (kind.tag == KOOPA_RVT_GET_ELEM_PTR)
+            {
+                src = kind.data.get_elem_ptr.src;
+                index = kind.data.get_elem_ptr.index;
+            }
+            else if (kind.tag == KOOPA_RVT_GET_PTR)
+            {
+                src = kind.data.get_ptr.src;
+                index = kind.data.get_ptr.index;
+            }
+            else
+            {
+                continue;
+            }
+            PointerInfo info = get(src);
+            if (info.base != nullptr && info.offset >= 0 && index->kind.tag == KOOPA_RVT_INTEGER)
+            {
+                info.offset += index->kind.data.integer.value * words_of(inst->ty->data.pointer.base);
+            }
+            else
+            {
+                info.offset = -1;
+            }
+            pointer[inst] = info;
+        }
+    }
+
+    for (auto &item : pointer)
+    {
+        auto value = item.first;
+        auto base = item.second.base;
+        if (base == nullptr || base->kind.tag != KOOPA_RVT_ALLOC)
+        {
+            continue;
+        }
+        for (uint32_t i = 0; i < value->used_by.len; i++)
+        {
+            const auto &kind = ((koopa_raw_value_t)value->used_by.buffer[i])->kind;
+            bool safe = kind.tag == KOOPA_RVT_LOAD || kind.tag == KOOPA_RVT_GET_ELEM_PTR || kind.tag == KOOPA_RVT_GET_PTR ||
+                        (kind.tag == KOOPA_RVT_STORE && kind.data.store.value != value);
+            if (!safe)
+            {
+                escaped[base] = true;
+            }
+        }
+    }
+}
+
+PointerInfo AliasAnalysis::get(koopa_raw_value_t ptr) const
+{
+    if (ptr->kind.tag == KOOPA_RVT_GLOBAL_ALLOC)
+    {
+        return {ptr, 0};
+    }
+    auto it = pointer.find(ptr);
+    if (it == pointer.end())
+    {
+        return {nullptr, -1};
+    }
+    return it->second;
+}
+
+bool AliasAnalysis::is_private(koopa_raw_value_t base) const
+{
+    auto it = escaped.find(base);
+    return it != escaped.end() && !it->second;
+}
+
+bool AliasAnalysis::may_alias(const PointerInfo &a, const PointerInfo &b) const
+{
+    if (a.base == nullptr || b.base == nullptr)
+    {
+        auto known = a.base == nullptr ? b.base : a.base;
+        return known == nullptr || !is_private(known);
+    }
+    if (a.base != b.base)
+    {
+        return false;
+    }
+    return a.offset < 0 || b.offset < 0 || a.offset == b.offset;
+}
+
+bool AliasAnalysis::call_may_access(const PointerInfo &info) const
+{
+    return info.base == nullptr || !is_private(info.base);
+}
+
+bool AliasAnalysis::in_bounds(const PointerInfo &info) const
+{
+    return info.base != nullptr && info.offset >= 0 && info.offset < words_of(info.base->ty->data.pointer.base);
+}
+
+/**********************************************************************************************************/
+/************************************************Utils*****************************************************/
+/**********************************************************************************************************/
+
+koopa_raw_value_t terminator(koopa_raw_basic_block_t bb)
+{
+    assert(bb->insts.len != 0);
+    return (koopa_raw_value_t)bb->insts.buffer[bb->insts.len - 1];
+}
+
+void slice_append(koopa_raw_slice_t &slice, const std::vector<const void *> &items)
+{
+    if (items.empty())
+    {
+        return;
+    }
+    auto buffer = raw_arena.make_array<const void *>(slice.len + items.size());
+    std::copy(slice.buffer, slice.buffer + slice.len, buffer);
+    std::copy(items.begin(), items.end(), buffer + slice.len);
+    slice.buffer = buffer;
+    slice.len += items.size();
+}
+
+bool remove_unreachable_blocks(koopa_raw_function_data_t *func)
+{
+    CFG cfg(func);
+    if (cfg.rpo.size() == cfg.blocks.size())
+    {
+        return false;
+    }
+    uint32_t len = 0;
+    for (size_t i = 0; i < cfg.blocks.size(); i++)
+    {
+        if (cfg.reachable(i))
+        {
+            func->bbs.buffer[len++] = cfg.blocks[i];
+            continue;
+        }
+        auto bb = cfg.blocks[i];
+        for (uint32_t j = 0; j < bb->insts.len; j++)
+        {
+            drop_operand_uses((koopa_raw_value_t)bb->insts.buffer[j]);
+        }
+    }
+    func->bbs.len = len;
+    return true;
+}
+
+koopa_raw_value_data_t *make_block_param(koopa_raw_type_t ty, const char *name, size_t index)
+{
+    auto param = raw_arena.make<koopa_raw_value_data_t>();
+    param->ty = ty;
+    param->name = name;
+    param->used_by.kind = KOOPA_RSIK_VALUE;
+    param->kind.tag = KOOPA_RVT_BLOCK_ARG_REF;
+    param->kind.data.block_arg_ref.index = index;
+    return param;
+}
+
+void redirect_edges(koopa_raw_value_t term, koopa_raw_basic_block_t from, koopa_raw_basic_block_t to)
+{
+    auto &kind = const_cast<koopa_raw_value_kind_t &>(term->kind);
+    auto redirect = [&](koopa_raw_basic_block_t &target)
+    {
+        if (target != from)
+            return;
+        remove_use(target, term);
+        target = to;
+        add_use(target, term);
+    };
+    if (kind.tag == KOOPA_RVT_BRANCH)
+    {
+        redirect(kind.data.branch.true_bb);
+        redirect(kind.data.branch.false_bb);
+    }
+    else if (kind.tag == KOOPA_RVT_JUMP)
+    {
+        redirect(kind.data.jump.target);
+    }
+}
+
+void branch_to_jump(koopa_raw_value_t term, bool take_true)
+{
+    auto &kind = const_cast<koopa_raw_value_kind_t &>(term->kind);
+    assert(kind.tag == KOOPA_RVT_BRANCH);
+    drop_operand_uses(term);
+    auto branch = kind.data.branch;
+    kind.tag = KOOPA_RVT_JUMP;
+    kind.data.jump.target = take_true ? branch.true_bb : branch.false_bb;
+    kind.data.jump.args = take_true ? branch.true_args : branch.false_args;
+    add_operand_uses(term);
+}
+
+void forward_block_params(koopa_raw_basic_block_data_t *bb)
+{
+    assert(bb->used_by.len == 1);
+    auto term = (koopa_raw_value_t)bb->used_by.buffer[0];
+    for_each_edge(term, [&](koopa_raw_basic_block_t target, koopa_raw_slice_t &args)
+                  {
+                      if (target != bb)
+                          return;
+                      for (uint32_t i = 0; i < bb->params.len; i++)
+                      {
+                          auto arg = (koopa_raw_value_t)args.buffer[i];
+                          replace_all_uses((koopa_raw_value_t)bb->params.buffer[i], arg);
+                          remove_use(arg, term);
+                      }
+                      args.len = 0; });
+    bb->params.len = 0;
+}
+
+static koopa_raw_slice_t copy_slice(const koopa_raw_slice_t &slice)
+{
+    koopa_raw_slice_t ret = slice;
+    ret.buffer = raw_arena.make_array<const void *>(slice.len);
+    std::copy(slice.buffer, slice.buffer + slice.len, ret.buffer);
+    return ret;
+}
+
+std::vector<koopa_raw_basic_block_data_t *> clone_blocks(const std::vector<koopa_raw_basic_block_t> &blocks,
+                                                        std::unordered_map<koopa_raw_value_t, koopa_raw_value_t> &value_map)
+{
+    // 先建立所有基本块, 参数和指令, 再改写操作数, 因为操作数可能在后面的基本块中定义
+    std::unordered_map<koopa_raw_basic_block_t, koopa_raw_basic_block_t> block_map;
+    std::vector<koopa_raw_basic_block_data_t *> ret;
+    std::vector<koopa_raw_value_data_t *> insts;
+    for (auto bb : blocks)
+    {
+        auto new_bb = raw_arena.make<koopa_raw_basic_block_data_t>();
+        new_bb->name = bb->name;
+        new_bb->params = generate_slice(KOOPA_RSIK_VALUE);
+        new_bb->insts = generate_slice(KOOPA_RSIK_VALUE);
+        new_bb->used_by = generate_slice(KOOPA_RSIK_VALUE);
+        std::vector<const void *> params, new_insts;
+        for (uint32_t i = 0; i < bb->params.len; i++)
+        {
+            auto param = (koopa_raw_value_t)bb->params.buffer[i];
+            auto new_param = make_block_param(param->ty, param->name, i);
+            params.push_back(new_param);
+            value_map[param] = new_param;
+        }
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+        {
+            auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+            auto new_inst = raw_arena.make<koopa_raw_value_data_t>();
+            *new_inst = *inst;
+            new_inst->used_by = generate_slice(KOOPA_RSIK_VALUE);
+            new_insts.push_back(new_inst);
+            insts.push_back(new_inst);
+            value_map[inst] = new_inst;
+        }
+        slice_append(new_bb->params, params);
+        slice_append(new_bb->insts, new_insts);
+        block_map[bb] = new_bb;
+        ret.push_back(new_bb);
+    }
+
+    for (auto inst : insts)
+    {
+        auto &kind = inst->kind;
+        switch (kind.tag)
+        {
+        case KOOPA_RVT_BRANCH:
+            kind.data.branch.true_args = copy_slice(kind.data.branch.true_args);
+            kind.data.branch.false_args = copy_slice(kind.data.branch.false_args);
+            break;
+        case KOOPA_RVT_JUMP:
+            kind.data.jump.args = copy_slice(kind.data.jump.args);
+            break;
+        case KOOPA_RVT_CALL:
+            kind.data.call.args = copy_slice(kind.data.call.args);
+            break;
+        default:
+            break;
+        }
+        for_each_operand(inst, [&](koopa_raw_value_t &op)
+                         {
+                             auto it = value_map.find(op);
+                             if (it != value_map.end())
+                                 op = it->second;
+                             else if (op->kind.tag == KOOPA_RVT_INTEGER)
+                                 op = generate_number(op->kind.data.integer.value); });
+        auto map_block = [&](koopa_raw_basic_block_t &target)
+        {
+            auto it = block_map.find(target);
+            if (it != block_map.end())
+                target = it->second;
+        };
+        if (kind.tag == KOOPA_RVT_BRANCH)
+        {
+            map_block(kind.data.branch.true_bb);
+            map_block(kind.data.branch.false_bb);
+        }
+        else if (kind.tag == KOOPA_RVT_JUMP)
+        {
+            map_block(kind.data.jump.target);
+        }
+        add_operand_uses(inst);
+    }
+    return ret;
+}
+
+void remove_block_params(const CFG &cfg, int b, const std::vector<char> &keep)
+{
+    auto bb = cfg.blocks[b];
+    auto filter = [&](koopa_raw_slice_t &slice, koopa_raw_value_t user)
+    {
+        uint32_t len = 0;
+        for (uint32_t i = 0; i < slice.len; i++)
+        {
+            if (keep[i])
+            {
+                slice.buffer[len++] = slice.buffer[i];
+            }
+            else if (user != nullptr)
+            {
+                remove_use((koopa_raw_value_t)slice.buffer[i], user);
+            }
+        }
+        slice.len = len;
+    };
+    // 同一个前驱可能出现两次, 每条边只处理一次
+    std::vector<int> preds = cfg.preds[b];
+    std::sort(preds.begin(), preds.end());
+    preds.erase(std::unique(preds.begin(), preds.end()), preds.end());
+    for (int p : preds)
+    {
+        auto term = terminator(cfg.blocks[p]);
+        for_each_edge(term, [&](koopa_raw_basic_block_t target, koopa_raw_slice_t &args)
+                      {
+                          if (target == bb)
+                              filter(args, term); });
+    }
+    filter(bb->params, nullptr);
+    for (uint32_t i = 0; i < bb->params.len; i++)
+    {
+        auto param = (koopa_raw_value_data_t *)bb->params.buffer[i];
+        param->kind.data.block_arg_ref.index = i;
+    }
+}
+
+bool outside_frame(koopa_raw_value_t ptr)
+{
+    while (ptr->kind.tag == KOOPA_RVT_GET_PTR || ptr->kind.tag == KOOPA_RVT_GET_ELEM_PTR)
+        ptr = ptr->kind.tag == KOOPA_RVT_GET_PTR ? ptr->kind.data.get_ptr.src : ptr->kind.data.get_elem_ptr.src;
+    return ptr->kind.tag == KOOPA_RVT_GLOBAL_ALLOC || ptr->kind.tag == KOOPA_RVT_FUNC_ARG_REF ||
+           ptr->kind.tag == KOOPA_RVT_LOAD;
+}
+
+int64_t words_of(koopa_raw_type_t ty)
+{
+    if (ty->tag == KOOPA_RTT_ARRAY)
+    {
+        return ty->data.array.len * words_of(ty->data.array.base);
+    }
+    return 1;
+}
+
+bool fold_binary(koopa_raw_binary_op_t op, int32_t lhs, int32_t rhs, int32_t &result)
+{
+    uint32_t a = lhs, b = rhs;
+    switch (op)
+    {
+    case KOOPA_RBO_NOT_EQ:
+        result = lhs != rhs;
+        break;
+    case KOOPA_RBO_EQ:
+        result = lhs == rhs;
+        break;
+    case KOOPA_RBO_GT:
+        result = lhs > rhs;
+        break;
+    case KOOPA_RBO_LT:
+        result = lhs < rhs;
+        break;
+    case KOOPA_RBO_GE:
+        result = lhs >= rhs;
+        break;
+    case KOOPA_RBO_LE:
+        result = lhs <= rhs;
+        break;
+    case KOOPA_RBO_ADD:
+        result = a + b;
+        break;
+    case KOOPA_RBO_SUB:
+        result = a - b;
+        break;
+    case KOOPA_RBO_MUL:
+        result = a * b;
+        break;
+    case KOOPA_RBO_DIV:
+        if (rhs == 0)
+            return false;
+        // INT_MIN / -1 得到 INT_MIN
+        result = rhs == -1 ? (int32_t)(0u - a) : lhs / rhs;
+        break;
+    case KOOPA_RBO_MOD:
+        if (rhs == 0)
+            return false;
+        result = rhs == -1 ? 0 : lhs % rhs;
+        break;
+    case KOOPA_RBO_AND:
+        result = lhs & rhs;
+        break;
+    case KOOPA_RBO_OR:
+        result = lhs | rhs;
+        break;
+    case KOOPA_RBO_XOR:
+        result = lhs ^ rhs;
+        break;
+    case KOOPA_RBO_SHL:
+        result = a << (b & 31);
+        break;
+    case KOOPA_RBO_SHR:
+        result = a >> (b & 31);
+        break;
+    case KOOPA_RBO_SAR:
+        result = lhs >> (b & 31);
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
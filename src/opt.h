@@ -0,0 +1,246 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "koopa.h"
+#include "raw.h"
+
+/**********************************************************************************************************/
+/***********************************************Optimize***************************************************/
+/**********************************************************************************************************/
+
+// 在 raw program 上依次运行各个优化 pass, 在 GenerateIR 之后, 输出 Koopa IR 或生成 RISC-V 之前调用
+// pass 直接修改 GenerateIR 构建的 raw program, 新的节点都从 raw_arena 分配
+// unroll_factor 为循环部分展开的倍数, 小于 2 时不做部分展开
+void optimize_raw_program(koopa_raw_program_t &program, int unroll_factor);
+
+// 把不会被写的全局变量的读取折叠为初值, 把只在 main 中使用的 i32 全局变量改为 main 的局部变量
+void optimize_globals(koopa_raw_program_t &program);
+
+// 把紧跟着 ret 的对自身的调用改为跳回函数开头的循环
+void tail_recursion(koopa_raw_function_data_t *func);
+
+// 按代价模型把小函数和只有一个调用点的函数内联到调用者中, 递归的函数不内联, 最后删除不再被调用的函数
+void inline_functions(koopa_raw_program_t &program);
+
+// 把只通过 load / store 访问的 i32 alloc 提升为 SSA 值, 控制流汇合处用基本块参数代替 phi
+void mem2reg(koopa_raw_function_data_t *func);
+
+// 稀疏条件常量传播, 折叠常量, 把条件为常量的分支改为 jump, 并删除不可达的基本块
+void sccp(koopa_raw_function_data_t *func);
+
+// 删除没有副作用且结果不被使用的指令, 以及不被使用的基本块参数
+void dce(koopa_raw_function_data_t *func);
+
+// 删除不逃逸的局部变量和局部数组上之后不会被读取的 store
+void dse(koopa_raw_function_data_t *func);
+
+// 基于支配树的全局值编号, 合并等价的运算和地址计算, 以及之间没有被 store 或函数调用改写的 load
+void gvn(koopa_raw_function_data_t *func);
+
+// 把循环中不变的纯运算, 地址计算和不会被循环改写的 load 外提到循环的 preheader
+void licm(koopa_raw_function_data_t *func);
+
+// 完全展开执行次数为常量的小循环, 其余的计数循环按 factor 部分展开, 剩余的次数由原来的循环执行
+void unroll(koopa_raw_function_data_t *func, int factor);
+
+// 把循环中以归纳变量为下标的地址计算改为每次迭代递增的指针
+void lsr(koopa_raw_function_data_t *func);
+
+// 合并基本块, 穿过只有一条 jump 的基本块, 把两个目标相同的 branch 改为 jump, 并删除不可达的基本块
+void simplify_cfg(koopa_raw_function_data_t *func);
+
+/**********************************************************************************************************/
+/**************************************************CFG*****************************************************/
+/**********************************************************************************************************/
+
+// 函数的控制流图和支配树, 基本块用在 func->bbs 中的下标表示
+class CFG
+{
+public:
+    std::vector<koopa_raw_basic_block_data_t *> blocks;
+    std::unordered_map<koopa_raw_basic_block_t, int> index;
+    std::vector<std::vector<int>> succs;
+    std::vector<std::vector<int>> preds;
+    // 从入口可达的基本块, 按逆后序排列
+    std::vector<int> rpo;
+    std::vector<int> rpo_index;
+    // 直接支配者, 入口为自身, 不可达的块为 -1
+    std::vector<int> idom;
+    std::vector<std::vector<int>> dom_children;
+    // 支配边界, 调用 compute_frontiers 后才有
+    std::vector<std::vector<int>> frontiers;
+
+    explicit CFG(koopa_raw_function_t func);
+    bool reachable(int b) const;
+    // a 是否支配 b, 两者都应当可达
+    bool dominates(int a, int b) const;
+    void compute_frontiers();
+
+private:
+    void compute_dominators();
+};
+
+/**********************************************************************************************************/
+/*************************************************Loop*****************************************************/
+/**********************************************************************************************************/
+
+// 自然循环, 由支配 latch 的 header 和回边 latch -> header 确定, 同一个 header 的回边合并为一个循环
+class Loop
+{
+public:
+    int header;
+    // 循环中的基本块, 包括 header 和内层循环的基本块, 按逆后序排列
+    std::vector<int> blocks;
+    std::vector<int> latches;
+    // 直接外层循环在 LoopInfo::loops 中的下标, 没有时为 -1
+    int parent;
+    int depth;
+};
+
+// 函数中的所有自然循环, 内层循环排在外层循环之前
+class LoopInfo
+{
+public:
+    std::vector<Loop> loops;
+    // 基本块所在的最内层循环, 不在循环中为 -1
+    std::vector<int> loop_of;
+
+    explicit LoopInfo(const CFG &cfg);
+    bool contains(int loop, int b) const;
+    // 循环外只有一个前驱跳到 header, 且这个前驱以 jump 结束时返回它, 否则返回 -1
+    int preheader(const CFG &cfg, int loop) const;
+};
+
+// 为循环新建 preheader, 参数与 header 相同, 循环外的入边都改为跳到 preheader, 之后需要重新构建 CFG
+// 只有一条入边时 preheader 没有参数, 入边的实参由 preheader 的 jump 传给 header
+koopa_raw_basic_block_data_t *insert_preheader(koopa_raw_function_data_t *func, const CFG &cfg, const Loop &loop);
+
+// 为所有没有 preheader 的循环新建 preheader
+void insert_preheaders(koopa_raw_function_data_t *func);
+
+/**********************************************************************************************************/
+/*************************************************Alias****************************************************/
+/**********************************************************************************************************/
+
+// 指针指向的对象 (alloc 或 global alloc) 以及以 i32 为单位的偏移
+// base 为 nullptr 表示指针来自参数或内存, 指向未知的对象; offset 为 -1 表示偏移不是常量或访问整个对象
+class PointerInfo
+{
+public:
+    koopa_raw_value_t base;
+    int64_t offset;
+};
+
+// 函数内指针的别名分析
+// 局部 alloc 的地址只用作 load / store 的地址和 getelemptr / getptr 的源时不逃逸,
+// 不逃逸的 alloc 不会通过参数指针或函数调用被访问
+class AliasAnalysis
+{
+public:
+    explicit AliasAnalysis(const CFG &cfg);
+    PointerInfo get(koopa_raw_value_t ptr) const;
+    // 不逃逸的局部 alloc
+    bool is_private(koopa_raw_value_t base) const;
+    bool may_alias(const PointerInfo &a, const PointerInfo &b) const;
+    // 函数调用是否可能读写指针指向的位置
+    bool call_may_access(const PointerInfo &info) const;
+    // 指针是否一定指向对象内的一个 i32, 这样的 load 可以提前执行
+    bool in_bounds(const PointerInfo &info) const;
+
+private:
+    std::unordered_map<koopa_raw_value_t, PointerInfo> pointer;
+    std::unordered_map<koopa_raw_value_t, bool> escaped;
+};
+
+/**********************************************************************************************************/
+/************************************************ModRef****************************************************/
+/**********************************************************************************************************/
+
+// 函数的副作用摘要, 包括它调用的函数的副作用. 局部 alloc 在函数返回后不可见, 不计入摘要
+class FunctionEffects
+{
+public:
+    // 可能读 / 写的全局变量
+    std::unordered_set<koopa_raw_value_t> ref_globals;
+    std::unordered_set<koopa_raw_value_t> mod_globals;
+    // 是否可能读 / 写指针参数指向的对象
+    bool ref_args = false;
+    bool mod_args = false;
+    // 是否调用运行时库 (输入输出和计时)
+    bool io = false;
+
+    // 不访问内存也没有输入输出, 结果只由参数决定
+    bool pure() const;
+    // 不写内存也没有输入输出, 结果不被使用时可以删除
+    bool readonly() const;
+};
+
+// 基于调用图的过程间副作用分析
+// 先收集每个函数自身的 load / store 和调用点上指针实参指向的对象, 再沿调用边合并被调用者的摘要直到不动点.
+// 被调用者对参数的读写按调用点的实参换算为调用者对全局变量或自身参数的读写.
+// 运行时库函数按会读写指针参数并且有输入输出处理. 优化不会增加函数的副作用, 摘要在之后的 pass 中仍然成立
+class ModRef
+{
+public:
+    ModRef()
+    {
+        unknown.ref_args = true;
+        unknown.mod_args = true;
+        unknown.io = true;
+    }
+    void analyze(const koopa_raw_program_t &program);
+    // 没有分析过的函数按可能读写任何内存处理
+    const FunctionEffects &get(koopa_raw_function_t func) const;
+    // 调用指令是否可能改写 info 指向的位置, alias 是调用者的别名分析
+    bool call_may_mod(koopa_raw_value_t call, const AliasAnalysis &alias, const PointerInfo &info) const;
+
+private:
+    std::unordered_map<koopa_raw_function_t, FunctionEffects> effects;
+    FunctionEffects unknown;
+};
+
+// 当前编译的程序的副作用摘要, 每个线程各有一份
+extern thread_local ModRef mod_ref;
+
+/**********************************************************************************************************/
+/************************************************Utils*****************************************************/
+/**********************************************************************************************************/
+
+// 基本块的最后一条指令 (branch, jump 或 return)
+koopa_raw_value_t terminator(koopa_raw_basic_block_t bb);
+
+// 在 slice 末尾追加元素, slice 的缓冲区在 raw_arena 中重新分配
+void slice_append(koopa_raw_slice_t &slice, const std::vector<const void *> &items);
+
+// 删除从入口不可达的基本块, 返回是否有改动
+bool remove_unreachable_blocks(koopa_raw_function_data_t *func);
+
+// 新建一个基本块参数
+koopa_raw_value_data_t *make_block_param(koopa_raw_type_t ty, const char *name, size_t index);
+
+// 把终结指令中跳到 from 的边改为跳到 to, 实参不变
+void redirect_edges(koopa_raw_value_t term, koopa_raw_basic_block_t from, koopa_raw_basic_block_t to);
+
+// 把 branch 改为跳到其中一个目标的 jump
+void branch_to_jump(koopa_raw_value_t term, bool take_true);
+
+// 只有一条入边的基本块, 用实参代替参数, 并删除参数和实参
+void forward_block_params(koopa_raw_basic_block_data_t *bb);
+
+// 复制一组基本块, 复制体中的操作数按 value_map 替换, value_map 中没有的整数常量重新生成, 其余的值不变,
+// 跳到这组基本块的边改为跳到对应的复制. 复制出的参数和指令加入 value_map, 复制出的基本块不会加入函数
+std::vector<koopa_raw_basic_block_data_t *> clone_blocks(const std::vector<koopa_raw_basic_block_t> &blocks,
+                                                        std::unordered_map<koopa_raw_value_t, koopa_raw_value_t> &value_map);
+
+// 删除基本块 cfg.blocks[b] 中 keep 为 0 的参数, 以及所有入边上对应的实参, 被删除的参数应当已经没有使用者
+void remove_block_params(const CFG &cfg, int b, const std::vector<char> &keep);
+
+// 指针沿地址计算找到的来源是全局变量或者函数参数 (包括保存在 alloc 中的数组参数), 不指向当前函数的栈帧
+bool outside_frame(koopa_raw_value_t ptr);
+
+// 类型占用的 i32 个数
+int64_t words_of(koopa_raw_type_t ty);
+
+// 按 RISC-V 的语义计算二元运算, 除数为 0 时无法折叠, 返回 false
+bool fold_binary(koopa_raw_binary_op_t op, int32_t lhs, int32_t rhs, int32_t &result);
@@ -0,0 +1,191 @@
+#include "output.h"
+#include <algorithm>
+#include <charconv>
+#include "visit.h"
+
+/**********************************************************************************************************/
+/**********************************************OutputSink**************************************************/
+/**********************************************************************************************************/
+
+OutputSink &OutputSink::operator<<(const std::string &str)
+{
+    write(str.data(), str.size());
+    return *this;
+}
+
+OutputSink &OutputSink::operator<<(const char *str)
+{
+    write(str, strlen(str));
+    return *this;
+}
+
+OutputSink &OutputSink::operator<<(char ch)
+{
+    write(&ch, 1);
+    return *this;
+}
+
+OutputSink &OutputSink::operator<<(int value)
+{
+    char buf[16];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    write(buf, res.ptr - buf);
+    return *this;
+}
+
+OutputSink &OutputSink::operator<<(size_t value)
+{
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    write(buf, res.ptr - buf);
+    return *this;
+}
+
+/**********************************************************************************************************/
+/********************************************BufferedWriter************************************************/
+/**********************************************************************************************************/
+
+BufferedWriter::BufferedWriter(std::ostream &os, size_t capacity) : os(os), buffer(capacity), len(0)
+{
+}
+
+BufferedWriter::~BufferedWriter()
+{
+    flush();
+}
+
+void BufferedWriter::write(const char *data, size_t size)
+{
+    if (len + size > buffer.size())
+    {
+        flush();
+        if (size > buffer.size())
+        {
+            os.write(data, size);
+            return;
+        }
+    }
+    memcpy(buffer.data() + len, data, size);
+    len += size;
+}
+
+void BufferedWriter::flush()
+{
+    if (len != 0)
+    {
+        os.write(buffer.data(), len);
+        len = 0;
+    }
+    os.flush();
+}
+
+/**********************************************************************************************************/
+/**********************************************StringSink**************************************************/
+/**********************************************************************************************************/
+
+void StringSink::write(const char *data, size_t len)
+{
+    str.append(data, len);
+}
+
+/**********************************************************************************************************/
+/*********************************************PeepholeSink*************************************************/
+/**********************************************************************************************************/
+
+PeepholeSink::PeepholeSink(OutputSink &next) : next(next), sw_detected(false)
+{
+}
+
+void PeepholeSink::write(const char *data, size_t len)
+{
+    const char *end = data + len;
+    while (data != end)
+    {
+        const char *newline = (const char *)memchr(data, '\n', end - data);
+        if (newline == nullptr)
+        {
+            line.append(data, end - data);
+            return;
+        }
+        line.append(data, newline - data);
+        process_line(line);
+        line.clear();
+        data = newline + 1;
+    }
+}
+
+void PeepholeSink::flush()
+{
+    // 最后一行没有换行符时也按一行处理
+    if (!line.empty())
+    {
+        process_line(line);
+        line.clear();
+    }
+    next.flush();
+}
+
+// 处理一行汇编代码, 逻辑与之前对整段代码逐行扫描时相同
+void PeepholeSink::process_line(const std::string &line)
+{
+    std::string code_part = line;
+    size_t comment_pos = line.find('#');
+    std::string comment_part = "";
+    if (comment_pos != std::string::npos)
+    {
+        code_part = line.substr(0, comment_pos); // 获取指令部分
+        comment_part = line.substr(comment_pos); // 获取注释部分
+    }
+
+    // 去除空格并保留原有格式
+    std::string trimmed_code_part = code_part;
+    trimmed_code_part.erase(std::remove_if(trimmed_code_part.begin(), trimmed_code_part.end(), ::isspace), trimmed_code_part.end());
+
+    // 忽略空行
+    if (trimmed_code_part.empty())
+    {
+        next << line << '\n';
+        return;
+    }
+
+    // 如果是存储指令 (sw)，记录当前存储的寄存器
+    if (is_sw(trimmed_code_part))
+    {
+        prev_sw = trimmed_code_part;
+        sw_detected = true;
+    }
+    // 如果是加载指令 (lw)，尝试进行优化
+    else if (is_lw(trimmed_code_part))
+    {
+        if (sw_detected)
+        {
+            // 提取 lw 的目的寄存器 ("t0") 和地址 ("4(sp)")
+            size_t comma_pos = trimmed_code_part.find(',');
+            std::string lw_dst = trimmed_code_part.substr(2, comma_pos - 2);
+            std::string lw_addr = trimmed_code_part.substr(comma_pos + 1);
+
+            // 提取 sw 的源寄存器和地址
+            comma_pos = prev_sw.find(',');
+            std::string sw_src = prev_sw.substr(2, comma_pos - 2);
+            std::string sw_addr = prev_sw.substr(comma_pos + 1);
+
+            // 判断 lw 载入的地址与前一个 sw 存储的地址是否一致
+            if (lw_dst != "" && sw_src != "" && lw_addr == sw_addr)
+            {
+                // 使用 mv 替代 lw，避免冗余的内存加载
+                if (lw_dst != sw_src)
+                {
+                    next << "  mv " << lw_dst << ", " << sw_src << comment_part << '\n';
+                }
+                sw_detected = false; // 重置标志位
+                return;              // 跳过当前的 lw 指令
+            }
+        }
+        sw_detected = false; // 重置标志位
+    }
+    else
+    {
+        sw_detected = false;
+    }
+    next << line << '\n';
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstring>
+
+/**********************************************************************************************************/
+/**********************************************OutputSink**************************************************/
+/**********************************************************************************************************/
+
+// 汇编代码的输出端, 后端直接把代码追加到这里, 不再逐层拼接 std::string
+class OutputSink
+{
+public:
+    virtual ~OutputSink() = default;
+    virtual void write(const char *data, size_t len) = 0;
+    virtual void flush() {}
+
+    OutputSink &operator<<(const std::string &str);
+    OutputSink &operator<<(const char *str);
+    OutputSink &operator<<(char ch);
+    OutputSink &operator<<(int value);
+    OutputSink &operator<<(size_t value);
+};
+
+/**********************************************************************************************************/
+/********************************************BufferedWriter************************************************/
+/**********************************************************************************************************/
+
+// 带大缓冲区的输出, 缓冲区满或 flush 时整块写入 os
+class BufferedWriter : public OutputSink
+{
+public:
+    explicit BufferedWriter(std::ostream &os, size_t capacity = 1 << 20);
+    ~BufferedWriter();
+    void write(const char *data, size_t len) override;
+    void flush() override;
+
+private:
+    std::ostream &os;
+    std::vector<char> buffer;
+    size_t len;
+};
+
+/**********************************************************************************************************/
+/**********************************************StringSink**************************************************/
+/**********************************************************************************************************/
+
+// 输出到内存中的字符串
+class StringSink : public OutputSink
+{
+public:
+    std::string str;
+
+    void write(const char *data, size_t len) override;
+};
+
+/**********************************************************************************************************/
+/*********************************************PeepholeSink*************************************************/
+/**********************************************************************************************************/
+
+// 流式的窥孔优化: 按行接收代码, 只记住上一条 sw, 处理后的行写入 next
+// 紧跟在 sw 之后从同一地址读取的 lw 会被替换为 mv 或直接删除
+class PeepholeSink : public OutputSink
+{
+public:
+    explicit PeepholeSink(OutputSink &next);
+    void write(const char *data, size_t len) override;
+    void flush() override;
+
+private:
+    OutputSink &next;
+    std::string line;
+    std::string prev_sw;
+    bool sw_detected;
+
+    void process_line(const std::string &line);
+};
@@ -0,0 +1,136 @@
+#include "profile.h"
+#include <cstdlib>
+#include <new>
+#include <iomanip>
+#include <fstream>
+#include <cstring>
+#include <sys/resource.h>
+
+/**********************************************************************************************************/
+/*********************************************AllocCounter*************************************************/
+/**********************************************************************************************************/
+
+static std::atomic<size_t> alloc_count(0);
+
+void *operator new(size_t size)
+{
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+    void *ptr = std::malloc(size);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+size_t get_alloc_count()
+{
+    return alloc_count.load(std::memory_order_relaxed);
+}
+
+long get_peak_rss_kb()
+{
+    // ru_maxrss 会继承 exec 之前父进程的峰值 (例如从较大的 python 进程启动时), 优先读取只属于当前地址空间的 VmHWM
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmHWM:", 0) == 0)
+            return std::atol(line.c_str() + strlen("VmHWM:"));
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**********************************************************************************************************/
+/**********************************************PhaseTimer**************************************************/
+/**********************************************************************************************************/
+
+thread_local PhaseTimer phase_timer;
+
+void PhaseTimer::begin(const std::string &name)
+{
+    cur_name = name;
+    cur_alloc_count = get_alloc_count();
+    cur_start = std::chrono::steady_clock::now();
+}
+
+void PhaseTimer::end()
+{
+    auto now = std::chrono::steady_clock::now();
+    Phase phase;
+    phase.name = cur_name;
+    phase.wall_ms = std::chrono::duration<double, std::milli>(now - cur_start).count();
+    phase.alloc_count = get_alloc_count() - cur_alloc_count;
+    phase.peak_rss_kb = get_peak_rss_kb();
+    phases.push_back(phase);
+}
+
+void PhaseTimer::clear()
+{
+    phases.clear();
+}
+
+void PhaseTimer::report(std::ostream &os) const
+{
+    double total_ms = 0;
+    size_t total_allocs = 0;
+    os << std::left << std::setw(32) << "phase"
+       << std::right << std::setw(12) << "wall(ms)"
+       << std::setw(14) << "allocs"
+       << std::setw(16) << "peak rss(KB)" << "\n";
+    for (const auto &phase : phases)
+    {
+        os << std::left << std::setw(32) << phase.name
+           << std::right << std::setw(12) << std::fixed << std::setprecision(3) << phase.wall_ms
+           << std::setw(14) << phase.alloc_count
+           << std::setw(16) << phase.peak_rss_kb << "\n";
+        total_ms += phase.wall_ms;
+        total_allocs += phase.alloc_count;
+    }
+    os << std::left << std::setw(32) << "total"
+       << std::right << std::setw(12) << std::fixed << std::setprecision(3) << total_ms
+       << std::setw(14) << total_allocs
+       << std::setw(16) << get_peak_rss_kb() << "\n";
+}
+
+void PhaseTimer::report_json(std::ostream &os) const
+{
+    os << "{\n  \"phases\": [";
+    for (size_t i = 0; i < phases.size(); i++)
+    {
+        const auto &phase = phases[i];
+        os << (i == 0 ? "\n" : ",\n");
+        os << "    {\"name\": \"" << phase.name << "\", "
+           << "\"wall_ms\": " << std::fixed << std::setprecision(3) << phase.wall_ms << ", "
+           << "\"allocs\": " << phase.alloc_count << ", "
+           << "\"peak_rss_kb\": " << phase.peak_rss_kb << "}";
+    }
+    os << "\n  ],\n  \"peak_rss_kb\": " << get_peak_rss_kb() << "\n}\n";
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <ostream>
+
+/**********************************************************************************************************/
+/**********************************************PhaseTimer**************************************************/
+/**********************************************************************************************************/
+
+// 记录编译各阶段的墙钟时间, 内存分配次数以及峰值 RSS
+// 分配次数通过替换全局 operator new 统计, libkoopa 内部 (Rust) 的分配不计入
+class PhaseTimer
+{
+public:
+    class Phase
+    {
+    public:
+        std::string name;
+        double wall_ms;
+        size_t alloc_count;
+        long peak_rss_kb;
+    };
+
+    void begin(const std::string &name);
+    void end();
+    void clear();
+    void report(std::ostream &os) const;
+    void report_json(std::ostream &os) const;
+
+private:
+    std::string cur_name;
+    std::chrono::steady_clock::time_point cur_start;
+    size_t cur_alloc_count = 0;
+    std::vector<Phase> phases;
+};
+
+// 每个线程各自计时
+extern thread_local PhaseTimer phase_timer;
+
+// 当前进程调用 operator new 的总次数
+size_t get_alloc_count();
+
+// 当前进程的峰值 RSS (KB)
+long get_peak_rss_kb();
@@ -0,0 +1,676 @@
+#include "raw.h"
+#include "ast.h"
+#include <algorithm>
+
+/**********************************************************************************************************/
+/**********************************************NameManager*************************************************/
+/**********************************************************************************************************/
+
+const char *NameManager::unique_name(const char *name, bool is_global)
+{
+    std::string new_name = name;
+    auto is_used = [&](const std::string &str)
+    {
+        return global_names.count(str) || (!is_global && local_names.count(str));
+    };
+    for (int id = 0; is_used(new_name); id++)
+    {
+        new_name = std::string(name) + "_" + std::to_string(id);
+    }
+    if (is_global)
+    {
+        global_names.insert(new_name);
+    }
+    else
+    {
+        local_names.insert(new_name);
+    }
+    if (new_name == name)
+    {
+        return name;
+    }
+    return raw_arena.make_string(new_name);
+}
+
+const char *NameManager::global_name(const char *name)
+{
+    assert(name != nullptr);
+    return unique_name(name, true);
+}
+
+const char *NameManager::local_name(const char *name)
+{
+    if (name == nullptr)
+    {
+        return temp_name();
+    }
+    return unique_name(name, false);
+}
+
+const char *NameManager::temp_name()
+{
+    std::string name = "%" + std::to_string(next_id++);
+    local_names.insert(name);
+    return raw_arena.make_string(name);
+}
+
+void NameManager::enter_func_scope()
+{
+    next_id = 0;
+    local_names.clear();
+}
+
+void NameManager::exit_func_scope()
+{
+    next_id = 0;
+    local_names.clear();
+}
+
+/**********************************************************************************************************/
+/************************************************DefUse****************************************************/
+/**********************************************************************************************************/
+
+// used_by 的缓冲区容量总是不小于 len 向上取整到 2 的幂, 长度到达 2 的幂时扩容一倍
+static void used_by_push(koopa_raw_slice_t &used_by, koopa_raw_value_t user)
+{
+    uint32_t len = used_by.len;
+    if ((len & (len - 1)) == 0)
+    {
+        auto buffer = raw_arena.make_array<const void *>(len == 0 ? 1 : len * 2);
+        std::copy(used_by.buffer, used_by.buffer + len, buffer);
+        used_by.buffer = buffer;
+    }
+    used_by.buffer[used_by.len++] = user;
+}
+
+static void used_by_erase(koopa_raw_slice_t &used_by, koopa_raw_value_t user)
+{
+    for (uint32_t i = 0; i < used_by.len; i++)
+    {
+        if (used_by.buffer[i] == user)
+        {
+            used_by.buffer[i] = used_by.buffer[--used_by.len];
+            return;
+        }
+    }
+    assert(false);
+}
+
+void add_use(koopa_raw_value_t used, koopa_raw_value_t user)
+{
+    if (used->kind.tag != KOOPA_RVT_INTEGER)
+    {
+        used_by_push(const_cast<koopa_raw_value_data_t *>(used)->used_by, user);
+    }
+}
+
+void add_use(koopa_raw_basic_block_t used, koopa_raw_value_t user)
+{
+    used_by_push(const_cast<koopa_raw_basic_block_data_t *>(used)->used_by, user);
+}
+
+void remove_use(koopa_raw_value_t used, koopa_raw_value_t user)
+{
+    if (used->kind.tag != KOOPA_RVT_INTEGER)
+    {
+        used_by_erase(const_cast<koopa_raw_value_data_t *>(used)->used_by, user);
+    }
+}
+
+void remove_use(koopa_raw_basic_block_t used, koopa_raw_value_t user)
+{
+    used_by_erase(const_cast<koopa_raw_basic_block_data_t *>(used)->used_by, user);
+}
+
+void add_operand_uses(koopa_raw_value_t inst)
+{
+    for_each_operand(inst, [&](koopa_raw_value_t &op)
+                     { add_use(op, inst); });
+    for_each_edge(inst, [&](koopa_raw_basic_block_t target, koopa_raw_slice_t &)
+                  { add_use(target, inst); });
+}
+
+void drop_operand_uses(koopa_raw_value_t inst)
+{
+    for_each_operand(inst, [&](koopa_raw_value_t &op)
+                     { remove_use(op, inst); });
+    for_each_edge(inst, [&](koopa_raw_basic_block_t target, koopa_raw_slice_t &)
+                  { remove_use(target, inst); });
+}
+
+void replace_all_uses(koopa_raw_value_t from, koopa_raw_value_t to)
+{
+    if (from == to)
+    {
+        return;
+    }
+    // 同一条指令可能出现多次, 第一次就替换掉它的所有操作数
+    auto &used_by = const_cast<koopa_raw_value_data_t *>(from)->used_by;
+    for (uint32_t i = 0; i < used_by.len; i++)
+    {
+        auto user = (koopa_raw_value_t)used_by.buffer[i];
+        for_each_operand(user, [&](koopa_raw_value_t &op)
+                         {
+                             if (op == from)
+                             {
+                                 op = to;
+                                 add_use(to, user);
+                             } });
+    }
+    used_by.len = 0;
+}
+
+/**********************************************************************************************************/
+/***********************************************RawProgram*************************************************/
+/**********************************************************************************************************/
+
+void prepare_raw_program(koopa_raw_program_t &program)
+{
+    assign_names(program);
+    build_used_by(program);
+}
+
+// 名字的分配顺序与 Koopa 文本中符号第一次出现的顺序一致:
+// 基本块在第一次被定义或被跳转到时命名, 其余的值在定义时命名
+void assign_names(koopa_raw_program_t &program)
+{
+    NameManager name_manager;
+    for (size_t i = 0; i < program.values.len; ++i)
+    {
+        auto value = (koopa_raw_value_data_t *)program.values.buffer[i];
+        value->name = name_manager.global_name(value->name);
+    }
+    for (size_t i = 0; i < program.funcs.len; ++i)
+    {
+        auto func = (koopa_raw_function_data_t *)program.funcs.buffer[i];
+        func->name = name_manager.global_name(func->name);
+    }
+    for (size_t i = 0; i < program.funcs.len; ++i)
+    {
+        auto func = (koopa_raw_function_t)program.funcs.buffer[i];
+        if (func->bbs.len == 0)
+            continue;
+
+        name_manager.enter_func_scope();
+        std::unordered_set<koopa_raw_basic_block_t> is_named;
+        auto name_bb = [&](koopa_raw_basic_block_t bb)
+        {
+            if (is_named.insert(bb).second)
+            {
+                ((koopa_raw_basic_block_data_t *)bb)->name = name_manager.local_name(bb->name);
+            }
+        };
+        for (size_t j = 0; j < func->params.len; ++j)
+        {
+            auto param = (koopa_raw_value_data_t *)func->params.buffer[j];
+            param->name = name_manager.local_name(param->name);
+        }
+        for (size_t j = 0; j < func->bbs.len; ++j)
+        {
+            auto bb = (koopa_raw_basic_block_t)func->bbs.buffer[j];
+            name_bb(bb);
+            for (size_t k = 0; k < bb->params.len; ++k)
+            {
+                auto param = (koopa_raw_value_data_t *)bb->params.buffer[k];
+                param->name = name_manager.local_name(param->name);
+            }
+            for (size_t k = 0; k < bb->insts.len; ++k)
+            {
+                auto inst = (koopa_raw_value_data_t *)bb->insts.buffer[k];
+                if (inst->ty->tag != KOOPA_RTT_UNIT)
+                {
+                    inst->name = name_manager.local_name(inst->name);
+                }
+                if (inst->kind.tag == KOOPA_RVT_BRANCH)
+                {
+                    name_bb(inst->kind.data.branch.true_bb);
+                    name_bb(inst->kind.data.branch.false_bb);
+                }
+                else if (inst->kind.tag == KOOPA_RVT_JUMP)
+                {
+                    name_bb(inst->kind.data.jump.target);
+                }
+            }
+        }
+        name_manager.exit_func_scope();
+    }
+}
+
+void build_used_by(koopa_raw_program_t &program)
+{
+    std::unordered_map<const void *, std::vector<const void *>> users;
+    std::vector<koopa_raw_value_data_t *> values;
+    std::vector<koopa_raw_basic_block_data_t *> bbs;
+
+    auto add_user = [&](const void *used, koopa_raw_value_t user)
+    {
+        auto &vec = users[used];
+        if (vec.empty() || vec.back() != user)
+        {
+            vec.push_back(user);
+        }
+    };
+    std::function<void(koopa_raw_value_t, koopa_raw_value_t)> use;
+    use = [&](koopa_raw_value_t value, koopa_raw_value_t user)
+    {
+        if (value == nullptr)
+            return;
+        if (users.find(value) == users.end())
+        {
+            values.push_back((koopa_raw_value_data_t *)value);
+            users[value];
+            if (value->kind.tag == KOOPA_RVT_AGGREGATE)
+            {
+                const auto &elems = value->kind.data.aggregate.elems;
+                for (size_t i = 0; i < elems.len; ++i)
+                {
+                    use((koopa_raw_value_t)elems.buffer[i], value);
+                }
+            }
+        }
+        if (user != nullptr)
+        {
+            add_user(value, user);
+        }
+    };
+    auto use_args = [&](const koopa_raw_slice_t &args, koopa_raw_value_t user)
+    {
+        for (size_t i = 0; i < args.len; ++i)
+        {
+            use((koopa_raw_value_t)args.buffer[i], user);
+        }
+    };
+
+    for (size_t i = 0; i < program.values.len; ++i)
+    {
+        auto value = (koopa_raw_value_t)program.values.buffer[i];
+        use(value, nullptr);
+        use(value->kind.data.global_alloc.init, value);
+    }
+    for (size_t i = 0; i < program.funcs.len; ++i)
+    {
+        auto func = (koopa_raw_function_t)program.funcs.buffer[i];
+        for (size_t j = 0; j < func->params.len; ++j)
+        {
+            use((koopa_raw_value_t)func->params.buffer[j], nullptr);
+        }
+        for (size_t j = 0; j < func->bbs.len; ++j)
+        {
+            auto bb = (koopa_raw_basic_block_data_t *)func->bbs.buffer[j];
+            bbs.push_back(bb);
+            users[bb];
+            for (size_t k = 0; k < bb->params.len; ++k)
+            {
+                use((koopa_raw_value_t)bb->params.buffer[k], nullptr);
+            }
+        }
+        for (size_t j = 0; j < func->bbs.len; ++j)
+        {
+            auto bb = (koopa_raw_basic_block_t)func->bbs.buffer[j];
+            for (size_t k = 0; k < bb->insts.len; ++k)
+            {
+                auto inst = (koopa_raw_value_t)bb->insts.buffer[k];
+                use(inst, nullptr);
+                const auto &kind = inst->kind;
+                switch (kind.tag)
+                {
+                case KOOPA_RVT_LOAD:
+                    use(kind.data.load.src, inst);
+                    break;
+                case KOOPA_RVT_STORE:
+                    use(kind.data.store.value, inst);
+                    use(kind.data.store.dest, inst);
+                    break;
+                case KOOPA_RVT_GET_PTR:
+                    use(kind.data.get_ptr.src, inst);
+                    use(kind.data.get_ptr.index, inst);
+                    break;
+                case KOOPA_RVT_GET_ELEM_PTR:
+                    use(kind.data.get_elem_ptr.src, inst);
+                    use(kind.data.get_elem_ptr.index, inst);
+                    break;
+                case KOOPA_RVT_BINARY:
+                    use(kind.data.binary.lhs, inst);
+                    use(kind.data.binary.rhs, inst);
+                    break;
+                case KOOPA_RVT_BRANCH:
+                    use(kind.data.branch.cond, inst);
+                    use_args(kind.data.branch.true_args, inst);
+                    use_args(kind.data.branch.false_args, inst);
+                    add_user(kind.data.branch.true_bb, inst);
+                    add_user(kind.data.branch.false_bb, inst);
+                    break;
+                case KOOPA_RVT_JUMP:
+                    use_args(kind.data.jump.args, inst);
+                    add_user(kind.data.jump.target, inst);
+                    break;
+                case KOOPA_RVT_CALL:
+                    use_args(kind.data.call.args, inst);
+                    break;
+                case KOOPA_RVT_RETURN:
+                    use(kind.data.ret.value, inst);
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+    }
+
+    for (auto value : values)
+    {
+        auto &vec = users[value];
+        value->used_by = vec.empty() ? generate_slice(KOOPA_RSIK_VALUE) : generate_slice(vec, KOOPA_RSIK_VALUE);
+    }
+    for (auto bb : bbs)
+    {
+        auto &vec = users[bb];
+        bb->used_by = vec.empty() ? generate_slice(KOOPA_RSIK_VALUE) : generate_slice(vec, KOOPA_RSIK_VALUE);
+    }
+}
+
+/**********************************************************************************************************/
+/************************************************Dump******************************************************/
+/**********************************************************************************************************/
+
+static const char *binary_op_name(koopa_raw_binary_op_t op)
+{
+    switch (op)
+    {
+    case KOOPA_RBO_NOT_EQ:
+        return "ne";
+    case KOOPA_RBO_EQ:
+        return "eq";
+    case KOOPA_RBO_GT:
+        return "gt";
+    case KOOPA_RBO_LT:
+        return "lt";
+    case KOOPA_RBO_GE:
+        return "ge";
+    case KOOPA_RBO_LE:
+        return "le";
+    case KOOPA_RBO_ADD:
+        return "add";
+    case KOOPA_RBO_SUB:
+        return "sub";
+    case KOOPA_RBO_MUL:
+        return "mul";
+    case KOOPA_RBO_DIV:
+        return "div";
+    case KOOPA_RBO_MOD:
+        return "mod";
+    case KOOPA_RBO_AND:
+        return "and";
+    case KOOPA_RBO_OR:
+        return "or";
+    case KOOPA_RBO_XOR:
+        return "xor";
+    case KOOPA_RBO_SHL:
+        return "shl";
+    case KOOPA_RBO_SHR:
+        return "shr";
+    case KOOPA_RBO_SAR:
+        return "sar";
+    }
+    assert(false);
+    return "";
+}
+
+void dump_type(koopa_raw_type_t ty, std::ostream &os)
+{
+    switch (ty->tag)
+    {
+    case KOOPA_RTT_INT32:
+        os << "i32";
+        break;
+    case KOOPA_RTT_UNIT:
+        os << "unit";
+        break;
+    case KOOPA_RTT_ARRAY:
+        os << "[";
+        dump_type(ty->data.array.base, os);
+        os << ", " << ty->data.array.len << "]";
+        break;
+    case KOOPA_RTT_POINTER:
+        os << "*";
+        dump_type(ty->data.pointer.base, os);
+        break;
+    case KOOPA_RTT_FUNCTION:
+        os << "(";
+        for (size_t i = 0; i < ty->data.function.params.len; ++i)
+        {
+            if (i != 0)
+                os << ", ";
+            dump_type((koopa_raw_type_t)ty->data.function.params.buffer[i], os);
+        }
+        os << ")";
+        if (ty->data.function.ret->tag != KOOPA_RTT_UNIT)
+        {
+            os << ": ";
+            dump_type(ty->data.function.ret, os);
+        }
+        break;
+    default:
+        assert(false);
+    }
+}
+
+void dump_operand(koopa_raw_value_t value, std::ostream &os)
+{
+    switch (value->kind.tag)
+    {
+    case KOOPA_RVT_INTEGER:
+        os << value->kind.data.integer.value;
+        break;
+    case KOOPA_RVT_ZERO_INIT:
+        os << "zeroinit";
+        break;
+    case KOOPA_RVT_UNDEF:
+        os << "undef";
+        break;
+    case KOOPA_RVT_AGGREGATE:
+    {
+        const auto &elems = value->kind.data.aggregate.elems;
+        os << "{";
+        for (size_t i = 0; i < elems.len; ++i)
+        {
+            if (i != 0)
+                os << ", ";
+            dump_operand((koopa_raw_value_t)elems.buffer[i], os);
+        }
+        os << "}";
+        break;
+    }
+    default:
+        os << value->name;
+        break;
+    }
+}
+
+// 输出基本块的实参列表
+static void dump_args(const koopa_raw_slice_t &args, std::ostream &os)
+{
+    if (args.len == 0)
+        return;
+    os << "(";
+    for (size_t i = 0; i < args.len; ++i)
+    {
+        if (i != 0)
+            os << ", ";
+        dump_operand((koopa_raw_value_t)args.buffer[i], os);
+    }
+    os << ")";
+}
+
+// 输出一条指令
+static void dump_inst(koopa_raw_value_t inst, std::ostream &os)
+{
+    const auto &kind = inst->kind;
+    os << "  ";
+    if (inst->ty->tag != KOOPA_RTT_UNIT)
+    {
+        os << inst->name << " = ";
+    }
+    switch (kind.tag)
+    {
+    case KOOPA_RVT_ALLOC:
+        os << "alloc ";
+        dump_type(inst->ty->data.pointer.base, os);
+        break;
+    case KOOPA_RVT_LOAD:
+        os << "load ";
+        dump_operand(kind.data.load.src, os);
+        break;
+    case KOOPA_RVT_STORE:
+        os << "store ";
+        dump_operand(kind.data.store.value, os);
+        os << ", ";
+        dump_operand(kind.data.store.dest, os);
+        break;
+    case KOOPA_RVT_GET_PTR:
+        os << "getptr ";
+        dump_operand(kind.data.get_ptr.src, os);
+        os << ", ";
+        dump_operand(kind.data.get_ptr.index, os);
+        break;
+    case KOOPA_RVT_GET_ELEM_PTR:
+        os << "getelemptr ";
+        dump_operand(kind.data.get_elem_ptr.src, os);
+        os << ", ";
+        dump_operand(kind.data.get_elem_ptr.index, os);
+        break;
+    case KOOPA_RVT_BINARY:
+        os << binary_op_name(kind.data.binary.op) << " ";
+        dump_operand(kind.data.binary.lhs, os);
+        os << ", ";
+        dump_operand(kind.data.binary.rhs, os);
+        break;
+    case KOOPA_RVT_BRANCH:
+        os << "br ";
+        dump_operand(kind.data.branch.cond, os);
+        os << ", " << kind.data.branch.true_bb->name;
+        dump_args(kind.data.branch.true_args, os);
+        os << ", " << kind.data.branch.false_bb->name;
+        dump_args(kind.data.branch.false_args, os);
+        break;
+    case KOOPA_RVT_JUMP:
+        os << "jump " << kind.data.jump.target->name;
+        dump_args(kind.data.jump.args, os);
+        break;
+    case KOOPA_RVT_CALL:
+        os << "call " << kind.data.call.callee->name;
+        os << "(";
+        for (size_t i = 0; i < kind.data.call.args.len; ++i)
+        {
+            if (i != 0)
+                os << ", ";
+            dump_operand((koopa_raw_value_t)kind.data.call.args.buffer[i], os);
+        }
+        os << ")";
+        break;
+    case KOOPA_RVT_RETURN:
+        os << "ret";
+        if (kind.data.ret.value != nullptr)
+        {
+            os << " ";
+            dump_operand(kind.data.ret.value, os);
+        }
+        break;
+    default:
+        assert(false);
+    }
+    os << "\n";
+}
+
+// 输出一个函数 (或函数声明)
+static void dump_function(koopa_raw_function_t func, std::ostream &os)
+{
+    koopa_raw_type_t ret_ty = func->ty->data.function.ret;
+    if (func->bbs.len == 0)
+    {
+        const auto &params = func->ty->data.function.params;
+        os << "decl " << func->name << "(";
+        for (size_t i = 0; i < params.len; ++i)
+        {
+            if (i != 0)
+                os << ", ";
+            dump_type((koopa_raw_type_t)params.buffer[i], os);
+        }
+        os << ")";
+        if (ret_ty->tag != KOOPA_RTT_UNIT)
+        {
+            os << ": ";
+            dump_type(ret_ty, os);
+        }
+        os << "\n";
+        return;
+    }
+
+    os << "fun " << func->name << "(";
+    for (size_t i = 0; i < func->params.len; ++i)
+    {
+        auto param = (koopa_raw_value_t)func->params.buffer[i];
+        if (i != 0)
+            os << ", ";
+        os << param->name << ": ";
+        dump_type(param->ty, os);
+    }
+    os << ")";
+    if (ret_ty->tag != KOOPA_RTT_UNIT)
+    {
+        os << ": ";
+        dump_type(ret_ty, os);
+    }
+    os << " {\n";
+    for (size_t i = 0; i < func->bbs.len; ++i)
+    {
+        auto bb = (koopa_raw_basic_block_t)func->bbs.buffer[i];
+        if (i != 0)
+            os << "\n";
+        os << bb->name;
+        if (bb->params.len != 0)
+        {
+            os << "(";
+            for (size_t j = 0; j < bb->params.len; ++j)
+            {
+                auto param = (koopa_raw_value_t)bb->params.buffer[j];
+                if (j != 0)
+                    os << ", ";
+                os << param->name << ": ";
+                dump_type(param->ty, os);
+            }
+            os << ")";
+        }
+        os << ":\n";
+        for (size_t j = 0; j < bb->insts.len; ++j)
+        {
+            dump_inst((koopa_raw_value_t)bb->insts.buffer[j], os);
+        }
+    }
+    os << "}\n";
+}
+
+void dump_koopa(const koopa_raw_program_t &program, std::ostream &os)
+{
+    // 全局变量
+    for (size_t i = 0; i < program.values.len; ++i)
+    {
+        auto value = (koopa_raw_value_t)program.values.buffer[i];
+        os << "global " << value->name << " = alloc ";
+        dump_type(value->ty->data.pointer.base, os);
+        os << ", ";
+        dump_operand(value->kind.data.global_alloc.init, os);
+        os << "\n";
+    }
+    if (program.values.len != 0)
+    {
+        os << "\n";
+    }
+    // 函数
+    for (size_t i = 0; i < program.funcs.len; ++i)
+    {
+        if (i != 0)
+            os << "\n";
+        dump_function((koopa_raw_function_t)program.funcs.buffer[i], os);
+    }
+}
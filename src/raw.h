@@ -0,0 +1,151 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <cassert>
+#include <cstring>
+#include <ostream>
+#include "koopa.h"
+
+/**********************************************************************************************************/
+/**********************************************NameManager*************************************************/
+/**********************************************************************************************************/
+
+// 按 libkoopa 输出文本时的规则为 raw program 中的符号分配唯一的名字
+// 全局符号 (全局变量, 函数) 在整个程序内唯一, 局部符号 (参数, 基本块, 指令) 在函数内唯一,
+// 且局部符号不能与全局符号重名. 重名时在后面追加 _0, _1, ...; 匿名的值按出现顺序命名为 %0, %1, ...
+class NameManager
+{
+public:
+    const char *global_name(const char *name);
+    const char *local_name(const char *name);
+    const char *temp_name();
+    void enter_func_scope();
+    void exit_func_scope();
+
+private:
+    int next_id = 0;
+    std::unordered_set<std::string> global_names;
+    std::unordered_set<std::string> local_names;
+
+    const char *unique_name(const char *name, bool is_global);
+};
+
+/**********************************************************************************************************/
+/************************************************DefUse****************************************************/
+/**********************************************************************************************************/
+
+// GenerateIR 和各个优化 pass 共同维护的 used_by:
+// 值每作为一次操作数 (包括跳转的实参) 就在 used_by 中出现一次, 基本块的 used_by 为跳转到它的指令
+// 整数常量在函数内共享, 不记录 used_by. 输出前 prepare_raw_program 会按 libkoopa 的规则重新计算
+
+// 对指令的每个操作数调用 fn, fn 的参数是操作数所在位置的引用, 可以直接修改
+template <typename F>
+void for_each_operand(koopa_raw_value_t inst, F fn)
+{
+    auto &kind = const_cast<koopa_raw_value_kind_t &>(inst->kind);
+    auto each_arg = [&](koopa_raw_slice_t &args)
+    {
+        for (uint32_t i = 0; i < args.len; i++)
+        {
+            fn(reinterpret_cast<koopa_raw_value_t &>(args.buffer[i]));
+        }
+    };
+    switch (kind.tag)
+    {
+    case KOOPA_RVT_LOAD:
+        fn(kind.data.load.src);
+        break;
+    case KOOPA_RVT_STORE:
+        fn(kind.data.store.value);
+        fn(kind.data.store.dest);
+        break;
+    case KOOPA_RVT_GET_PTR:
+        fn(kind.data.get_ptr.src);
+        fn(kind.data.get_ptr.index);
+        break;
+    case KOOPA_RVT_GET_ELEM_PTR:
+        fn(kind.data.get_elem_ptr.src);
+        fn(kind.data.get_elem_ptr.index);
+        break;
+    case KOOPA_RVT_BINARY:
+        fn(kind.data.binary.lhs);
+        fn(kind.data.binary.rhs);
+        break;
+    case KOOPA_RVT_BRANCH:
+        fn(kind.data.branch.cond);
+        each_arg(kind.data.branch.true_args);
+        each_arg(kind.data.branch.false_args);
+        break;
+    case KOOPA_RVT_JUMP:
+        each_arg(kind.data.jump.args);
+        break;
+    case KOOPA_RVT_CALL:
+        each_arg(kind.data.call.args);
+        break;
+    case KOOPA_RVT_RETURN:
+        if (kind.data.ret.value != nullptr)
+            fn(kind.data.ret.value);
+        break;
+    default:
+        break;
+    }
+}
+
+// 对终结指令的每条出边调用 fn(目标基本块, 传给目标的参数)
+template <typename F>
+void for_each_edge(koopa_raw_value_t term, F fn)
+{
+    auto &kind = const_cast<koopa_raw_value_kind_t &>(term->kind);
+    if (kind.tag == KOOPA_RVT_BRANCH)
+    {
+        fn(kind.data.branch.true_bb, kind.data.branch.true_args);
+        fn(kind.data.branch.false_bb, kind.data.branch.false_args);
+    }
+    else if (kind.tag == KOOPA_RVT_JUMP)
+    {
+        fn(kind.data.jump.target, kind.data.jump.args);
+    }
+}
+
+// 记录 user 使用了 used 一次
+void add_use(koopa_raw_value_t used, koopa_raw_value_t user);
+void add_use(koopa_raw_basic_block_t used, koopa_raw_value_t user);
+
+// 删除 user 对 used 的一次使用
+void remove_use(koopa_raw_value_t used, koopa_raw_value_t user);
+void remove_use(koopa_raw_basic_block_t used, koopa_raw_value_t user);
+
+// 为新建的指令记录它的所有操作数和跳转目标的使用
+void add_operand_uses(koopa_raw_value_t inst);
+
+// 删除指令前调用, 从它的操作数和跳转目标的 used_by 中去掉它
+void drop_operand_uses(koopa_raw_value_t inst);
+
+// 把 from 的所有使用替换为 to, 之后 from 不再被使用
+void replace_all_uses(koopa_raw_value_t from, koopa_raw_value_t to);
+
+/**********************************************************************************************************/
+/***********************************************RawProgram*************************************************/
+/**********************************************************************************************************/
+
+// 补全 koopa_build_raw_program 会提供而 GenerateIR 没有填写的信息: 唯一的名字以及 used_by
+// 调用后的 raw program 可以直接交给 Visit 或 dump_koopa, 输出与经过 Koopa 文本往返时相同
+void prepare_raw_program(koopa_raw_program_t &program);
+
+// 为 raw program 中的符号命名
+void assign_names(koopa_raw_program_t &program);
+
+// 重新计算所有值和基本块的 used_by
+void build_used_by(koopa_raw_program_t &program);
+
+// 将 raw program 以 Koopa IR 文本的形式输出, 格式与 koopa_dump_to_file 相同
+void dump_koopa(const koopa_raw_program_t &program, std::ostream &os);
+
+// 输出类型
+void dump_type(koopa_raw_type_t ty, std::ostream &os);
+
+// 输出作为操作数的值
+void dump_operand(koopa_raw_value_t value, std::ostream &os);
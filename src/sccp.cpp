@@ -0,0 +1,253 @@
+#include "opt.h"
+#include <array>
+#include <deque>
+#include "ast.h"
+
+/**********************************************************************************************************/
+/*************************************************SCCP*****************************************************/
+/**********************************************************************************************************/
+
+// 按 Wegman, Zadeck 的方法做稀疏条件常量传播:
+// 1. 格上的值为 未定 < 常量 < 不确定, 只有从可执行的边到达的基本块才会被求值
+// 2. 分支条件为常量时只有一条出边可执行, 基本块参数的值是所有可执行入边上实参的交汇
+// 3. 最后把常量值代入使用处, 删除被折叠的指令和参数, 把常量分支改为 jump, 删除不可达的基本块
+
+class LatticeValue
+{
+public:
+    enum State
+    {
+        UNDEF,
+        CONST,
+        OVERDEF,
+    };
+    State state = UNDEF;
+    int32_t value = 0;
+
+    // 与另一个值交汇, 返回是否有变化
+    bool meet(const LatticeValue &other)
+    {
+        if (state == OVERDEF || other.state == UNDEF)
+            return false;
+        if (state == UNDEF)
+        {
+            *this = other;
+            return true;
+        }
+        if (other.state == CONST && other.value == value)
+            return false;
+        state = OVERDEF;
+        return true;
+    }
+};
+
+void sccp(koopa_raw_function_data_t *func)
+{
+    CFG cfg(func);
+    size_t n = cfg.blocks.size();
+
+    // 函数内定义的值初始为未定, 其余 (参数, 全局变量等) 不确定
+    std::unordered_map<koopa_raw_value_t, LatticeValue> lattice;
+    std::unordered_map<koopa_raw_value_t, int> block_of;
+    for (size_t b = 0; b < n; b++)
+    {
+        auto bb = cfg.blocks[b];
+        for (uint32_t i = 0; i < bb->params.len; i++)
+            lattice[(koopa_raw_value_t)bb->params.buffer[i]];
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+        {
+            auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+            lattice[inst];
+            block_of[inst] = b;
+        }
+    }
+    auto get = [&](koopa_raw_value_t value)
+    {
+        LatticeValue ret;
+        if (value->kind.tag == KOOPA_RVT_INTEGER)
+        {
+            ret.state = LatticeValue::CONST;
+            ret.value = value->kind.data.integer.value;
+            return ret;
+        }
+        auto it = lattice.find(value);
+        if (it == lattice.end())
+        {
+            ret.state = LatticeValue::OVERDEF;
+            return ret;
+        }
+        return it->second;
+    };
+
+    std::vector<char> executable(n, 0);
+    // 每条边用 (起点, 0 为 true 分支或 jump, 1 为 false 分支) 表示
+    std::vector<std::array<char, 2>> edge_done(n, {0, 0});
+    std::deque<int> block_worklist;
+    std::deque<koopa_raw_value_t> value_worklist;
+
+    auto update = [&](koopa_raw_value_t value, const LatticeValue &other)
+    {
+        if (lattice[value].meet(other))
+            value_worklist.push_back(value);
+    };
+    auto visit_edge = [&](int from, int slot, koopa_raw_basic_block_t target, const koopa_raw_slice_t &args)
+    {
+        int t = cfg.index.at(target);
+        edge_done[from][slot] = 1;
+        for (uint32_t i = 0; i < args.len; i++)
+            update((koopa_raw_value_t)target->params.buffer[i], get((koopa_raw_value_t)args.buffer[i]));
+        if (!executable[t])
+        {
+            executable[t] = 1;
+            block_worklist.push_back(t);
+        }
+    };
+    auto visit = [&](koopa_raw_value_t inst)
+    {
+        int b = block_of.at(inst);
+        auto &kind = const_cast<koopa_raw_value_kind_t &>(inst->kind);
+        LatticeValue result;
+        switch (kind.tag)
+        {
+        case KOOPA_RVT_BINARY:
+        {
+            auto lhs = get(kind.data.binary.lhs), rhs = get(kind.data.binary.rhs);
+            if (lhs.state == LatticeValue::CONST && rhs.state == LatticeValue::CONST)
+            {
+                result.state = LatticeValue::CONST;
+                if (!fold_binary(kind.data.binary.op, lhs.value, rhs.value, result.value))
+                    result.state = LatticeValue::OVERDEF;
+            }
+            else if (lhs.state == LatticeValue::OVERDEF || rhs.state == LatticeValue::OVERDEF)
+            {
+                result.state = LatticeValue::OVERDEF;
+            }
+            update(inst, result);
+            break;
+        }
+        case KOOPA_RVT_BRANCH:
+        {
+            auto cond = get(kind.data.branch.cond);
+            if (cond.state == LatticeValue::UNDEF)
+                break;
+            if (cond.state == LatticeValue::OVERDEF || cond.value != 0)
+                visit_edge(b, 0, kind.data.branch.true_bb, kind.data.branch.true_args);
+            if (cond.state == LatticeValue::OVERDEF || cond.value == 0)
+                visit_edge(b, 1, kind.data.branch.false_bb, kind.data.branch.false_args);
+            break;
+        }
+        case KOOPA_RVT_JUMP:
+            visit_edge(b, 0, kind.data.jump.target, kind.data.jump.args);
+            break;
+        default:
+            if (inst->ty->tag != KOOPA_RTT_UNIT)
+            {
+                result.state = LatticeValue::OVERDEF;
+                update(inst, result);
+            }
+            break;
+        }
+    };
+
+    executable[0] = 1;
+    block_worklist.push_back(0);
+    while (!block_worklist.empty() || !value_worklist.empty())
+    {
+        if (!block_worklist.empty())
+        {
+            auto bb = cfg.blocks[block_worklist.front()];
+            block_worklist.pop_front();
+            for (uint32_t i = 0; i < bb->insts.len; i++)
+                visit((koopa_raw_value_t)bb->insts.buffer[i]);
+            continue;
+        }
+        auto value = value_worklist.front();
+        value_worklist.pop_front();
+        const auto &used_by = value->used_by;
+        for (uint32_t i = 0; i < used_by.len; i++)
+        {
+            auto user = (koopa_raw_value_t)used_by.buffer[i];
+            if (!executable[block_of.at(user)])
+                continue;
+            // 终结指令只重新传递已经可执行的边上的实参, 新的边由条件的变化决定
+            if (user->kind.tag == KOOPA_RVT_BRANCH && user->kind.data.branch.cond != value)
+            {
+                auto &branch = user->kind.data.branch;
+                int b = block_of.at(user);
+                if (edge_done[b][0])
+                    visit_edge(b, 0, branch.true_bb, branch.true_args);
+                if (edge_done[b][1])
+                    visit_edge(b, 1, branch.false_bb, branch.false_args);
+                continue;
+            }
+            visit(user);
+        }
+    }
+
+    // 代入常量
+    auto constant_of = [&](koopa_raw_value_t value) -> koopa_raw_value_t
+    {
+        auto it = lattice.find(value);
+        if (it == lattice.end() || it->second.state != LatticeValue::CONST)
+            return nullptr;
+        return generate_number(it->second.value);
+    };
+    for (size_t b = 0; b < n; b++)
+    {
+        if (!executable[b])
+            continue;
+        auto bb = cfg.blocks[b];
+        for (uint32_t i = 0; i < bb->params.len; i++)
+        {
+            auto param = (koopa_raw_value_t)bb->params.buffer[i];
+            auto c = constant_of(param);
+            if (c != nullptr)
+                replace_all_uses(param, c);
+        }
+        uint32_t len = 0;
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+        {
+            auto inst = (koopa_raw_value_t)bb->insts.buffer[i];
+            auto c = constant_of(inst);
+            if (inst->kind.tag == KOOPA_RVT_BINARY && c != nullptr)
+            {
+                replace_all_uses(inst, c);
+                drop_operand_uses(inst);
+                continue;
+            }
+            bb->insts.buffer[len++] = inst;
+        }
+        bb->insts.len = len;
+    }
+
+    // 条件为常量的分支改为 jump
+    for (size_t b = 0; b < n; b++)
+    {
+        if (!executable[b])
+            continue;
+        auto term = terminator(cfg.blocks[b]);
+        const auto &kind = term->kind;
+        if (kind.tag == KOOPA_RVT_BRANCH && kind.data.branch.cond->kind.tag == KOOPA_RVT_INTEGER)
+            branch_to_jump(term, kind.data.branch.cond->kind.data.integer.value != 0);
+    }
+    remove_unreachable_blocks(func);
+
+    // 删除值为常量的基本块参数
+    CFG new_cfg(func);
+    for (size_t b = 0; b < new_cfg.blocks.size(); b++)
+    {
+        auto bb = new_cfg.blocks[b];
+        std::vector<char> keep(bb->params.len, 1);
+        bool changed = false;
+        for (uint32_t i = 0; i < bb->params.len; i++)
+        {
+            if (constant_of((koopa_raw_value_t)bb->params.buffer[i]) != nullptr)
+            {
+                keep[i] = 0;
+                changed = true;
+            }
+        }
+        if (changed)
+            remove_block_params(new_cfg, b, keep);
+    }
+}
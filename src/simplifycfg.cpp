@@ -0,0 +1,187 @@
+#include "opt.h"
+#include <unordered_set>
+
+/**********************************************************************************************************/
+/***********************************************SimplifyCFG************************************************/
+/**********************************************************************************************************/
+
+// 控制流图化简, 用工作表做到不动点:
+// 1. 跳到只有一条 jump 的基本块 (跳板) 的边直接改为跳到跳板的目标, 跳板的参数替换为这条边上的实参
+// 2. 两个目标和实参都相同的 branch 改为 jump
+// 3. 以 jump 结尾的基本块与只有它一个前驱的后继合并, 后继的参数替换为实参
+// 4. 失去所有前驱的基本块立即删除, 它的后继少了一个前驱, 可能因此可以合并
+// 每个基本块在前驱个数变化后才重新加入工作表, 每次改动都会删除一条边或一个基本块
+// 最后删除从入口不可达的环
+
+// 只有一条 jump 且不跳到自身的基本块, 参数只被这条 jump 使用, 否则穿过它之后参数在被支配的基本块中没有定义
+static bool is_trampoline(koopa_raw_basic_block_t bb, koopa_raw_basic_block_t entry)
+{
+    if (bb == entry || bb->insts.len != 1)
+        return false;
+    auto term = terminator(bb);
+    if (term->kind.tag != KOOPA_RVT_JUMP || term->kind.data.jump.target == bb)
+        return false;
+    for (uint32_t i = 0; i < bb->params.len; i++)
+    {
+        auto param = (koopa_raw_value_t)bb->params.buffer[i];
+        for (uint32_t j = 0; j < param->used_by.len; j++)
+        {
+            if (param->used_by.buffer[j] != term)
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool same_value(koopa_raw_value_t a, koopa_raw_value_t b)
+{
+    if (a->kind.tag == KOOPA_RVT_INTEGER && b->kind.tag == KOOPA_RVT_INTEGER)
+        return a->kind.data.integer.value == b->kind.data.integer.value;
+    return a == b;
+}
+
+static bool same_args(const koopa_raw_slice_t &a, const koopa_raw_slice_t &b)
+{
+    if (a.len != b.len)
+        return false;
+    for (uint32_t i = 0; i < a.len; i++)
+    {
+        if (!same_value((koopa_raw_value_t)a.buffer[i], (koopa_raw_value_t)b.buffer[i]))
+            return false;
+    }
+    return true;
+}
+
+void simplify_cfg(koopa_raw_function_data_t *func)
+{
+    remove_unreachable_blocks(func);
+    auto entry = (koopa_raw_basic_block_data_t *)func->bbs.buffer[0];
+    // 终结指令所在的基本块, 合并后后继的终结指令属于合并后的基本块
+    std::unordered_map<koopa_raw_value_t, koopa_raw_basic_block_data_t *> block_of_term;
+    for (uint32_t i = 0; i < func->bbs.len; i++)
+    {
+        auto bb = (koopa_raw_basic_block_data_t *)func->bbs.buffer[i];
+        block_of_term[terminator(bb)] = bb;
+    }
+
+    std::unordered_set<koopa_raw_basic_block_t> removed, queued;
+    std::vector<koopa_raw_basic_block_data_t *> worklist;
+    auto push = [&](koopa_raw_basic_block_data_t *bb)
+    {
+        if (removed.count(bb) == 0 && queued.insert(bb).second)
+            worklist.push_back(bb);
+    };
+    for (uint32_t i = func->bbs.len; i-- > 0;)
+        push((koopa_raw_basic_block_data_t *)func->bbs.buffer[i]);
+
+    // 删除没有前驱的基本块, 或者把只剩一个前驱的基本块的前驱加入工作表
+    std::function<void(koopa_raw_basic_block_t)> lost_pred = [&](koopa_raw_basic_block_t bb)
+    {
+        if (bb == entry || removed.count(bb) != 0)
+            return;
+        if (bb->used_by.len == 1)
+        {
+            push(block_of_term.at((koopa_raw_value_t)bb->used_by.buffer[0]));
+            return;
+        }
+        if (bb->used_by.len != 0)
+            return;
+        removed.insert(bb);
+        auto term = terminator(bb);
+        std::vector<koopa_raw_basic_block_t> targets;
+        for_each_edge(term, [&](koopa_raw_basic_block_t target, koopa_raw_slice_t &)
+                      { targets.push_back(target); });
+        for (uint32_t i = 0; i < bb->insts.len; i++)
+            drop_operand_uses((koopa_raw_value_t)bb->insts.buffer[i]);
+        for (auto target : targets)
+            lost_pred(target);
+    };
+
+    while (!worklist.empty())
+    {
+        auto bb = worklist.back();
+        worklist.pop_back();
+        queued.erase(bb);
+        if (removed.count(bb) != 0)
+            continue;
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            auto term = terminator(bb);
+
+            // 穿过跳板, 跳板的环最多绕一圈
+            std::vector<koopa_raw_basic_block_t> skipped;
+            for_each_edge(term, [&](koopa_raw_basic_block_t &target, koopa_raw_slice_t &args)
+                          {
+                              for (uint32_t steps = 0; steps < func->bbs.len && is_trampoline(target, entry); steps++)
+                              {
+                                  const auto &jump = terminator(target)->kind.data.jump;
+                                  std::vector<const void *> new_args;
+                                  for (uint32_t i = 0; i < jump.args.len; i++)
+                                  {
+                                      auto arg = (koopa_raw_value_t)jump.args.buffer[i];
+                                      if (arg->kind.tag == KOOPA_RVT_BLOCK_ARG_REF && arg->kind.data.block_arg_ref.index < target->params.len &&
+                                          target->params.buffer[arg->kind.data.block_arg_ref.index] == arg)
+                                          arg = (koopa_raw_value_t)args.buffer[arg->kind.data.block_arg_ref.index];
+                                      new_args.push_back(arg);
+                                  }
+                                  for (uint32_t i = 0; i < args.len; i++)
+                                      remove_use((koopa_raw_value_t)args.buffer[i], term);
+                                  remove_use(target, term);
+                                  skipped.push_back(target);
+                                  target = jump.target;
+                                  args.len = 0;
+                                  slice_append(args, new_args);
+                                  for (auto arg : new_args)
+                                      add_use((koopa_raw_value_t)arg, term);
+                                  add_use(target, term);
+                                  changed = true;
+                              } });
+            for (auto target : skipped)
+                lost_pred(target);
+
+            // 两个目标相同的 branch
+            if (term->kind.tag == KOOPA_RVT_BRANCH)
+            {
+                const auto &branch = term->kind.data.branch;
+                if (branch.true_bb == branch.false_bb && same_args(branch.true_args, branch.false_args))
+                {
+                    branch_to_jump(term, true);
+                    lost_pred(term->kind.data.jump.target);
+                    changed = true;
+                }
+            }
+
+            // 与只有一个前驱的后继合并
+            if (term->kind.tag == KOOPA_RVT_JUMP)
+            {
+                auto next = (koopa_raw_basic_block_data_t *)term->kind.data.jump.target;
+                if (next != bb && next != entry && next->used_by.len == 1)
+                {
+                    forward_block_params(next);
+                    drop_operand_uses(term);
+                    std::vector<const void *> insts(bb->insts.buffer, bb->insts.buffer + bb->insts.len - 1);
+                    insts.insert(insts.end(), next->insts.buffer, next->insts.buffer + next->insts.len);
+                    bb->insts.len = 0;
+                    slice_append(bb->insts, insts);
+                    block_of_term[terminator(bb)] = bb;
+                    removed.insert(next);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    if (!removed.empty())
+    {
+        uint32_t len = 0;
+        for (uint32_t i = 0; i < func->bbs.len; i++)
+        {
+            if (removed.count((koopa_raw_basic_block_t)func->bbs.buffer[i]) == 0)
+                func->bbs.buffer[len++] = func->bbs.buffer[i];
+        }
+        func->bbs.len = len;
+    }
+    remove_unreachable_blocks(func);
+}
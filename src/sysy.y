@@ -2,6 +2,12 @@
   #include <memory>
   #include <string>
   #include "ast.h"
+
+  // lexer 的状态, 与 Flex 生成的定义相同
+  #ifndef YY_TYPEDEF_YY_SCANNER_T
+  #define YY_TYPEDEF_YY_SCANNER_T
+  typedef void *yyscan_t;
+  #endif
 }
 
 %{
@@ -11,15 +17,22 @@
 #include <string>
 #include "ast.h"
 
-// 声明 lexer 函数和错误处理函数
-int yylex();
-void yyerror(std::unique_ptr<BaseAST> &ast, const char *s);
-
 using namespace std;
 
 %}
 
+%code {
+  // 声明 lexer 函数和错误处理函数
+  int yylex(YYSTYPE *yylval, yyscan_t scanner);
+  void yyerror(yyscan_t scanner, std::unique_ptr<BaseAST> &ast, const char *s);
+}
+
+// parser 和 lexer 都是可重入的, 不使用全局变量, 多个线程可以同时解析不同的文件
+%define api.pure full
+
 // 定义 parser 函数和错误处理函数的附加参数
+%lex-param { yyscan_t scanner }
+%parse-param { yyscan_t scanner }
 %parse-param { std::unique_ptr<BaseAST> &ast }
 
 // yylval 的定义, 我们把它定义成了一个联合体 (union)
@@ -781,6 +794,6 @@ Number
 
 // 定义错误处理函数, 其中第二个参数是错误信息
 // parser 如果发生错误 (例如输入的程序出现了语法错误), 就会调用这个函数
-void yyerror(unique_ptr<BaseAST> &ast, const char *s) {
+void yyerror(yyscan_t scanner, unique_ptr<BaseAST> &ast, const char *s) {
   cerr << "error: " << s << endl;
 }
@@ -0,0 +1,99 @@
+#include "opt.h"
+#include "ast.h"
+
+/**********************************************************************************************************/
+/*********************************************TailRecursion************************************************/
+/**********************************************************************************************************/
+
+// 尾递归消除:
+// 1. 尾递归是紧跟着 ret 的对自身的调用, ret 返回调用的结果 (或者函数没有返回值)
+// 2. 新建入口基本块, 把原入口中的 alloc 移过去, 再带着函数参数跳到原入口
+// 3. 原入口成为循环的 header, 它的参数代替函数参数, 尾递归改为带着实参跳到 header
+// 实参中的指针如果指向栈帧中的 alloc, 改为循环后会被下一次迭代改写, 这样的调用不做变换
+
+// 基本块末尾的 call 和 ret 是否构成尾递归
+static bool is_tail_recursion(koopa_raw_function_data_t *func, koopa_raw_basic_block_t bb)
+{
+    if (bb->insts.len < 2)
+        return false;
+    auto call = (koopa_raw_value_t)bb->insts.buffer[bb->insts.len - 2];
+    auto ret = terminator(bb);
+    if (call->kind.tag != KOOPA_RVT_CALL || call->kind.data.call.callee != func || ret->kind.tag != KOOPA_RVT_RETURN)
+        return false;
+    if (ret->kind.data.ret.value != nullptr && (ret->kind.data.ret.value != call || call->used_by.len != 1))
+        return false;
+    if (ret->kind.data.ret.value == nullptr && call->used_by.len != 0)
+        return false;
+    const auto &args = call->kind.data.call.args;
+    for (uint32_t i = 0; i < args.len; i++)
+    {
+        auto arg = (koopa_raw_value_t)args.buffer[i];
+        if (arg->ty->tag == KOOPA_RTT_POINTER && !outside_frame(arg))
+            return false;
+    }
+    return true;
+}
+
+void tail_recursion(koopa_raw_function_data_t *func)
+{
+    std::vector<koopa_raw_basic_block_data_t *> tails;
+    for (uint32_t i = 0; i < func->bbs.len; i++)
+    {
+        auto bb = (koopa_raw_basic_block_data_t *)func->bbs.buffer[i];
+        if (is_tail_recursion(func, bb))
+            tails.push_back(bb);
+    }
+    if (tails.empty())
+        return;
+
+    // 原入口的参数代替函数参数
+    auto header = (koopa_raw_basic_block_data_t *)func->bbs.buffer[0];
+    auto name = header->name;
+    header->name = name == nullptr ? nullptr : raw_arena.make_string(std::string(name) + "_tailrec");
+    std::vector<const void *> params;
+    for (uint32_t i = 0; i < func->params.len; i++)
+    {
+        auto arg = (koopa_raw_value_t)func->params.buffer[i];
+        auto param_name = arg->name == nullptr ? nullptr : raw_arena.make_string("%" + std::string(arg->name + 1));
+        auto param = make_block_param(arg->ty, param_name, i);
+        replace_all_uses(arg, param);
+        params.push_back(param);
+    }
+    slice_append(header->params, params);
+
+    // 尾递归改为跳到 header
+    for (auto bb : tails)
+    {
+        auto call = (koopa_raw_value_t)bb->insts.buffer[bb->insts.len - 2];
+        auto ret = terminator(bb);
+        const auto &args = call->kind.data.call.args;
+        std::vector<const void *> jump_args(args.buffer, args.buffer + args.len);
+        drop_operand_uses(ret);
+        drop_operand_uses(call);
+        bb->insts.len -= 2;
+        slice_append(bb->insts, {generate_jump_inst(header, jump_args)});
+    }
+
+    // 新的入口基本块
+    auto entry = raw_arena.make<koopa_raw_basic_block_data_t>();
+    entry->name = name;
+    entry->params = generate_slice(KOOPA_RSIK_VALUE);
+    entry->used_by = generate_slice(KOOPA_RSIK_VALUE);
+    entry->insts = generate_slice(KOOPA_RSIK_VALUE);
+    std::vector<const void *> allocs, rest;
+    for (uint32_t i = 0; i < header->insts.len; i++)
+    {
+        auto inst = (koopa_raw_value_t)header->insts.buffer[i];
+        (inst->kind.tag == KOOPA_RVT_ALLOC ? allocs : rest).push_back(inst);
+    }
+    header->insts.len = 0;
+    slice_append(header->insts, rest);
+    std::vector<const void *> func_args(func->params.buffer, func->params.buffer + func->params.len);
+    allocs.push_back(generate_jump_inst(header, func_args));
+    slice_append(entry->insts, allocs);
+
+    std::vector<const void *> bbs = {entry};
+    bbs.insert(bbs.end(), func->bbs.buffer, func->bbs.buffer + func->bbs.len);
+    func->bbs.len = 0;
+    slice_append(func->bbs, bbs);
+}
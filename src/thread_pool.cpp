@@ -0,0 +1,141 @@
+#include "thread_pool.h"
+
+// 当前线程所属的线程池及其编号
+static thread_local const ThreadPool *cur_pool = nullptr;
+static thread_local int cur_index = -1;
+
+ThreadPool::ThreadPool(size_t thread_count) : queued(0), next_queue(0), stop(false)
+{
+    if (thread_count == 0)
+    {
+        thread_count = 1;
+    }
+    for (size_t i = 0; i < thread_count; i++)
+    {
+        queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+    for (size_t i = 0; i < thread_count; i++)
+    {
+        workers.emplace_back([this, i]
+                             { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stop = true;
+    }
+    sleep_cv.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::size() const
+{
+    return workers.size();
+}
+
+int ThreadPool::worker_index() const
+{
+    return cur_pool == this ? cur_index : -1;
+}
+
+void ThreadPool::submit(std::function<void()> task, TaskGroup &group)
+{
+    group.pending++;
+    // 工作线程提交的任务放入自己的队列, 外部线程提交的任务轮流放入各个队列
+    // 先增加计数再入队, 保证 queued 不会小于队列中实际的任务数
+    int index = worker_index();
+    size_t target = index >= 0 ? index : next_queue++ % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        queued++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(Task{std::move(task), &group});
+    }
+    sleep_cv.notify_one();
+}
+
+void ThreadPool::wait(TaskGroup &group)
+{
+    int index = worker_index();
+    while (group.pending > 0)
+    {
+        if (!try_run(index))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool ThreadPool::try_pop(size_t index, Task &task)
+{
+    std::lock_guard<std::mutex> lock(queues[index]->mutex);
+    if (queues[index]->tasks.empty())
+    {
+        return false;
+    }
+    task = std::move(queues[index]->tasks.back());
+    queues[index]->tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::try_steal(int index, Task &task)
+{
+    size_t start = index >= 0 ? index + 1 : 0;
+    for (size_t i = 0; i < queues.size(); i++)
+    {
+        size_t victim = (start + i) % queues.size();
+        if (int(victim) == index)
+        {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(queues[victim]->mutex);
+        if (!queues[victim]->tasks.empty())
+        {
+            task = std::move(queues[victim]->tasks.front());
+            queues[victim]->tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::try_run(int index)
+{
+    Task task;
+    if (!(index >= 0 && try_pop(index, task)) && !try_steal(index, task))
+    {
+        return false;
+    }
+    queued--;
+    task.func();
+    task.group->pending--;
+    return true;
+}
+
+void ThreadPool::worker_loop(size_t index)
+{
+    cur_pool = this;
+    cur_index = index;
+    while (true)
+    {
+        if (try_run(index))
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleep_cv.wait(lock, [this]
+                      { return stop || queued > 0; });
+        if (stop && queued == 0)
+        {
+            return;
+        }
+    }
+}
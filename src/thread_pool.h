@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/**********************************************************************************************************/
+/**********************************************ThreadPool**************************************************/
+/**********************************************************************************************************/
+
+// work-stealing 线程池: 每个工作线程有自己的任务队列, 从队尾取自己的任务, 空闲时从其他队列的队头窃取
+// 任务按 TaskGroup 分组等待; 等待的线程 (包括工作线程自己) 在等待期间也会执行任务,
+// 因此任务内部可以再向同一个线程池提交任务并等待, 不会死锁
+class ThreadPool
+{
+public:
+    class TaskGroup
+    {
+    public:
+        TaskGroup() : pending(0) {}
+
+    private:
+        friend class ThreadPool;
+        // 已提交但尚未执行完的任务数
+        std::atomic<size_t> pending;
+    };
+
+    explicit ThreadPool(size_t thread_count);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // 提交一个属于 group 的任务
+    void submit(std::function<void()> task, TaskGroup &group);
+    // 等待 group 中的任务全部执行完毕
+    void wait(TaskGroup &group);
+    size_t size() const;
+
+private:
+    class Task
+    {
+    public:
+        std::function<void()> func;
+        TaskGroup *group;
+    };
+
+    class WorkQueue
+    {
+    public:
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+    // 所有队列中的任务总数
+    std::atomic<size_t> queued;
+    // 外部线程提交任务时轮流放入各个队列
+    std::atomic<size_t> next_queue;
+    bool stop;
+
+    // 当前线程在本线程池中的编号, 不是本线程池的工作线程时返回 -1
+    int worker_index() const;
+    bool try_pop(size_t index, Task &task);
+    bool try_steal(int index, Task &task);
+    bool try_run(int index);
+    void worker_loop(size_t index);
+};
@@ -0,0 +1,76 @@
+#include "type_table.h"
+#include <algorithm>
+
+thread_local TypeTable type_table;
+
+koopa_raw_type_t TypeTable::get_type(koopa_raw_type_tag_t tag)
+{
+    auto it = simple_types.find(tag);
+    if (it != simple_types.end())
+    {
+        return it->second;
+    }
+    koopa_raw_type_kind_t *ret = arena.make<koopa_raw_type_kind_t>();
+    ret->tag = tag;
+    simple_types[tag] = ret;
+    return ret;
+}
+
+koopa_raw_type_t TypeTable::get_pointer(koopa_raw_type_t base)
+{
+    auto it = pointer_types.find(base);
+    if (it != pointer_types.end())
+    {
+        return it->second;
+    }
+    koopa_raw_type_kind_t *ret = arena.make<koopa_raw_type_kind_t>();
+    ret->tag = KOOPA_RTT_POINTER;
+    ret->data.pointer.base = base;
+    pointer_types[base] = ret;
+    return ret;
+}
+
+koopa_raw_type_t TypeTable::get_array(koopa_raw_type_t base, size_t len)
+{
+    auto key = std::make_pair(base, len);
+    auto it = array_types.find(key);
+    if (it != array_types.end())
+    {
+        return it->second;
+    }
+    koopa_raw_type_kind_t *ret = arena.make<koopa_raw_type_kind_t>();
+    ret->tag = KOOPA_RTT_ARRAY;
+    ret->data.array.base = base;
+    ret->data.array.len = len;
+    array_types[key] = ret;
+    return ret;
+}
+
+koopa_raw_type_t TypeTable::get_function(koopa_raw_type_t ret_ty, const koopa_raw_slice_t &params)
+{
+    std::vector<koopa_raw_type_t> key;
+    key.push_back(ret_ty);
+    for (size_t i = 0; i < params.len; i++)
+    {
+        key.push_back((koopa_raw_type_t)params.buffer[i]);
+    }
+    auto it = function_types.find(key);
+    if (it != function_types.end())
+    {
+        return it->second;
+    }
+    // 参数列表复制到表自己的 arena 中
+    koopa_raw_type_kind_t *ret = arena.make<koopa_raw_type_kind_t>();
+    ret->tag = KOOPA_RTT_FUNCTION;
+    ret->data.function.ret = ret_ty;
+    ret->data.function.params.kind = KOOPA_RSIK_TYPE;
+    ret->data.function.params.len = params.len;
+    ret->data.function.params.buffer = nullptr;
+    if (params.len != 0)
+    {
+        ret->data.function.params.buffer = arena.make_array<const void *>(params.len);
+        std::copy(params.buffer, params.buffer + params.len, ret->data.function.params.buffer);
+    }
+    function_types[key] = ret;
+    return ret;
+}
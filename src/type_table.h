@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include "koopa.h"
+#include "arena.h"
+
+/**********************************************************************************************************/
+/**********************************************TypeTable***************************************************/
+/**********************************************************************************************************/
+
+// 类型的 hash-consing 表: 结构相同的类型只构建一次, 之后都返回同一个对象
+// 因此两个类型相等当且仅当指针相等, 后端也可以按类型指针缓存大小等信息
+// 类型对象放在表自己的 arena 中, 不随 raw_arena 释放, 可以在多次编译之间复用
+class TypeTable
+{
+public:
+    koopa_raw_type_t get_type(koopa_raw_type_tag_t tag);
+    koopa_raw_type_t get_pointer(koopa_raw_type_t base);
+    koopa_raw_type_t get_array(koopa_raw_type_t base, size_t len);
+    koopa_raw_type_t get_function(koopa_raw_type_t ret, const koopa_raw_slice_t &params);
+
+private:
+    class ArrayKeyHash
+    {
+    public:
+        size_t operator()(const std::pair<koopa_raw_type_t, size_t> &key) const
+        {
+            return std::hash<const void *>()(key.first) * 31 + key.second;
+        }
+    };
+
+    Arena arena;
+    std::unordered_map<int, koopa_raw_type_t> simple_types;
+    std::unordered_map<koopa_raw_type_t, koopa_raw_type_t> pointer_types;
+    std::unordered_map<std::pair<koopa_raw_type_t, size_t>, koopa_raw_type_t, ArrayKeyHash> array_types;
+    // 键为 返回值类型 + 参数类型
+    std::map<std::vector<koopa_raw_type_t>, koopa_raw_type_t> function_types;
+};
+
+// 每个线程一个, 在该线程上的多次编译之间复用
+extern thread_local TypeTable type_table;
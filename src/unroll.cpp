@@ -0,0 +1,338 @@
+#include "opt.h"
+#include <algorithm>
+#include <climits>
+#include "ast.h"
+
+/**********************************************************************************************************/
+/*************************************************Unroll***************************************************/
+/**********************************************************************************************************/
+
+// 循环展开, 只处理最内层的计数循环:
+// 1. header 是唯一离开循环的基本块, 只有一个 latch, header 的分支条件比较 header 的参数 i 和循环不变的 bound,
+//    latch 传给 i 的值是 i 加减一个常量 step
+// 2. 初值和 bound 都是常量时模拟出执行次数, 次数和展开后的大小都不超过限制时完全展开:
+//    依次复制 header 和循环体, 复制体中 header 的分支直接进入循环体, 最后一份跳回原来的 header,
+//    原来的循环留给之后的 SCCP 证明不再执行
+// 3. 否则按 factor 部分展开: 新的 header 检查 i 再走 factor - 1 步后条件仍然成立, 成立时连续执行 factor 份复制,
+//    不成立时进入原来的循环处理剩余的次数. 计算 bound - (factor - 1) * step 可能溢出时不展开, bound 不是常量时在
+//    preheader 中检查
+// 4. 复制体的 header 都只有一条入边, 直接用实参代替它的参数, 省去参数的传递
+
+static const int MAX_FULL_TRIPS = 32;
+static const int MAX_FULL_SIZE = 128;
+static const int MAX_PARTIAL_SIZE = 64;
+
+// 可以展开的循环
+class CountedLoop
+{
+public:
+    int loop;
+    int preheader;
+    int latch;
+    // 归纳变量是 header 的第 index 个参数
+    size_t index;
+    int32_t step;
+    koopa_raw_value_t init;
+    koopa_raw_value_t bound;
+    // 条件为 i op bound, 条件成立时留在循环中
+    koopa_raw_binary_op_t op;
+    int size;
+};
+
+static koopa_raw_binary_op_t swap_compare(koopa_raw_binary_op_t op)
+{
+    switch (op)
+    {
+    case KOOPA_RBO_LT:
+        return KOOPA_RBO_GT;
+    case KOOPA_RBO_GT:
+        return KOOPA_RBO_LT;
+    case KOOPA_RBO_LE:
+        return KOOPA_RBO_GE;
+    case KOOPA_RBO_GE:
+        return KOOPA_RBO_LE;
+    default:
+        return op;
+    }
+}
+
+static koopa_raw_binary_op_t negate_compare(koopa_raw_binary_op_t op)
+{
+    switch (op)
+    {
+    case KOOPA_RBO_LT:
+        return KOOPA_RBO_GE;
+    case KOOPA_RBO_GE:
+        return KOOPA_RBO_LT;
+    case KOOPA_RBO_GT:
+        return KOOPA_RBO_LE;
+    case KOOPA_RBO_LE:
+        return KOOPA_RBO_GT;
+    case KOOPA_RBO_EQ:
+        return KOOPA_RBO_NOT_EQ;
+    default:
+        return KOOPA_RBO_EQ;
+    }
+}
+
+static bool is_compare(koopa_raw_binary_op_t op)
+{
+    return op == KOOPA_RBO_LT || op == KOOPA_RBO_GT || op == KOOPA_RBO_LE || op == KOOPA_RBO_GE ||
+           op == KOOPA_RBO_EQ || op == KOOPA_RBO_NOT_EQ;
+}
+
+static bool match_counted_loop(const CFG &cfg, const LoopInfo &loops, int l, CountedLoop &ret)
+{
+    const auto &loop = loops.loops[l];
+    ret.loop = l;
+    ret.preheader = loops.preheader(cfg, l);
+    if (ret.preheader < 0 || loop.latches.size() != 1)
+        return false;
+    ret.latch = loop.latches[0];
+    auto header = cfg.blocks[loop.header];
+    auto defined_in_loop = [&](koopa_raw_value_t value)
+    {
+        for (int b : loop.blocks)
+        {
+            auto bb = cfg.blocks[b];
+            if (std::find(bb->params.buffer, bb->params.buffer + bb->params.len, value) != bb->params.buffer + bb->params.len ||
+                std::find(bb->insts.buffer, bb->insts.buffer + bb->insts.len, value) != bb->insts.buffer + bb->insts.len)
+                return true;
+        }
+        return false;
+    };
+
+    // 只有 header 离开循环, 循环中没有内层循环
+    ret.size = 0;
+    for (int b : loop.blocks)
+    {
+        if (loops.loop_of[b] != l)
+            return false;
+        ret.size += cfg.blocks[b]->insts.len;
+        if (b == loop.header)
+            continue;
+        for (int s : cfg.succs[b])
+        {
+            if (!loops.contains(l, s))
+                return false;
+        }
+    }
+
+    // header 的分支条件
+    const auto &term = terminator(header)->kind;
+    if (term.tag != KOOPA_RVT_BRANCH || term.data.branch.cond->kind.tag != KOOPA_RVT_BINARY)
+        return false;
+    bool stay_on_true = loops.contains(l, cfg.index.at(term.data.branch.true_bb));
+    if (stay_on_true == loops.contains(l, cfg.index.at(term.data.branch.false_bb)))
+        return false;
+    const auto &cond = term.data.branch.cond->kind.data.binary;
+    if (!is_compare(cond.op))
+        return false;
+    koopa_raw_value_t iv = cond.lhs;
+    ret.bound = cond.rhs;
+    ret.op = cond.op;
+    if (iv->kind.tag != KOOPA_RVT_BLOCK_ARG_REF)
+    {
+        std::swap(iv, ret.bound);
+        ret.op = swap_compare(ret.op);
+    }
+    if (!stay_on_true)
+        ret.op = negate_compare(ret.op);
+    if (iv->kind.tag != KOOPA_RVT_BLOCK_ARG_REF || defined_in_loop(ret.bound))
+        return false;
+    ret.index = iv->kind.data.block_arg_ref.index;
+    if (ret.index >= header->params.len || header->params.buffer[ret.index] != iv)
+        return false;
+
+    // latch 传给 i 的值是 i 加减常量
+    const auto &latch_term = terminator(cfg.blocks[ret.latch])->kind;
+    if (latch_term.tag != KOOPA_RVT_JUMP)
+        return false;
+    auto next = (koopa_raw_value_t)latch_term.data.jump.args.buffer[ret.index];
+    if (next->kind.tag != KOOPA_RVT_BINARY)
+        return false;
+    const auto &update = next->kind.data.binary;
+    if (update.op == KOOPA_RBO_ADD && update.lhs == iv && update.rhs->kind.tag == KOOPA_RVT_INTEGER)
+        ret.step = update.rhs->kind.data.integer.value;
+    else if (update.op == KOOPA_RBO_ADD && update.rhs == iv && update.lhs->kind.tag == KOOPA_RVT_INTEGER)
+        ret.step = update.lhs->kind.data.integer.value;
+    else if (update.op == KOOPA_RBO_SUB && update.lhs == iv && update.rhs->kind.tag == KOOPA_RVT_INTEGER)
+        ret.step = 0u - (uint32_t)update.rhs->kind.data.integer.value;
+    else
+        return false;
+    if (ret.step == 0)
+        return false;
+
+    const auto &pre_term = terminator(cfg.blocks[ret.preheader])->kind;
+    ret.init = (koopa_raw_value_t)pre_term.data.jump.args.buffer[ret.index];
+    return true;
+}
+
+// 常量初值和 bound 时的执行次数, 超过 MAX_FULL_TRIPS 时返回 -1
+static int trip_count(const CountedLoop &counted)
+{
+    if (counted.init->kind.tag != KOOPA_RVT_INTEGER || counted.bound->kind.tag != KOOPA_RVT_INTEGER)
+        return -1;
+    int32_t i = counted.init->kind.data.integer.value;
+    int32_t bound = counted.bound->kind.data.integer.value;
+    for (int trips = 0; trips <= MAX_FULL_TRIPS; trips++)
+    {
+        int32_t stay;
+        fold_binary(counted.op, i, bound, stay);
+        if (!stay)
+            return trips;
+        i = (uint32_t)i + (uint32_t)counted.step;
+    }
+    return -1;
+}
+
+// 复制 header 和循环体, 复制体中 header 的分支改为进入循环体, 返回复制出的基本块, header 的复制在最前面
+static std::vector<koopa_raw_basic_block_data_t *> clone_iteration(const CFG &cfg, const Loop &loop)
+{
+    std::vector<koopa_raw_basic_block_t> blocks;
+    for (int b : loop.blocks)
+        blocks.push_back(cfg.blocks[b]);
+    std::unordered_map<koopa_raw_value_t, koopa_raw_value_t> value_map;
+    auto copy = clone_blocks(blocks, value_map);
+    auto term = terminator(copy[0]);
+    const auto &branch = term->kind.data.branch;
+    auto true_target = std::find(copy.begin(), copy.end(), branch.true_bb);
+    branch_to_jump(term, true_target != copy.end());
+    return copy;
+}
+
+// 新建 branch, 两个目标收到相同的实参
+static koopa_raw_value_data_t *make_branch(koopa_raw_value_t cond, koopa_raw_basic_block_data_t *true_bb,
+                                           koopa_raw_basic_block_data_t *false_bb, const std::vector<const void *> &args)
+{
+    auto ret = generate_branch_inst(cond, true_bb, false_bb);
+    slice_append(ret->kind.data.branch.true_args, args);
+    slice_append(ret->kind.data.branch.false_args, args);
+    for (int i = 0; i < 2; i++)
+    {
+        for (auto arg : args)
+            add_use((koopa_raw_value_t)arg, ret);
+    }
+    return ret;
+}
+
+void unroll(koopa_raw_function_data_t *func, int factor)
+{
+    CFG cfg(func);
+    LoopInfo loops(cfg);
+    // 每个被展开的循环在 header 之前插入的基本块
+    std::unordered_map<koopa_raw_basic_block_t, std::vector<koopa_raw_basic_block_data_t *>> inserted;
+
+    for (size_t l = 0; l < loops.loops.size(); l++)
+    {
+        CountedLoop counted;
+        if (!match_counted_loop(cfg, loops, l, counted))
+            continue;
+        const auto &loop = loops.loops[l];
+        auto header = cfg.blocks[loop.header];
+        auto pre = cfg.blocks[counted.preheader];
+        size_t latch_pos = std::find(loop.blocks.begin(), loop.blocks.end(), counted.latch) - loop.blocks.begin();
+        // 复制 count 份, 第 t 份的 latch 跳到 next(t)
+        auto unroll_copies = [&](int count, auto next)
+        {
+            std::vector<std::vector<koopa_raw_basic_block_data_t *>> copies;
+            for (int t = 0; t < count; t++)
+                copies.push_back(clone_iteration(cfg, loop));
+            for (int t = 0; t < count; t++)
+            {
+                redirect_edges(terminator(copies[t][latch_pos]), copies[t][0], t + 1 < count ? copies[t + 1][0] : next);
+                inserted[header].insert(inserted[header].end(), copies[t].begin(), copies[t].end());
+            }
+            // 之后的每一份只从上一份进入, 不需要通过参数传递归纳变量等
+            for (int t = 1; t < count; t++)
+                forward_block_params(copies[t][0]);
+            return copies[0][0];
+        };
+
+        int trips = trip_count(counted);
+        if (trips > 0 && trips * counted.size <= MAX_FULL_SIZE)
+        {
+            // 完全展开: preheader -> 第 0 份 -> ... -> 第 trips - 1 份 -> 原来的 header
+            auto first = unroll_copies(trips, header);
+            redirect_edges(terminator(pre), header, first);
+            forward_block_params(first);
+            continue;
+        }
+
+        // 部分展开, 新的条件为 i op limit, limit 是 bound 向循环的反方向退 distance
+        if (factor < 2 || trips == 0 || counted.size * factor > MAX_PARTIAL_SIZE)
+            continue;
+        bool up = counted.op == KOOPA_RBO_LT || counted.op == KOOPA_RBO_LE;
+        bool down = counted.op == KOOPA_RBO_GT || counted.op == KOOPA_RBO_GE;
+        if (!(up && counted.step > 0) && !(down && counted.step < 0))
+            continue;
+        int64_t distance = (int64_t)(factor - 1) * std::abs((int64_t)counted.step);
+        if (distance > INT_MAX / 2)
+            continue;
+        auto pre_term = terminator(pre);
+        std::vector<const void *> pre_insts(pre->insts.buffer, pre->insts.buffer + pre->insts.len - 1);
+        koopa_raw_value_t limit, safe = nullptr;
+        if (counted.bound->kind.tag == KOOPA_RVT_INTEGER)
+        {
+            int64_t value = (int64_t)counted.bound->kind.data.integer.value + (up ? -distance : distance);
+            if (value < INT_MIN || value > INT_MAX)
+                continue;
+            limit = generate_number((int32_t)value);
+        }
+        else
+        {
+            // limit 不溢出时才进入展开的循环
+            auto sub = generate_binary_inst(counted.bound, generate_number((int32_t)(up ? distance : -distance)), KOOPA_RBO_SUB);
+            auto check = up ? generate_binary_inst(counted.bound, generate_number((int32_t)(INT_MIN + distance)), KOOPA_RBO_GE)
+                            : generate_binary_inst(counted.bound, generate_number((int32_t)(INT_MAX - distance)), KOOPA_RBO_LE);
+            pre_insts.push_back(sub);
+            pre_insts.push_back(check);
+            limit = sub;
+            safe = check;
+        }
+
+        // 展开的循环的 header
+        auto uh = raw_arena.make<koopa_raw_basic_block_data_t>();
+        uh->name = header->name == nullptr ? nullptr : raw_arena.make_string(std::string(header->name) + "_unrolled");
+        uh->params = generate_slice(KOOPA_RSIK_VALUE);
+        uh->insts = generate_slice(KOOPA_RSIK_VALUE);
+        uh->used_by = generate_slice(KOOPA_RSIK_VALUE);
+        std::vector<const void *> params;
+        for (uint32_t i = 0; i < header->params.len; i++)
+        {
+            auto param = (koopa_raw_value_t)header->params.buffer[i];
+            params.push_back(make_block_param(param->ty, param->name, i));
+        }
+        slice_append(uh->params, params);
+        inserted[header].push_back(uh);
+        auto first = unroll_copies(factor, uh);
+        auto cond = generate_binary_inst((koopa_raw_value_t)params[counted.index], limit, counted.op);
+        slice_append(uh->insts, {cond, make_branch(cond, first, header, params)});
+        forward_block_params(first);
+
+        // preheader 在 limit 不溢出时进入展开的循环
+        if (safe == nullptr)
+        {
+            redirect_edges(pre_term, header, uh);
+            continue;
+        }
+        const auto &args = pre_term->kind.data.jump.args;
+        pre_insts.push_back(make_branch(safe, uh, header, std::vector<const void *>(args.buffer, args.buffer + args.len)));
+        drop_operand_uses(pre_term);
+        pre->insts.len = 0;
+        slice_append(pre->insts, pre_insts);
+    }
+
+    if (inserted.empty())
+        return;
+    std::vector<const void *> bbs;
+    for (uint32_t i = 0; i < func->bbs.len; i++)
+    {
+        auto it = inserted.find((koopa_raw_basic_block_t)func->bbs.buffer[i]);
+        if (it != inserted.end())
+            bbs.insert(bbs.end(), it->second.begin(), it->second.end());
+        bbs.push_back(func->bbs.buffer[i]);
+    }
+    func->bbs.len = 0;
+    slice_append(func->bbs, bbs);
+}
@@ -1,4 +1,5 @@
 #include "visit.h"
+#include "opt.h"
 
 /**********************************************************************************************************/
 /************************************************Stack*****************************************************/
@@ -14,96 +15,128 @@ int Stack::get_loc(koopa_raw_value_t value)
     return value_loc[value];
 }
 
-void Stack::init()
+bool Stack::has_loc(koopa_raw_value_t value)
 {
-    len = 0;
-    pos = 0;
-    value_loc.clear();
+    return value_loc.count(value) != 0;
 }
 
-/**********************************************************************************************************/
-/**********************************************PtrSizeVec**************************************************/
-/**********************************************************************************************************/
-
-int PtrSizeVec::get_value_total_size(koopa_raw_value_t value)
+std::string Stack::double_jump_label(koopa_raw_basic_block_t bb)
 {
-    int offset = 4;
-    for (auto i : size_vec[value])
+    int count = double_jump_count[bb]++;
+    std::string label = std::string("DOUBLE_JUMP_") + (bb->name + 1);
+    if (count != 0)
     {
-        offset *= i;
+        label += "." + std::to_string(count);
     }
-    return offset;
+    return label;
 }
 
-int PtrSizeVec::get_value_offset(koopa_raw_value_t src)
+std::string Stack::zero_fill_label()
 {
-    auto it = size_vec[src].begin();
-    ++it;
-    int offset = 4;
-    for (; it != size_vec[src].end(); it++)
-    {
-        offset *= (*it);
-    }
-    return offset;
+    return std::string("ZERO_FILL_") + (entry->name + 1) + "." + std::to_string(zero_fill_count++);
 }
 
-void PtrSizeVec::push_size(koopa_raw_value_t value, int size)
+void Stack::init()
 {
-    size_vec[value].push_back(size);
+    len = 0;
+    pos = 0;
+    scratch = 0;
+    zero_fill_count = 0;
+    value_loc.clear();
+    double_jump_count.clear();
 }
 
-void PtrSizeVec::copy_size_vec(koopa_raw_value_t dest, koopa_raw_value_t src)
+/**********************************************************************************************************/
+/***********************************************TypeSize***************************************************/
+/**********************************************************************************************************/
+
+int TypeSize::size_of(koopa_raw_type_t ty)
 {
-    if (size_vec.find(src) != size_vec.end())
+    auto it = size_cache.find(ty);
+    if (it != size_cache.end())
     {
-        size_vec[dest] = size_vec[src];
+        return it->second;
     }
+    int size = 0;
+    switch (ty->tag)
+    {
+    case KOOPA_RTT_INT32:
+    case KOOPA_RTT_POINTER:
+        size = 4;
+        break;
+    case KOOPA_RTT_ARRAY:
+        size = size_of(ty->data.array.base) * ty->data.array.len;
+        break;
+    case KOOPA_RTT_UNIT:
+        size = 0;
+        break;
+    default:
+        assert(false);
+    }
+    size_cache[ty] = size;
+    return size;
 }
 
-void PtrSizeVec::copy_size_vec_ptr(koopa_raw_value_t dest, koopa_raw_value_t src)
+void TypeSize::clear()
 {
-    auto it = size_vec[src].begin();
-    it++;
-    std::vector<int> tmp;
-    for (; it != size_vec[src].end(); it++)
-    {
-        tmp.push_back(*it);
-    }
-    size_vec[dest] = tmp;
+    size_cache.clear();
 }
 
 /**********************************************************************************************************/
 /************************************************Visit*****************************************************/
 /**********************************************************************************************************/
 
+ThreadPool *backend_pool = nullptr;
+
 // 访问 raw program
-std::string Visit(const koopa_raw_program_t &program)
+void Visit(const koopa_raw_program_t &program, OutputSink &out)
 {
     // 执行一些其他的必要操作
     // ...
+    // 类型指针只在本次编译内有效
+    type_size.clear();
     // 访问所有全局变量
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit global value\n";
+    out << "visit global value\n";
 #endif
-    ret += Visit(program.values);
+    Visit(program.values, out);
     // 访问所有函数
 #ifdef DEBUG
-    ret += "visit functions\n";
+    out << "visit functions\n";
 #endif
-    ret += Visit(program.funcs);
-
-    std::string optimized_code = optimize_riscv_code(ret);
-
-    return optimized_code;
+    if (backend_pool == nullptr)
+    {
+        Visit(program.funcs, out);
+        return;
+    }
+    // 每个函数作为一个任务, 代码写入 func_code 中对应的位置, 函数声明不生成代码
+    std::vector<StringSink> func_code(program.funcs.len);
+    ThreadPool::TaskGroup group;
+    for (size_t i = 0; i < program.funcs.len; ++i)
+    {
+        auto func = reinterpret_cast<koopa_raw_function_t>(program.funcs.buffer[i]);
+        if (func->bbs.len == 0)
+            continue;
+        StringSink *code = &func_code[i];
+        backend_pool->submit([func, code]
+                             {
+                                 // 执行任务的线程可能还缓存着之前编译的类型
+                                 type_size.clear();
+                                 Visit(func, *code); },
+                             group);
+    }
+    backend_pool->wait(group);
+    for (const auto &code : func_code)
+    {
+        out.write(code.str.data(), code.str.size());
+    }
 }
 
 // 访问 raw slice
-std::string Visit(const koopa_raw_slice_t &slice)
+void Visit(const koopa_raw_slice_t &slice, OutputSink &out)
 {
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit slice\n";
+    out << "visit slice\n";
 #endif
     for (size_t i = 0; i < slice.len; ++i)
     {
@@ -113,42 +146,41 @@ std::string Visit(const koopa_raw_slice_t &slice)
         {
         case KOOPA_RSIK_FUNCTION:
             // 访问函数
-            ret += Visit(reinterpret_cast<koopa_raw_function_t>(ptr));
+            Visit(reinterpret_cast<koopa_raw_function_t>(ptr), out);
             break;
         case KOOPA_RSIK_BASIC_BLOCK:
             // 访问基本块
-            ret += Visit(reinterpret_cast<koopa_raw_basic_block_t>(ptr));
+            Visit(reinterpret_cast<koopa_raw_basic_block_t>(ptr), out);
             break;
         case KOOPA_RSIK_VALUE:
             // 访问指令
-            ret += Visit(reinterpret_cast<koopa_raw_value_t>(ptr));
+            Visit(reinterpret_cast<koopa_raw_value_t>(ptr), out);
             break;
         default:
             // 我们暂时不会遇到其他内容, 于是不对其做任何处理
             assert(false);
         }
     }
-    return ret;
 }
 
 // 访问函数
-std::string Visit(const koopa_raw_function_t &func)
+void Visit(const koopa_raw_function_t &func, OutputSink &out)
 {
     // 忽略函数声明
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit function\n";
+    out << "visit function\n";
 #endif
     if (func->bbs.len == 0)
-        return ret;
+        return;
 
     // 执行一些其他的必要操作
-    ret += "  .text\n";
-    ret += "  .globl " + std::string(func->name + 1) + "\n";
-    ret += std::string(func->name + 1) + ":\n";
+    out << "  .text\n";
+    out << "  .globl " << (func->name + 1) << "\n";
+    out << (func->name + 1) << ":\n";
 
     // 清空
     stack.init();
+    stack.params = func->params.len;
 
     // 计算栈帧长度需要的值
     // 局部变量个数
@@ -157,11 +189,18 @@ std::string Visit(const koopa_raw_function_t &func)
     ra_count = 0;
     // 需要为传参预留几个变量的栈空间
     int arg_count = 0;
+    // 寄存器中传入的参数在调用其他函数后会被覆盖, 除了在入口处第一次调用前直接存入 alloc 的以外都要先保存到栈上
+    std::vector<koopa_raw_value_t> spilled_args;
+    bool before_call = true;
+    // 跳转时最多传递几个基本块参数
+    int max_block_args = 0;
 
     // 遍历基本块
     for (size_t i = 0; i < func->bbs.len; ++i)
     {
-        const auto &insts = reinterpret_cast<koopa_raw_basic_block_t>(func->bbs.buffer[i])->insts;
+        auto bb = reinterpret_cast<koopa_raw_basic_block_t>(func->bbs.buffer[i]);
+        const auto &insts = bb->insts;
+        var_count += bb->params.len;
         for (size_t j = 0; j < insts.len; ++j)
         {
             auto inst = reinterpret_cast<koopa_raw_value_t>(insts.buffer[j]);
@@ -169,32 +208,39 @@ std::string Visit(const koopa_raw_function_t &func)
             {
                 var_count++;
             }
+            for_each_operand(inst, [&](koopa_raw_value_t &op)
+                             {
+                                 if (op->kind.tag == KOOPA_RVT_FUNC_ARG_REF && op->kind.data.func_arg_ref.index < 8 &&
+                                     !(before_call && inst->kind.tag == KOOPA_RVT_STORE && &op == &inst->kind.data.store.value &&
+                                       inst->kind.data.store.dest->kind.tag == KOOPA_RVT_ALLOC) &&
+                                     std::find(spilled_args.begin(), spilled_args.end(), op) == spilled_args.end())
+                                     spilled_args.push_back(op); });
+            for_each_edge(inst, [&](koopa_raw_basic_block_t, koopa_raw_slice_t &args)
+                          { max_block_args = std::max(max_block_args, int(args.len)); });
             if (inst->kind.tag == KOOPA_RVT_CALL)
             {
-                ra_count = 1;
+                before_call = false;
+                // 尾调用直接跳到被调用的函数, 不改写 ra
+                if (!is_tail_call(bb, j))
+                    ra_count = 1;
                 arg_count = std::max(arg_count, std::max(0, int(inst->kind.data.call.args.len) - 8));
             }
             else if (inst->kind.tag == KOOPA_RVT_ALLOC &&
                      inst->ty->data.pointer.base->tag == KOOPA_RTT_ARRAY)
             {
                 var_count--;
-                int arrmem = 1;
-                auto base = inst->ty->data.pointer.base;
-                while (base->tag == KOOPA_RTT_ARRAY)
-                {
-                    ptr_size_vec.push_size(inst, base->data.array.len);
-                    arrmem *= base->data.array.len;
-                    base = base->data.array.base;
-                }
-                var_count += arrmem;
+                var_count += type_size.size_of(inst->ty->data.pointer.base) / 4;
             }
         }
+        before_call = false;
     }
 #ifdef DEBUG
-    ret += "var_count: " + std::to_string(var_count) + "\n";
-    ret += "ra_count: " + std::to_string(ra_count) + "\n";
-    ret += "arg_count: " + std::to_string(arg_count) + "\n";
+    out << "var_count: " << var_count << "\n";
+    out << "ra_count: " << ra_count << "\n";
+    out << "arg_count: " << arg_count << "\n";
 #endif
+    var_count += spilled_args.size();
+    var_count += max_block_args;
     stack.len = (var_count + ra_count + arg_count) * 4;
     // 将栈帧长度对齐到 16
     stack.len = (stack.len + 15) / 16 * 16;
@@ -202,347 +248,332 @@ std::string Visit(const koopa_raw_function_t &func)
 
     if (stack.len != 0)
     {
-        ret += deal_offset_exceed(stack.len, "addi-", "sp");
+        deal_offset_exceed(stack.len, "addi-", "sp", out);
     }
 
     if (ra_count)
     {
-        ret += deal_offset_exceed(stack.len - 4, "sw", "ra");
+        deal_offset_exceed(stack.len - 4, "sw", "ra", out);
+    }
+
+    for (auto arg : spilled_args)
+    {
+        stack.alloc_value(arg, stack.pos);
+        stack.pos += 4;
+        deal_offset_exceed(stack.get_loc(arg), "sw", "a" + std::to_string(arg->kind.data.func_arg_ref.index), out);
+    }
+    // 基本块参数的栈空间
+    for (size_t i = 0; i < func->bbs.len; ++i)
+    {
+        const auto &params = reinterpret_cast<koopa_raw_basic_block_t>(func->bbs.buffer[i])->params;
+        for (size_t j = 0; j < params.len; ++j)
+        {
+            stack.alloc_value(reinterpret_cast<koopa_raw_value_t>(params.buffer[j]), stack.pos);
+            stack.pos += 4;
+        }
     }
+    stack.scratch = stack.pos;
+    stack.pos += max_block_args * 4;
 
     // 访问所有基本块
-    ret += Visit(func->bbs);
-    ret += "\n";
-    return ret;
+    stack.entry = reinterpret_cast<koopa_raw_basic_block_t>(func->bbs.buffer[0]);
+    Visit(func->bbs, out);
+    out << "\n";
 }
 
 // 访问基本块
-std::string Visit(const koopa_raw_basic_block_t &bb)
+void Visit(const koopa_raw_basic_block_t &bb, OutputSink &out)
 {
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit basic block\n";
+    out << "visit basic block\n";
 #endif
     // 执行一些其他的必要操作
-    // 当前块的label, %entry开头的不打印
-    if (strncmp(bb->name + strlen(bb->name) - 5, "entry", 5) != 0)
+    // 当前块的label, 入口基本块不打印
+    if (bb != stack.entry)
     {
-        ret += std::string(bb->name + 1) + ":\n";
+        out << (bb->name + 1) << ":\n";
+    }
+    // 访问所有指令, 尾调用之后的 ret 不再需要
+    for (size_t i = 0; i < bb->insts.len; ++i)
+    {
+        auto inst = reinterpret_cast<koopa_raw_value_t>(bb->insts.buffer[i]);
+        if (is_tail_call(bb, i))
+        {
+            tail_call(inst->kind.data.call, out);
+            break;
+        }
+        Visit(inst, out);
     }
-    // 访问所有指令
-    ret += Visit(bb->insts);
-    return ret;
 }
 
 // 访问指令
-std::string Visit(const koopa_raw_value_t &value)
+void Visit(const koopa_raw_value_t &value, OutputSink &out)
 {
     // 根据指令类型判断后续需要如何访问
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit value\n";
+    out << "visit value\n";
 #endif
     const auto &kind = value->kind;
-    koopa_raw_type_t base;
     switch (kind.tag)
     {
     case KOOPA_RVT_INTEGER:
         // 访问 integer 指令
-        ret += Visit(kind.data.integer);
+        Visit(kind.data.integer, out);
         break;
     case KOOPA_RVT_ALLOC:
-        base = value->ty->data.pointer.base;
-        if (base->tag == KOOPA_RTT_INT32)
-        {
+        // 整数, 数组或指针, 按类型的大小在栈上分配
 #ifdef DEBUG
-            ret += "alloc integer\n";
+        out << "alloc\n";
 #endif
-            stack.alloc_value(value, stack.pos);
-            stack.pos += 4;
-        }
-        else if (base->tag == KOOPA_RTT_ARRAY)
-        {
-#ifdef DEBUG
-            ret += "alloc array\n";
-#endif
-            int arrmem = ptr_size_vec.get_value_total_size(value);
-            stack.alloc_value(value, stack.pos);
-            stack.pos += arrmem;
-        }
-        else if (base->tag == KOOPA_RTT_POINTER)
-        {
-#ifdef DEBUG
-            ret += "alloc pointer\n";
-#endif
-            while (base->tag == KOOPA_RTT_POINTER)
-            {
-                ptr_size_vec.push_size(value, 1);
-                base = base->data.array.base;
-            }
-            while (base->tag == KOOPA_RTT_ARRAY)
-            {
-                ptr_size_vec.push_size(value, base->data.array.len);
-                base = base->data.array.base;
-            }
-            stack.alloc_value(value, stack.pos);
-            stack.pos += 4;
-        }
+        stack.alloc_value(value, stack.pos);
+        stack.pos += type_size.size_of(value->ty->data.pointer.base);
         break;
     case KOOPA_RVT_GLOBAL_ALLOC:
         // 访问 global alloc 指令
-        ret += Visit(value->kind.data.global_alloc, value);
+        Visit(value->kind.data.global_alloc, value, out);
         break;
     case KOOPA_RVT_LOAD:
         // 访问 load 指令
-        ret += Visit(kind.data.load, value);
+        Visit(kind.data.load, value, out);
         break;
     case KOOPA_RVT_STORE:
         // 访问 store 指令
-        ret += Visit(kind.data.store);
+        Visit(kind.data.store, out);
         break;
     case KOOPA_RVT_GET_PTR:
         // 访问 getptr 指令
-        ret += Visit(kind.data.get_ptr, value);
+        Visit(kind.data.get_ptr, value, out);
         break;
     case KOOPA_RVT_GET_ELEM_PTR:
         // 访问 getelemptr 指令
-        ret += Visit(kind.data.get_elem_ptr, value);
+        Visit(kind.data.get_elem_ptr, value, out);
         break;
     case KOOPA_RVT_BINARY:
         // 访问 binary 指令
-        ret += Visit(kind.data.binary, value);
+        Visit(kind.data.binary, value, out);
         break;
     case KOOPA_RVT_BRANCH:
         // 访问 branch 指令
-        ret += Visit(kind.data.branch);
+        Visit(kind.data.branch, out);
         break;
     case KOOPA_RVT_JUMP:
         // 访问 jump 指令
-        ret += Visit(kind.data.jump);
+        Visit(kind.data.jump, out);
         break;
     case KOOPA_RVT_CALL:
         // 访问 call 指令
-        ret += Visit(kind.data.call, value);
+        Visit(kind.data.call, value, out);
         break;
     case KOOPA_RVT_RETURN:
         // 访问 return 指令
-        ret += Visit(kind.data.ret);
+        Visit(kind.data.ret, out);
         break;
     default:
         // 其他类型暂时遇不到
         assert(false);
         break;
     }
-    return ret;
 }
 
 // 访问 return 指令
-std::string Visit(const koopa_raw_return_t &ret_inst)
+void Visit(const koopa_raw_return_t &ret_inst, OutputSink &out)
 {
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit return\n";
+    out << "visit return\n";
 #endif
     // 返回值存入 a0
     if (ret_inst.value != nullptr)
     {
-        ret += loadstack_reg(ret_inst.value, "a0");
+        loadstack_reg(ret_inst.value, "a0", out);
     }
     // 从栈帧中恢复 ra 寄存器
     if (ra_count)
     {
-        ret += deal_offset_exceed(stack.len - 4, "lw", "ra");
+        deal_offset_exceed(stack.len - 4, "lw", "ra", out);
     }
     // 恢复栈帧
     if (stack.len != 0)
     {
-        ret += deal_offset_exceed(stack.len, "addi+", "sp");
+        deal_offset_exceed(stack.len, "addi+", "sp", out);
     }
-    ret += "  ret\n";
-    return ret;
+    out << "  ret\n";
 }
 
 // 访问 integer 指令
-std::string Visit(const koopa_raw_integer_t &integer)
+void Visit(const koopa_raw_integer_t &integer, OutputSink &out)
 {
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit integer\n";
+    out << "visit integer\n";
 #endif
-    ret += loadint_reg(integer.value, "a0");
-    return ret;
+    loadint_reg(integer.value, "a0", out);
 }
 
 // 访问 binary 指令
-std::string Visit(const koopa_raw_binary_t &binary, const koopa_raw_value_t &value)
+void Visit(const koopa_raw_binary_t &binary, const koopa_raw_value_t &value, OutputSink &out)
 {
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit binary\n";
+    out << "visit binary\n";
 #endif
     // 将运算数存入 t0 和 t1
-    ret += loadstack_reg(binary.lhs, "t0");
-    ret += loadstack_reg(binary.rhs, "t1");
+    loadstack_reg(binary.lhs, "t0", out);
+    loadstack_reg(binary.rhs, "t1", out);
 
     // 进行运算
     switch (binary.op)
     {
     case KOOPA_RBO_ADD:
-        ret += "  add t0, t0, t1\n";
+        out << "  add t0, t0, t1\n";
         break;
     case KOOPA_RBO_SUB:
-        ret += "  sub t0, t0, t1\n";
+        out << "  sub t0, t0, t1\n";
         break;
     case KOOPA_RBO_MUL:
-        ret += "  mul t0, t0, t1\n";
+        out << "  mul t0, t0, t1\n";
         break;
     case KOOPA_RBO_DIV:
-        ret += "  div t0, t0, t1\n";
+        out << "  div t0, t0, t1\n";
         break;
     case KOOPA_RBO_MOD:
-        ret += "  rem t0, t0, t1\n";
+        out << "  rem t0, t0, t1\n";
         break;
     case KOOPA_RBO_AND:
-        ret += "  and t0, t0, t1\n";
+        out << "  and t0, t0, t1\n";
         break;
     case KOOPA_RBO_OR:
-        ret += "  or t0, t0, t1\n";
+        out << "  or t0, t0, t1\n";
         break;
     case KOOPA_RBO_XOR:
-        ret += "  xor t0, t0, t1\n";
+        out << "  xor t0, t0, t1\n";
         break;
     case KOOPA_RBO_SHL:
-        ret += "  sll t0, t0, t1\n";
+        out << "  sll t0, t0, t1\n";
         break;
     case KOOPA_RBO_SHR:
-        ret += "  srl t0, t0, t1\n";
+        out << "  srl t0, t0, t1\n";
         break;
     case KOOPA_RBO_SAR:
-        ret += "  sra t0, t0, t1\n";
+        out << "  sra t0, t0, t1\n";
         break;
     case KOOPA_RBO_EQ:
-        ret += "  xor t0, t0, t1\n";
-        ret += "  seqz t0, t0\n";
+        out << "  xor t0, t0, t1\n";
+        out << "  seqz t0, t0\n";
         break;
     case KOOPA_RBO_NOT_EQ:
-        ret += "  xor t0, t0, t1\n";
-        ret += "  snez t0, t0\n";
+        out << "  xor t0, t0, t1\n";
+        out << "  snez t0, t0\n";
         break;
     case KOOPA_RBO_GT:
-        ret += "  slt t0, t1, t0\n";
+        out << "  slt t0, t1, t0\n";
         break;
     case KOOPA_RBO_LT:
-        ret += "  slt t0, t0, t1\n";
+        out << "  slt t0, t0, t1\n";
         break;
     case KOOPA_RBO_GE:
-        ret += "  slt t0, t0, t1\n";
-        ret += "  xori t0, t0, 1\n";
+        out << "  slt t0, t0, t1\n";
+        out << "  xori t0, t0, 1\n";
         break;
     case KOOPA_RBO_LE:
-        ret += "  slt t0, t1, t0\n";
-        ret += "  xori t0, t0, 1\n";
+        out << "  slt t0, t1, t0\n";
+        out << "  xori t0, t0, 1\n";
         break;
     }
 
     stack.alloc_value(value, stack.pos);
     stack.pos += 4;
-    ret += save_reg(value, "t0");
-
-    return ret;
+    save_reg(value, "t0", out);
 }
 
 // 访问 load 指令
-std::string Visit(const koopa_raw_load_t &load, const koopa_raw_value_t &value)
+void Visit(const koopa_raw_load_t &load, const koopa_raw_value_t &value, OutputSink &out)
 {
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit load\n";
+    out << "visit load\n";
 #endif
     switch (load.src->kind.tag)
     {
     case KOOPA_RVT_GLOBAL_ALLOC:
-        ret += loadaddr_reg(load.src, "t0");
-        ret += "  lw t0, 0(t0)\n";
+        loadaddr_reg(load.src, "t0", out);
+        out << "  lw t0, 0(t0)\n";
         break;
-    case KOOPA_RVT_GET_PTR:
-    case KOOPA_RVT_GET_ELEM_PTR:
-        ret += loadstack_reg(load.src, "t0");
-        ret += "  lw t0, 0(t0)\n";
+    case KOOPA_RVT_ALLOC:
+        loadstack_reg(load.src, "t0", out);
         break;
     default:
-        ret += loadstack_reg(load.src, "t0");
+        // getptr, getelemptr 或基本块参数, 栈上保存的是指针
+        loadstack_reg(load.src, "t0", out);
+        out << "  lw t0, 0(t0)\n";
         break;
     };
 
-    ptr_size_vec.copy_size_vec(value, load.src);
     // 存入栈
     stack.alloc_value(value, stack.pos);
     stack.pos += 4;
-    ret += save_reg(value, "t0");
-
-    return ret;
+    save_reg(value, "t0", out);
 }
 
 // 访问 store 指令
-std::string Visit(const koopa_raw_store_t &store)
+void Visit(const koopa_raw_store_t &store, OutputSink &out)
 {
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit store\n";
+    out << "visit store\n";
 #endif
+    if (store.value->kind.tag == KOOPA_RVT_ZERO_INIT)
+    {
+        // 整个数组清零
+        zero_fill(store.dest, type_size.size_of(store.value->ty), out);
+        return;
+    }
     switch (store.dest->kind.tag)
     {
     case KOOPA_RVT_GLOBAL_ALLOC:
-        ret += loadstack_reg(store.value, "t0");
-        ret += loadaddr_reg(store.dest, "t1");
-        ret += "  sw t0, 0(t1)\n";
+        loadstack_reg(store.value, "t0", out);
+        loadaddr_reg(store.dest, "t1", out);
+        out << "  sw t0, 0(t1)\n";
         break;
-    case KOOPA_RVT_GET_PTR:
-    case KOOPA_RVT_GET_ELEM_PTR:
-        ret += loadstack_reg(store.value, "t0");
-        ret += loadstack_reg(store.dest, "t1");
-        ret += "  sw t0, 0(t1)\n";
+    case KOOPA_RVT_ALLOC:
+        loadstack_reg(store.value, "t0", out);
+        save_reg(store.dest, "t0", out);
         break;
     default:
-        ret += loadstack_reg(store.value, "t0");
-        ret += save_reg(store.dest, "t0");
+        // getptr, getelemptr 或基本块参数, 栈上保存的是指针
+        loadstack_reg(store.value, "t0", out);
+        loadstack_reg(store.dest, "t1", out);
+        out << "  sw t0, 0(t1)\n";
         break;
     };
-    return ret;
 }
 
 // 访问 branch 指令
-std::string Visit(const koopa_raw_branch_t &branch)
+void Visit(const koopa_raw_branch_t &branch, OutputSink &out)
 {
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit branch\n";
+    out << "visit branch\n";
 #endif
-    ret += loadstack_reg(branch.cond, "t0");
-    ret += "  bnez t0, DOUBLE_JUMP_" + std::string(branch.true_bb->name + 1) + "\n";
-    ret += "  j " + std::string(branch.false_bb->name + 1) + "\n";
-    ret += "DOUBLE_JUMP_" + std::string(branch.true_bb->name + 1) + ":\n";
-    ret += "  j " + std::string(branch.true_bb->name + 1) + "\n";
-    return ret;
+    std::string label = stack.double_jump_label(branch.true_bb);
+    loadstack_reg(branch.cond, "t0", out);
+    out << "  bnez t0, " << label << "\n";
+    copy_block_args(branch.false_bb, branch.false_args, out);
+    out << "  j " << (branch.false_bb->name + 1) << "\n";
+    out << label << ":\n";
+    copy_block_args(branch.true_bb, branch.true_args, out);
+    out << "  j " << (branch.true_bb->name + 1) << "\n";
 }
 
 // 访问 jump 指令
-std::string Visit(const koopa_raw_jump_t &jump)
+void Visit(const koopa_raw_jump_t &jump, OutputSink &out)
 {
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit jump\n";
+    out << "visit jump\n";
 #endif
-    ret += "  j " + std::string(jump.target->name + 1) + "\n";
-    return ret;
+    copy_block_args(jump.target, jump.args, out);
+    out << "  j " << (jump.target->name + 1) << "\n";
 }
 
 // 访问 call 指令
-std::string Visit(const koopa_raw_call_t &call, const koopa_raw_value_t &value)
+void Visit(const koopa_raw_call_t &call, const koopa_raw_value_t &value, OutputSink &out)
 {
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit call\n";
+    out << "visit call\n";
 #endif
     // 处理参数
     for (size_t i = 0; i < call.args.len; ++i)
@@ -550,199 +581,234 @@ std::string Visit(const koopa_raw_call_t &call, const koopa_raw_value_t &value)
         auto arg = reinterpret_cast<koopa_raw_value_t>(call.args.buffer[i]);
         if (i < 8)
         {
-            ret += loadstack_reg(arg, "a" + std::to_string(i));
+            loadstack_reg(arg, "a" + std::to_string(i), out);
         }
         else
         {
-            ret += loadstack_reg(arg, "t0");
-            ret += deal_offset_exceed((i - 8) * 4, "sw", "t0");
+            loadstack_reg(arg, "t0", out);
+            deal_offset_exceed((i - 8) * 4, "sw", "t0", out);
         }
     }
     // call half
-    ret += "  call " + std::string(call.callee->name + 1) + "\n";
+    out << "  call " << (call.callee->name + 1) << "\n";
     // 若有返回值则将 a0 中的结果存入栈
     if (value->ty->tag != KOOPA_RTT_UNIT)
     {
         stack.alloc_value(value, stack.pos);
         stack.pos += 4;
-        ret += save_reg(value, "a0");
+        save_reg(value, "a0", out);
     }
-    return ret;
 }
 
 // 访问 global alloc 指令
-std::string Visit(const koopa_raw_global_alloc_t &global_alloc, const koopa_raw_value_t &value)
+void Visit(const koopa_raw_global_alloc_t &global_alloc, const koopa_raw_value_t &value, OutputSink &out)
 {
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit global alloc\n";
+    out << "visit global alloc\n";
 #endif
-    ret += "  .data\n";
-    ret += "  .globl " + std::string(value->name + 1) + "\n";
-    ret += std::string(value->name + 1) + ":\n";
+    out << "  .data\n";
+    out << "  .globl " << (value->name + 1) << "\n";
+    out << (value->name + 1) << ":\n";
     if (global_alloc.init->kind.tag == KOOPA_RVT_ZERO_INIT)
     {
         // 初始化为 0
-        auto base = value->ty->data.pointer.base;
-        if (base->tag == KOOPA_RTT_INT32)
-        {
-            ret += "  .zero 4\n";
-        }
-        else if (base->tag == KOOPA_RTT_ARRAY)
-        {
-            int size = 4;
-            while (base->tag == KOOPA_RTT_ARRAY)
-            {
-                ptr_size_vec.push_size(value, base->data.array.len);
-                size *= base->data.array.len;
-                base = base->data.array.base;
-            }
-            ret += "  .zero " + std::to_string(size) + "\n";
-        }
+        out << "  .zero " << type_size.size_of(value->ty->data.pointer.base) << "\n";
     }
     if (global_alloc.init->kind.tag == KOOPA_RVT_INTEGER)
     {
-        ret += "  .word " + std::to_string(global_alloc.init->kind.data.integer.value) + "\n";
+        out << "  .word " << global_alloc.init->kind.data.integer.value << "\n";
     }
     else if (global_alloc.init->kind.tag == KOOPA_RVT_AGGREGATE)
     {
         // 数组，初始化为 Aggregate
-        auto base = value->ty->data.pointer.base;
-        while (base->tag == KOOPA_RTT_ARRAY)
-        {
-            ptr_size_vec.push_size(value, base->data.array.len);
-            base = base->data.array.base;
-        }
-        ret += aggregate_init(global_alloc.init);
+        aggregate_init(global_alloc.init, out);
     }
-    ret += "\n";
-    return ret;
+    out << "\n";
 }
 
 // 访问 getptr 指令
-std::string Visit(const koopa_raw_get_ptr_t &get_ptr, const koopa_raw_value_t &value)
+void Visit(const koopa_raw_get_ptr_t &get_ptr, const koopa_raw_value_t &value, OutputSink &out)
 {
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit getptr\n";
+    out << "visit getptr\n";
 #endif
-    ret += loadaddr_reg(get_ptr.src, "t0");
-    ret += "  lw t0, 0(t0)\n";
-    int offset = ptr_size_vec.get_value_offset(get_ptr.src);
-    ret += loadstack_reg(get_ptr.index, "t1");
-    ret += loadint_reg(offset, "t2");
-    ret += "  mul t1, t1, t2\n";
-    ret += "  add t0, t0, t1\n";
-
-    ptr_size_vec.copy_size_vec_ptr(value, get_ptr.src);
+    loadptr_reg(get_ptr.src, "t0", out);
+    // 每一步跨过一个 src 所指向的对象
+    add_scaled_index(get_ptr.index, type_size.size_of(get_ptr.src->ty->data.pointer.base), out);
+
     // 存入栈
     stack.alloc_value(value, stack.pos);
     stack.pos += 4;
-    ret += save_reg(value, "t0");
-
-    return ret;
+    save_reg(value, "t0", out);
 }
 
 // 访问 getelemptr 指令
-std::string Visit(const koopa_raw_get_elem_ptr_t &get_elem_ptr, const koopa_raw_value_t &value)
+void Visit(const koopa_raw_get_elem_ptr_t &get_elem_ptr, const koopa_raw_value_t &value, OutputSink &out)
 {
-    std::string ret = "";
 #ifdef DEBUG
-    ret += "visit getelemptr\n";
+    out << "visit getelemptr\n";
 #endif
-    ret += loadaddr_reg(get_elem_ptr.src, "t0");
-    if (get_elem_ptr.src->kind.tag == KOOPA_RVT_GET_ELEM_PTR ||
-        get_elem_ptr.src->kind.tag == KOOPA_RVT_GET_PTR)
-    {
-        ret += "  lw t0, 0(t0)\n";
-    }
+    loadptr_reg(get_elem_ptr.src, "t0", out);
+    // 每一步跨过 src 所指向数组的一个元素
+    add_scaled_index(get_elem_ptr.index, type_size.size_of(get_elem_ptr.src->ty->data.pointer.base->data.array.base), out);
 
-    int offset = ptr_size_vec.get_value_offset(get_elem_ptr.src);
-    ret += loadstack_reg(get_elem_ptr.index, "t1");
-    ret += loadint_reg(offset, "t2");
-    ret += "  mul t1, t1, t2\n";
-    ret += "  add t0, t0, t1\n";
-
-    ptr_size_vec.copy_size_vec_ptr(value, get_elem_ptr.src);
     // 存入栈
     stack.alloc_value(value, stack.pos);
     stack.pos += 4;
-    ret += save_reg(value, "t0");
-
-    return ret;
+    save_reg(value, "t0", out);
 }
 
 /**********************************************************************************************************/
 /************************************************Utils*****************************************************/
 /**********************************************************************************************************/
 
-std::string loadstack_reg(const koopa_raw_value_t &value, const std::string &reg)
+void loadstack_reg(const koopa_raw_value_t &value, const std::string &reg, OutputSink &out)
 {
     int index;
-    std::string ret = "";
     switch (value->kind.tag)
     {
     case KOOPA_RVT_INTEGER:
-        ret += loadint_reg(value->kind.data.integer.value, reg);
+        loadint_reg(value->kind.data.integer.value, reg, out);
         break;
     case KOOPA_RVT_FUNC_ARG_REF:
         index = value->kind.data.func_arg_ref.index;
-        if (index < 8)
+        if (stack.has_loc(value))
+        {
+            // 已经保存到栈上的寄存器参数
+            deal_offset_exceed(stack.get_loc(value), "lw", reg, out);
+        }
+        else if (index < 8)
         {
-            ret += "  mv " + reg + ", a" + std::to_string(index) + "\n";
+            out << "  mv " << reg << ", a" << index << "\n";
         }
         else
         {
-            ret += deal_offset_exceed(stack.len + (index - 8) * 4, "lw", reg);
+            deal_offset_exceed(stack.len + (index - 8) * 4, "lw", reg, out);
         }
         break;
     case KOOPA_RVT_GLOBAL_ALLOC:
-        ret += "  la t1, " + std::string(value->name + 1) + "\n";
-        ret += "  lw " + reg + ", 0(t1)\n";
+        out << "  la t1, " << (value->name + 1) << "\n";
+        out << "  lw " << reg << ", 0(t1)\n";
         break;
     default:
         // 一定保存在栈里, 或者是全局符号
-        ret += deal_offset_exceed(stack.get_loc(value), "lw", reg);
+        deal_offset_exceed(stack.get_loc(value), "lw", reg, out);
         break;
     }
-    return ret;
 }
 
 // 将 value 的值放置在标号为 reg 的寄存器中
-std::string loadint_reg(int value, const std::string &reg)
+void loadint_reg(int value, const std::string &reg, OutputSink &out)
 {
-    std::string ret = "";
-    ret += "  li " + reg + ", " + std::to_string(value) + "\n";
-    return ret;
+    out << "  li " << reg << ", " << value << "\n";
 }
 
 // 将 value 的地址放置在标号为 reg 的寄存器中
-std::string loadaddr_reg(const koopa_raw_value_t &value, const std::string &reg)
+void loadaddr_reg(const koopa_raw_value_t &value, const std::string &reg, OutputSink &out)
 {
-    std::string ret = "";
     int index;
     switch (value->kind.tag)
     {
     case KOOPA_RVT_FUNC_ARG_REF:
         index = value->kind.data.func_arg_ref.index;
         assert(index >= 8);
-        ret += loadint_reg(stack.len + (index - 8) * 4, reg);
-        ret += "  add " + reg + ", " + reg + ", sp\n";
+        loadint_reg(stack.len + (index - 8) * 4, reg, out);
+        out << "  add " << reg << ", " << reg << ", sp\n";
         break;
     case KOOPA_RVT_GLOBAL_ALLOC:
-        ret += "  la " + reg + ", " + std::string(value->name + 1) + "\n";
+        out << "  la " << reg << ", " << (value->name + 1) << "\n";
         break;
     default:
-        ret += deal_offset_exceed(stack.get_loc(value), "addi+", reg);
+        deal_offset_exceed(stack.get_loc(value), "addi+", reg, out);
         break;
     }
-    return ret;
+}
+
+// 将指针 value 的值放置在 reg 中: alloc 和全局变量是它们自己的地址, 其余的指针值保存在栈上
+void loadptr_reg(const koopa_raw_value_t &value, const std::string &reg, OutputSink &out)
+{
+    if (value->kind.tag == KOOPA_RVT_ALLOC || value->kind.tag == KOOPA_RVT_GLOBAL_ALLOC)
+    {
+        loadaddr_reg(value, reg, out);
+    }
+    else
+    {
+        loadstack_reg(value, reg, out);
+    }
+}
+
+// 将 dest 指向的 size 字节清零. 不超过 ZERO_FILL_UNROLL 个字时逐字写 0,
+// 否则先写掉不足一轮的部分, 再用每轮写 ZERO_FILL_UNROLL 个字的循环, 代码长度与数组大小无关
+void zero_fill(const koopa_raw_value_t &dest, int size, OutputSink &out)
+{
+    const int ZERO_FILL_UNROLL = 8;
+    loadptr_reg(dest, "t1", out);
+    int words = size / 4;
+    int head = words <= ZERO_FILL_UNROLL ? words : words % ZERO_FILL_UNROLL;
+    for (int i = 0; i < head; i++)
+    {
+        out << "  sw zero, " << i * 4 << "(t1)\n";
+    }
+    if (head == words)
+    {
+        return;
+    }
+    if (head != 0)
+    {
+        out << "  addi t1, t1, " << head * 4 << "\n";
+    }
+    std::string label = stack.zero_fill_label();
+    loadint_reg((words - head) * 4, "t2", out);
+    out << "  add t2, t1, t2\n";
+    out << label << ":\n";
+    for (int i = 0; i < ZERO_FILL_UNROLL; i++)
+    {
+        out << "  sw zero, " << i * 4 << "(t1)\n";
+    }
+    out << "  addi t1, t1, " << ZERO_FILL_UNROLL * 4 << "\n";
+    out << "  bne t1, t2, " << label << "\n";
+}
+
+// t0 += index * size. 常量下标直接算出偏移, size 是 2 的幂时用移位代替乘法
+void add_scaled_index(const koopa_raw_value_t &index, int size, OutputSink &out)
+{
+    if (index->kind.tag == KOOPA_RVT_INTEGER)
+    {
+        int offset = (int)((int64_t)index->kind.data.integer.value * size);
+        if (offset == 0)
+        {
+            return;
+        }
+        if (offset >= -2048 && offset <= 2047)
+        {
+            out << "  addi t0, t0, " << offset << "\n";
+            return;
+        }
+        loadint_reg(offset, "t1", out);
+        out << "  add t0, t0, t1\n";
+        return;
+    }
+    loadstack_reg(index, "t1", out);
+    if ((size & (size - 1)) == 0)
+    {
+        int shift = 0;
+        while ((1 << shift) < size)
+        {
+            shift++;
+        }
+        out << "  slli t1, t1, " << shift << "\n";
+    }
+    else
+    {
+        loadint_reg(size, "t2", out);
+        out << "  mul t1, t1, t2\n";
+    }
+    out << "  add t0, t0, t1\n";
 }
 
 // 将标号为 reg 的寄存器中的value的值保存在内存中
-std::string save_reg(const koopa_raw_value_t &value, const std::string &reg)
+void save_reg(const koopa_raw_value_t &value, const std::string &reg, OutputSink &out)
 {
-    std::string ret = "";
     assert(value->kind.tag != KOOPA_RVT_INTEGER);
     int offset;
     int index;
@@ -751,43 +817,145 @@ std::string save_reg(const koopa_raw_value_t &value, const std::string &reg)
     case KOOPA_RVT_FUNC_ARG_REF:
         index = value->kind.data.func_arg_ref.index;
         assert(index >= 8);
-        ret += deal_offset_exceed(stack.len + (index - 8) * 4, "sw", reg);
+        deal_offset_exceed(stack.len + (index - 8) * 4, "sw", reg, out);
         break;
     case KOOPA_RVT_GLOBAL_ALLOC:
-        ret += "  la t1, " + std::string(value->name + 1) + "\n";
-        ret += "  sw " + reg + ", 0(t1)\n";
+        out << "  la t1, " << (value->name + 1) << "\n";
+        out << "  sw " << reg << ", 0(t1)\n";
         break;
     default:
         offset = stack.get_loc(value);
-        ret += deal_offset_exceed(offset, "sw", reg);
+        deal_offset_exceed(offset, "sw", reg, out);
         break;
     }
-    return ret;
 }
 
 // 遍历 agg 并输出为一系列 .word 格式
-std::string aggregate_init(const koopa_raw_value_t &value)
+void aggregate_init(const koopa_raw_value_t &value, OutputSink &out)
 {
-    std::string ret = "";
     if (value->kind.tag == KOOPA_RVT_INTEGER)
     {
         // 到叶子了
-        ret += "  .word " + std::to_string(value->kind.data.integer.value) + "\n";
+        out << "  .word " << value->kind.data.integer.value << "\n";
     }
     else if (value->kind.tag == KOOPA_RVT_AGGREGATE)
     {
         const auto &agg = value->kind.data.aggregate;
         for (int i = 0; i < agg.elems.len; i++)
         {
-            ret += aggregate_init(reinterpret_cast<koopa_raw_value_t>(agg.elems.buffer[i]));
+            aggregate_init(reinterpret_cast<koopa_raw_value_t>(agg.elems.buffer[i]), out);
+        }
+    }
+}
+
+void copy_block_args(koopa_raw_basic_block_t target, const koopa_raw_slice_t &args, OutputSink &out)
+{
+    // 实参中有目标基本块的其他参数时, 直接依次赋值可能先覆盖掉后面要读的值, 这时先全部复制到暂存区
+    bool overlap = false;
+    for (size_t i = 0; i < args.len; ++i)
+    {
+        auto arg = reinterpret_cast<koopa_raw_value_t>(args.buffer[i]);
+        if (arg->kind.tag == KOOPA_RVT_BLOCK_ARG_REF && arg != target->params.buffer[i])
+        {
+            for (size_t j = 0; j < target->params.len; ++j)
+            {
+                overlap = overlap || arg == target->params.buffer[j];
+            }
+        }
+    }
+    for (size_t i = 0; i < args.len; ++i)
+    {
+        auto arg = reinterpret_cast<koopa_raw_value_t>(args.buffer[i]);
+        auto param = reinterpret_cast<koopa_raw_value_t>(target->params.buffer[i]);
+        if (arg == param)
+        {
+            continue;
+        }
+        loadstack_reg(arg, "t0", out);
+        if (overlap)
+        {
+            deal_offset_exceed(stack.scratch + i * 4, "sw", "t0", out);
+        }
+        else
+        {
+            save_reg(param, "t0", out);
+        }
+    }
+    if (overlap)
+    {
+        for (size_t i = 0; i < args.len; ++i)
+        {
+            auto param = reinterpret_cast<koopa_raw_value_t>(target->params.buffer[i]);
+            if (args.buffer[i] == param)
+            {
+                continue;
+            }
+            deal_offset_exceed(stack.scratch + i * 4, "lw", "t0", out);
+            save_reg(param, "t0", out);
+        }
+    }
+}
+
+bool is_tail_call(koopa_raw_basic_block_t bb, size_t i)
+{
+    if (i + 2 != bb->insts.len)
+        return false;
+    auto call = reinterpret_cast<koopa_raw_value_t>(bb->insts.buffer[i]);
+    auto ret = reinterpret_cast<koopa_raw_value_t>(bb->insts.buffer[i + 1]);
+    if (call->kind.tag != KOOPA_RVT_CALL || ret->kind.tag != KOOPA_RVT_RETURN)
+        return false;
+    auto value = ret->kind.data.ret.value;
+    if (value != call && !(value == nullptr && call->ty->tag == KOOPA_RTT_UNIT))
+        return false;
+    // 跳转前栈帧就被释放, 指针参数不能指向它
+    const auto &args = call->kind.data.call.args;
+    for (size_t j = 0; j < args.len; ++j)
+    {
+        auto arg = reinterpret_cast<koopa_raw_value_t>(args.buffer[j]);
+        if (arg->ty->tag == KOOPA_RTT_POINTER && !outside_frame(arg))
+            return false;
+    }
+    // 栈上的参数写入调用者为当前函数准备的区域
+    return int(args.len) - 8 <= std::max(0, stack.params - 8);
+}
+
+void tail_call(const koopa_raw_call_t &call, OutputSink &out)
+{
+#ifdef DEBUG
+    out << "visit tail call\n";
+#endif
+    // 栈上的参数先写入当前栈帧的传参区域, 避免覆盖之后还要读取的当前函数的参数
+    for (size_t i = 0; i < call.args.len; ++i)
+    {
+        auto arg = reinterpret_cast<koopa_raw_value_t>(call.args.buffer[i]);
+        if (i < 8)
+        {
+            loadstack_reg(arg, "a" + std::to_string(i), out);
+        }
+        else
+        {
+            loadstack_reg(arg, "t0", out);
+            deal_offset_exceed((i - 8) * 4, "sw", "t0", out);
         }
     }
-    return ret;
+    for (size_t i = 8; i < call.args.len; ++i)
+    {
+        deal_offset_exceed((i - 8) * 4, "lw", "t0", out);
+        deal_offset_exceed(stack.len + (i - 8) * 4, "sw", "t0", out);
+    }
+    if (ra_count)
+    {
+        deal_offset_exceed(stack.len - 4, "lw", "ra", out);
+    }
+    if (stack.len != 0)
+    {
+        deal_offset_exceed(stack.len, "addi+", "sp", out);
+    }
+    out << "  tail " << (call.callee->name + 1) << "\n";
 }
 
-std::string deal_offset_exceed(int offset, std::string inst, std::string reg)
+void deal_offset_exceed(int offset, const std::string &inst, const std::string &reg, OutputSink &out)
 {
-    std::string ret = "";
     if (inst == "lw" || inst == "sw")
     {
         if (offset < -2048 || offset > 2047)
@@ -797,45 +965,44 @@ std::string deal_offset_exceed(int offset, std::string inst, std::string reg)
 
             if (new_base_offset < -2048 || new_base_offset > 2047)
             {
-                ret += "  li t1, " + std::to_string(new_base_offset) + "\n";
-                ret += "  add t1, t1, sp\n";
+                out << "  li t1, " << new_base_offset << "\n";
+                out << "  add t1, t1, sp\n";
             }
             else
             {
-                ret += "  addi t1, sp, " + std::to_string(new_base_offset) + "\n";
+                out << "  addi t1, sp, " << new_base_offset << "\n";
             }
-            ret += "  " + inst + " " + reg + ", " + std::to_string(remaining_offset) + "(t1)\n";
+            out << "  " << inst << " " << reg << ", " << remaining_offset << "(t1)\n";
         }
         else
         {
-            ret += "  " + inst + " " + reg + ", " + std::to_string(offset) + "(sp)\n";
+            out << "  " << inst << " " << reg << ", " << offset << "(sp)\n";
         }
     }
     else if (inst == "addi-")
     {
         if (offset < -2048 || offset > 2047)
         {
-            ret += "  li t0, " + std::to_string(offset) + "\n";
-            ret += "  sub " + reg + ", sp, t0\n";
+            out << "  li t0, " << offset << "\n";
+            out << "  sub " << reg << ", sp, t0\n";
         }
         else
         {
-            ret += "  addi " + reg + ", sp, -" + std::to_string(offset) + "\n";
+            out << "  addi " << reg << ", sp, -" << offset << "\n";
         }
     }
     else if (inst == "addi+")
     {
         if (offset < -2048 || offset > 2047)
         {
-            ret += "  li t0, " + std::to_string(offset) + "\n";
-            ret += "  add " + reg + ", sp, t0\n";
+            out << "  li t0, " << offset << "\n";
+            out << "  add " << reg << ", sp, t0\n";
         }
         else
         {
-            ret += "  addi " + reg + ", sp, " + std::to_string(offset) + "\n";
+            out << "  addi " << reg << ", sp, " << offset << "\n";
         }
     }
-    return ret;
 }
 
 // 函数：检查给定行是否是存储指令（sw）
@@ -849,94 +1016,3 @@ bool is_lw(const std::string &line)
 {
     return line.find("lw") == 0;
 }
-
-// 函数：处理并优化 RISC-V 汇编代码
-std::string optimize_riscv_code(const std::string &riscv_code)
-{
-    std::stringstream result;
-    std::istringstream code_stream(riscv_code);
-    std::string line, prev_sw;
-    bool sw_detected = false;
-
-    // 逐行处理汇编代码
-    while (std::getline(code_stream, line))
-    {
-        std::string code_part = line;
-        size_t comment_pos = line.find('#');
-        std::string comment_part = "";
-        if (comment_pos != std::string::npos)
-        {
-            code_part = line.substr(0, comment_pos); // 获取指令部分
-            comment_part = line.substr(comment_pos); // 获取注释部分
-        }
-
-        // 去除空格并保留原有格式
-        std::string trimmed_code_part = code_part;
-        trimmed_code_part.erase(std::remove_if(trimmed_code_part.begin(), trimmed_code_part.end(), ::isspace), trimmed_code_part.end());
-
-        // 忽略空行
-        if (trimmed_code_part.empty())
-        {
-            result << line << std::endl;
-            continue;
-        }
-
-        // 如果是存储指令 (sw)，记录当前存储的寄存器
-        if (is_sw(trimmed_code_part))
-        {
-            prev_sw = trimmed_code_part;
-            // prev_lw.clear(); // 清除之前的 lw
-            sw_detected = true;
-        }
-        // 如果是加载指令 (lw)，尝试进行优化
-        else if (is_lw(trimmed_code_part))
-        {
-            if (sw_detected)
-            {
-                std::string lw_instr, lw_dst, lw_addr, sw_instr, sw_src, sw_addr;
-                size_t comma_pos;
-                lw_instr = trimmed_code_part.substr(0, 2); // "lw"
-
-                // 查找寄存器和偏移部分的分隔符 ','
-                comma_pos = trimmed_code_part.find(',');
-
-                // 提取寄存器部分（从第3个字符开始，到逗号位置）
-                lw_dst = trimmed_code_part.substr(2, comma_pos - 2); // "t0"
-
-                // 提取偏移部分（从逗号后开始）
-                lw_addr = trimmed_code_part.substr(comma_pos + 1); // "4(sp)"
-                // 判断 lw 载入的地址与前一个 sw 存储的地址是否一致，且寄存器一致
-
-                sw_instr = prev_sw.substr(0, 2); // "lw"
-
-                // 查找寄存器和偏移部分的分隔符 ','
-                comma_pos = prev_sw.find(',');
-
-                // 提取寄存器部分（从第3个字符开始，到逗号位置）
-                sw_src = prev_sw.substr(2, comma_pos - 2); // "t0"
-
-                // 提取偏移部分（从逗号后开始）
-                sw_addr = prev_sw.substr(comma_pos + 1); // "4(sp)"
-
-                if (lw_dst != "" && sw_src != "" && lw_addr == sw_addr)
-                {
-                    // 使用 mv 替代 lw，避免冗余的内存加载
-                    if (lw_dst != sw_src)
-                    {
-                        result << "  mv " << lw_dst << ", " << sw_src << comment_part << std::endl;
-                    }
-                    sw_detected = false; // 重置标志位
-                    continue;            // 跳过当前的 lw 指令
-                }
-            }
-            sw_detected = false; // 重置标志位
-        }
-        else
-        {
-            sw_detected = false;
-        }
-        result << line << std::endl;
-    }
-
-    return result.str();
-}
\ No newline at end of file
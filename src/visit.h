@@ -1,5 +1,6 @@
 #pragma once
 #include <unordered_map>
+#include <vector>
 #include <memory>
 #include <cassert>
 #include <iostream>
@@ -7,6 +8,8 @@
 #include <sstream>
 #include <string.h>
 #include "koopa.h"
+#include "output.h"
+#include "thread_pool.h"
 
 // #define DEBUG
 /**********************************************************************************************************/
@@ -18,116 +21,154 @@ class Stack
 public:
     int len;
     int pos;
+    // 传递基本块参数时暂存实参的区域
+    int scratch;
+    // 当前函数的入口基本块, 它的位置由函数名标记
+    koopa_raw_basic_block_t entry;
+    // 当前函数的参数个数, 超过 8 个的部分在调用者的栈帧中
+    int params;
 
     Stack()
     {
         len = 0;
         pos = 0;
+        scratch = 0;
+        entry = nullptr;
+        params = 0;
+        zero_fill_count = 0;
     }
     void alloc_value(koopa_raw_value_t value, int loc);
     int get_loc(koopa_raw_value_t value);
+    bool has_loc(koopa_raw_value_t value);
+    // 跳转到 bb 的 br 指令使用的中转标号, 同一个基本块多次作为真目标时加上序号区分
+    std::string double_jump_label(koopa_raw_basic_block_t bb);
+    // 清零循环的标号, 用入口基本块的名字和序号区分
+    std::string zero_fill_label();
     void init();
 
 private:
     std::unordered_map<koopa_raw_value_t, int> value_loc;
+    std::unordered_map<koopa_raw_basic_block_t, int> double_jump_count;
+    int zero_fill_count;
 };
 
-static Stack stack;
+// 当前函数的栈帧, 每个线程各有一份
+static thread_local Stack stack;
 
-static int ra_count = 0;
+static thread_local int ra_count = 0;
 /**********************************************************************************************************/
-/**********************************************PtrSizeVec**************************************************/
+/***********************************************TypeSize***************************************************/
 /**********************************************************************************************************/
 
-class PtrSizeVec
+// 按类型计算其占用的字节数, 结果按类型指针缓存
+// GenerateIR 构建的类型经过 hash-consing, 结构相同的类型只会计算一次
+class TypeSize
 {
 public:
-    int get_value_offset(koopa_raw_value_t src);
-    int get_value_total_size(koopa_raw_value_t value);
-    void push_size(koopa_raw_value_t value, int size);
-    void copy_size_vec(koopa_raw_value_t dest, koopa_raw_value_t src);
-    void copy_size_vec_ptr(koopa_raw_value_t dest, koopa_raw_value_t src);
+    int size_of(koopa_raw_type_t ty);
+    void clear();
 
 private:
-    std::unordered_map<koopa_raw_value_t, std::vector<int>> size_vec;
+    std::unordered_map<koopa_raw_type_t, int> size_cache;
 };
 
-static PtrSizeVec ptr_size_vec;
+static thread_local TypeSize type_size;
 
 /**********************************************************************************************************/
 /************************************************Visit*****************************************************/
 /**********************************************************************************************************/
 
+// 为各个函数并行生成代码的线程池, 为空时按顺序生成
+// 栈帧等状态都是 thread_local 的, 每个函数的代码先写入各自的缓冲区, 最后按原顺序拼接
+extern ThreadPool *backend_pool;
+
 // 访问 raw program
-std::string Visit(const koopa_raw_program_t &program);
+void Visit(const koopa_raw_program_t &program, OutputSink &out);
 
 // 访问 raw slice
-std::string Visit(const koopa_raw_slice_t &slice);
+void Visit(const koopa_raw_slice_t &slice, OutputSink &out);
 
 // 访问函数
-std::string Visit(const koopa_raw_function_t &func);
+void Visit(const koopa_raw_function_t &func, OutputSink &out);
 
 // 访问基本块
-std::string Visit(const koopa_raw_basic_block_t &bb);
+void Visit(const koopa_raw_basic_block_t &bb, OutputSink &out);
 
 // 访问指令
-std::string Visit(const koopa_raw_value_t &value);
+void Visit(const koopa_raw_value_t &value, OutputSink &out);
 
 // 访问 integer 指令
-std::string Visit(const koopa_raw_integer_t &integer);
+void Visit(const koopa_raw_integer_t &integer, OutputSink &out);
 
 // 访问 global alloc 指令
-std::string Visit(const koopa_raw_global_alloc_t &global_alloc, const koopa_raw_value_t &value);
+void Visit(const koopa_raw_global_alloc_t &global_alloc, const koopa_raw_value_t &value, OutputSink &out);
 
 // 访问 load 指令
-std::string Visit(const koopa_raw_load_t &load, const koopa_raw_value_t &value);
+void Visit(const koopa_raw_load_t &load, const koopa_raw_value_t &value, OutputSink &out);
 
 // 访问 store 指令
-std::string Visit(const koopa_raw_store_t &store);
+void Visit(const koopa_raw_store_t &store, OutputSink &out);
 
 // 访问 getptr 指令
-std::string Visit(const koopa_raw_get_ptr_t &get_ptr, const koopa_raw_value_t &value);
+void Visit(const koopa_raw_get_ptr_t &get_ptr, const koopa_raw_value_t &value, OutputSink &out);
 
 // 访问 getelemptr 指令
-std::string Visit(const koopa_raw_get_elem_ptr_t &get_elem_ptr, const koopa_raw_value_t &value);
+void Visit(const koopa_raw_get_elem_ptr_t &get_elem_ptr, const koopa_raw_value_t &value, OutputSink &out);
 
 // 访问 binary 指令
-std::string Visit(const koopa_raw_binary_t &binary, const koopa_raw_value_t &value);
+void Visit(const koopa_raw_binary_t &binary, const koopa_raw_value_t &value, OutputSink &out);
 
 // 访问 branch 指令
-std::string Visit(const koopa_raw_branch_t &branch);
+void Visit(const koopa_raw_branch_t &branch, OutputSink &out);
 
 // 访问 jump 指令
-std::string Visit(const koopa_raw_jump_t &jump);
+void Visit(const koopa_raw_jump_t &jump, OutputSink &out);
 
 // 访问 call 指令
-std::string Visit(const koopa_raw_call_t &call, const koopa_raw_value_t &value);
+void Visit(const koopa_raw_call_t &call, const koopa_raw_value_t &value, OutputSink &out);
 
 // 访问 return 指令
-std::string Visit(const koopa_raw_return_t &ret);
+void Visit(const koopa_raw_return_t &ret, OutputSink &out);
 
 /**********************************************************************************************************/
 /************************************************Utils*****************************************************/
 /**********************************************************************************************************/
 
 // 将 stack 中的值 加载到 reg 中
-std::string loadstack_reg(const koopa_raw_value_t &value, const std::string &reg);
+void loadstack_reg(const koopa_raw_value_t &value, const std::string &reg, OutputSink &out);
 
 // 将 value 的存放地址加载到 reg 中
-std::string loadaddr_reg(const koopa_raw_value_t &value, const std::string &reg);
+void loadaddr_reg(const koopa_raw_value_t &value, const std::string &reg, OutputSink &out);
+
+// 将指针 value 的值加载到 reg 中
+void loadptr_reg(const koopa_raw_value_t &value, const std::string &reg, OutputSink &out);
+
+// 将 dest 指向的 size 字节清零
+void zero_fill(const koopa_raw_value_t &dest, int size, OutputSink &out);
+
+// reg t0 中的指针加上 index 个大小为 size 的对象
+void add_scaled_index(const koopa_raw_value_t &index, int size, OutputSink &out);
 
 // 将 int 加载到 reg 中
-std::string loadint_reg(int value, const std::string &reg);
+void loadint_reg(int value, const std::string &reg, OutputSink &out);
 
 // 将 reg 中的值存回 value
-std::string save_reg(const koopa_raw_value_t &value, const std::string &reg);
+void save_reg(const koopa_raw_value_t &value, const std::string &reg, OutputSink &out);
 
 // 生成aggregate
-std::string aggregate_init(const koopa_raw_value_t &value);
+void aggregate_init(const koopa_raw_value_t &value, OutputSink &out);
+
+// 把跳转的实参写入目标基本块参数的栈空间, 按并行赋值的语义处理实参引用目标参数的情况
+void copy_block_args(koopa_raw_basic_block_t target, const koopa_raw_slice_t &args, OutputSink &out);
+
+// 基本块的第 i 条指令是否是紧跟着 ret 的调用, 且栈上传递的参数不多于当前函数的, 可以复用栈帧跳到被调用的函数
+bool is_tail_call(koopa_raw_basic_block_t bb, size_t i);
+
+// 生成尾调用, 参数就位后恢复 ra 和栈帧, 再跳到被调用的函数
+void tail_call(const koopa_raw_call_t &call, OutputSink &out);
 
 // 处理偏移量超出范围
-std::string deal_offset_exceed(int offset, std::string inst, std::string reg);
+void deal_offset_exceed(int offset, const std::string &inst, const std::string &reg, OutputSink &out);
 
 bool is_sw(const std::string &line);
 bool is_lw(const std::string &line);
-std::string optimize_riscv_code(const std::string &riscv_code);